@@ -24,6 +24,10 @@ nir_load_libclc_shader(unsigned ptr_bit_size,
                        const nir_shader_compiler_options *nir_options,
                        bool optimize);
 
+void
+nir_optimize_libclc(nir_shader *nir, unsigned num_threads,
+                    unsigned min_parallel_impls);
+
 #ifdef __cplusplus
 }
 #endif
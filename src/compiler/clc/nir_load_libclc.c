@@ -26,6 +26,8 @@
 #include "nir_serialize.h"
 #include "nir_spirv.h"
 #include "util/mesa-sha1.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 
 #ifdef DYNAMIC_LIBCLC_PATH
 #include <fcntl.h>
@@ -303,6 +305,185 @@ libclc_add_generic_variants(nir_shader *shader)
    }
 }
 
+static void
+libclc_optimize(nir_shader *nir)
+{
+   bool progress;
+   do {
+      progress = false;
+      NIR_PASS(progress, nir, nir_opt_copy_prop_vars);
+      NIR_PASS(progress, nir, nir_lower_var_copies);
+      NIR_PASS(progress, nir, nir_lower_vars_to_ssa);
+      NIR_PASS(progress, nir, nir_copy_prop);
+      NIR_PASS(progress, nir, nir_opt_remove_phis);
+      NIR_PASS(progress, nir, nir_opt_dce);
+      NIR_PASS(progress, nir, nir_opt_if, false);
+      NIR_PASS(progress, nir, nir_opt_dead_cf);
+      NIR_PASS(progress, nir, nir_opt_cse);
+      /* drivers run this pass, so don't be too aggressive. More aggressive
+       * values only increase effectiveness by <5%
+       */
+      NIR_PASS(progress, nir, nir_opt_peephole_select, 0, false, false);
+      NIR_PASS(progress, nir, nir_opt_algebraic);
+      NIR_PASS(progress, nir, nir_opt_constant_folding);
+      NIR_PASS(progress, nir, nir_opt_undef);
+      NIR_PASS(progress, nir, nir_opt_deref);
+   } while(progress);
+}
+
+/* Don't bother with threads for small libraries */
+#define LIBCLC_PARALLEL_MIN_IMPLS 64
+
+struct libclc_opt_job {
+   const nir_shader *lib;
+
+   /* The library functions whose impls this job optimizes */
+   nir_function **funcs;
+   unsigned num_funcs;
+
+   /* A private shader holding copies of the global variables, all the
+    * function declarations and the impls of funcs.
+    */
+   nir_shader *shader;
+
+   /* The copies of funcs in shader */
+   nir_function **shader_funcs;
+
+   /* Copies in shader -> library functions and variables */
+   struct hash_table *back;
+
+   struct util_queue_fence fence;
+};
+
+static void
+libclc_optimize_job(void *data, void *gdata, int thread_index)
+{
+   struct libclc_opt_job *job = data;
+   const nir_shader *lib = job->lib;
+
+   /* Nothing but this job touches the private shader, so the passes can run
+    * on it without any locking.  The library itself is only read here.
+    */
+   job->shader = nir_shader_create(NULL, lib->info.stage, lib->options, NULL);
+   job->shader->info = lib->info;
+   job->shader_funcs = ralloc_array(job->shader, nir_function *,
+                                    job->num_funcs);
+
+   struct hash_table *remap = _mesa_pointer_hash_table_create(job->shader);
+   job->back = _mesa_pointer_hash_table_create(job->shader);
+
+   nir_foreach_variable_in_shader(var, lib) {
+      nir_variable *nvar = nir_variable_clone(var, job->shader);
+      nir_shader_add_variable(job->shader, nvar);
+      _mesa_hash_table_insert(remap, var, nvar);
+      _mesa_hash_table_insert(job->back, nvar, var);
+   }
+
+   nir_foreach_function(func, lib) {
+      nir_function *nfunc = nir_function_clone(job->shader, func);
+      _mesa_hash_table_insert(remap, func, nfunc);
+      _mesa_hash_table_insert(job->back, nfunc, func);
+   }
+
+   for (unsigned i = 0; i < job->num_funcs; i++) {
+      nir_function *func = job->funcs[i];
+      nir_function *nfunc = _mesa_hash_table_search(remap, func)->data;
+      nir_function_set_impl(nfunc,
+                            nir_function_impl_clone_remap_globals(job->shader,
+                                                                  func->impl,
+                                                                  remap));
+      job->shader_funcs[i] = nfunc;
+   }
+
+   libclc_optimize(job->shader);
+}
+
+/** Runs the libclc optimization loop on batches of functions in parallel
+ *
+ * The passes only ever look at one impl at a time, so the result is the same
+ * as running them on the whole library.  Each job copies its impls into a
+ * private shader, which avoids sharing the instruction allocator and ralloc
+ * contexts of the library between threads, and the optimized impls are
+ * copied back on this thread at the end.
+ *
+ * Libraries with fewer than min_parallel_impls impls are optimized on this
+ * thread, as is everything if num_threads is less than 2.
+ * nir_load_libclc_shader() uses one thread per CPU, up to 16, and
+ * LIBCLC_PARALLEL_MIN_IMPLS.
+ */
+void
+nir_optimize_libclc(nir_shader *nir, unsigned num_threads,
+                    unsigned min_parallel_impls)
+{
+   unsigned num_impls = 0;
+   nir_foreach_function_impl(impl, nir)
+      num_impls++;
+
+   if (num_threads < 2 || num_impls < min_parallel_impls) {
+      libclc_optimize(nir);
+      return;
+   }
+
+   /* A few jobs per thread so that big functions don't leave threads idle */
+   unsigned num_jobs = num_threads * 4;
+
+   struct util_queue queue;
+   if (!util_queue_init(&queue, "clc_opt", num_jobs, num_threads, 0, NULL)) {
+      libclc_optimize(nir);
+      return;
+   }
+
+   void *mem_ctx = ralloc_context(NULL);
+   struct libclc_opt_job *jobs =
+      rzalloc_array(mem_ctx, struct libclc_opt_job, num_jobs);
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      jobs[j].lib = nir;
+      jobs[j].funcs = ralloc_array(mem_ctx, nir_function *,
+                                   DIV_ROUND_UP(num_impls, num_jobs));
+   }
+
+   /* Deal the functions out round-robin */
+   unsigned i = 0;
+   nir_foreach_function(func, nir) {
+      if (func->impl) {
+         struct libclc_opt_job *job = &jobs[i++ % num_jobs];
+         job->funcs[job->num_funcs++] = func;
+      }
+   }
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      util_queue_fence_init(&jobs[j].fence);
+      util_queue_add_job(&queue, &jobs[j], &jobs[j].fence,
+                         libclc_optimize_job, NULL, 0);
+   }
+
+   /* Copying back allocates from the library, so it has to wait for all jobs
+    * to stop reading it.
+    */
+   for (unsigned j = 0; j < num_jobs; j++)
+      util_queue_fence_wait(&jobs[j].fence);
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      struct libclc_opt_job *job = &jobs[j];
+
+      for (unsigned f = 0; f < job->num_funcs; f++) {
+         nir_function_impl *impl = job->shader_funcs[f]->impl;
+         nir_function_set_impl(job->funcs[f],
+                               nir_function_impl_clone_remap_globals(nir, impl,
+                                                                     job->back));
+      }
+
+      util_queue_fence_destroy(&job->fence);
+      ralloc_free(job->shader);
+   }
+
+   util_queue_destroy(&queue);
+   ralloc_free(mem_ctx);
+
+   nir_validate_shader(nir, "after parallel libclc optimization");
+}
+
 nir_shader *
 nir_load_libclc_shader(unsigned ptr_bit_size,
                        struct disk_cache *disk_cache,
@@ -365,29 +546,8 @@ nir_load_libclc_shader(unsigned ptr_bit_size,
     */
    if (optimize) {
       NIR_PASS_V(nir, nir_split_var_copies);
-
-      bool progress;
-      do {
-         progress = false;
-         NIR_PASS(progress, nir, nir_opt_copy_prop_vars);
-         NIR_PASS(progress, nir, nir_lower_var_copies);
-         NIR_PASS(progress, nir, nir_lower_vars_to_ssa);
-         NIR_PASS(progress, nir, nir_copy_prop);
-         NIR_PASS(progress, nir, nir_opt_remove_phis);
-         NIR_PASS(progress, nir, nir_opt_dce);
-         NIR_PASS(progress, nir, nir_opt_if, false);
-         NIR_PASS(progress, nir, nir_opt_dead_cf);
-         NIR_PASS(progress, nir, nir_opt_cse);
-         /* drivers run this pass, so don't be too aggressive. More aggressive
-          * values only increase effectiveness by <5%
-          */
-         NIR_PASS(progress, nir, nir_opt_peephole_select, 0, false, false);
-         NIR_PASS(progress, nir, nir_opt_algebraic);
-         NIR_PASS(progress, nir, nir_opt_constant_folding);
-         NIR_PASS(progress, nir, nir_opt_undef);
-         NIR_PASS(progress, nir, nir_opt_deref);
-      } while(progress);
-
+      nir_optimize_libclc(nir, MIN2(util_get_cpu_caps()->nr_cpus, 16),
+                          LIBCLC_PARALLEL_MIN_IMPLS);
       nir_sweep(nir);
    }
 
@@ -0,0 +1,106 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_clc_helpers.h"
+
+namespace {
+
+class libclc_optimize_test : public ::testing::Test {
+protected:
+   libclc_optimize_test();
+   ~libclc_optimize_test();
+
+   nir_shader *create_library(unsigned num_funcs);
+   char *print(nir_shader *nir);
+
+   const nir_shader_compiler_options options;
+};
+
+libclc_optimize_test::libclc_optimize_test()
+:  options()
+{
+   glsl_type_singleton_init_or_ref();
+}
+
+libclc_optimize_test::~libclc_optimize_test()
+{
+   glsl_type_singleton_decref();
+}
+
+/* Functions which take a few rounds of the optimization loop and refer to a
+ * global variable and to the previous function, which the parallel path has
+ * to remap.
+ */
+nir_shader *
+libclc_optimize_test::create_library(unsigned num_funcs)
+{
+   nir_shader *nir = nir_shader_create(NULL, MESA_SHADER_KERNEL, &options, NULL);
+   nir_variable *global =
+      nir_variable_create(nir, nir_var_shader_temp, glsl_uint_type(), "global");
+
+   nir_function *prev = NULL;
+   for (unsigned i = 0; i < num_funcs; i++) {
+      nir_function *func = nir_function_create(nir, ralloc_asprintf(nir, "func%u", i));
+      func->num_params = 1;
+      func->params = rzalloc_array(nir, nir_parameter, 1);
+      func->params[0].num_components = 1;
+      func->params[0].bit_size = 32;
+
+      nir_function_impl *impl = nir_function_impl_create(func);
+      nir_builder b = nir_builder_at(nir_before_impl(impl));
+
+      nir_variable *tmp = nir_local_variable_create(impl, glsl_uint_type(), "tmp");
+      nir_store_var(&b, tmp, nir_iadd_imm(&b, nir_load_param(&b, 0), i), 0x1);
+      nir_def *x = nir_imul_imm(&b, nir_load_var(&b, tmp), 1);
+      if (prev)
+         nir_call(&b, prev, x);
+      nir_store_var(&b, global, x, 0x1);
+
+      prev = func;
+   }
+
+   nir_validate_shader(nir, "libclc_optimize_test");
+   return nir;
+}
+
+/* Copying the impls back renumbers the SSA defs, so they are renumbered
+ * before printing.
+ */
+char *
+libclc_optimize_test::print(nir_shader *nir)
+{
+   nir_foreach_function_impl(impl, nir)
+      nir_index_ssa_defs(impl);
+
+   return nir_shader_as_str(nir, nir);
+}
+
+} // namespace
+
+TEST_F(libclc_optimize_test, parallel_matches_serial)
+{
+   /* More functions than LIBCLC_PARALLEL_MIN_IMPLS */
+   nir_shader *serial = create_library(100);
+   nir_shader *parallel = nir_shader_clone(NULL, serial);
+   char *unoptimized = print(serial);
+
+   nir_optimize_libclc(serial, 1, 0);
+
+   /* More threads and a lower threshold than the CPUs and the library size
+    * would give, so that the threaded path always runs.
+    */
+   nir_optimize_libclc(parallel, 4, 2);
+
+   char *serial_str = print(serial);
+   char *parallel_str = print(parallel);
+   EXPECT_STRNE(unoptimized, serial_str);
+   EXPECT_STREQ(serial_str, parallel_str);
+
+   ralloc_free(serial);
+   ralloc_free(parallel);
+}
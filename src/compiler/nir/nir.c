@@ -90,6 +90,10 @@ static const struct debug_named_value nir_debug_control[] = {
      "Print shaders even if they are marked as internal" },
    { "print_pass_flags", NIR_DEBUG_PRINT_PASS_FLAGS,
      "Print pass_flags for every instruction when pass_flags are non-zero" },
+   { "profile_passes", NIR_DEBUG_PROFILE_PASSES,
+     "Accumulate time, instruction counts and progress per pass and print them at exit" },
+   { "validate_incremental", NIR_DEBUG_VALIDATE_INCREMENTAL,
+     "Only validate functions changed by a successful lowering/optimization call" },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -1081,7 +1085,8 @@ add_ssa_def_cb(nir_def *def, void *state)
 
       def->index = impl->ssa_alloc++;
 
-      impl->valid_metadata &= ~nir_metadata_live_defs;
+      impl->valid_metadata &= ~(nir_metadata_live_defs |
+                                nir_metadata_validated);
    }
 
    return true;
@@ -1582,7 +1587,8 @@ nir_def_init(nir_instr *instr, nir_def *def,
 
       def->index = impl->ssa_alloc++;
 
-      impl->valid_metadata &= ~nir_metadata_live_defs;
+      impl->valid_metadata &= ~(nir_metadata_live_defs |
+                                nir_metadata_validated);
    } else {
       def->index = UINT_MAX;
    }
@@ -2217,7 +2223,7 @@ nir_function_impl_lower_instructions(nir_function_impl *impl,
    if (progress) {
       nir_metadata_preserve(impl, preserved);
    } else {
-      nir_metadata_preserve(impl, nir_metadata_all);
+      nir_no_progress(impl);
    }
 
    return progress;
@@ -93,6 +93,8 @@ extern bool nir_debug_print_shader[MESA_SHADER_KERNEL + 1];
 #define NIR_DEBUG_PRINT_NO_INLINE_CONSTS (1u << 20)
 #define NIR_DEBUG_PRINT_INTERNAL         (1u << 21)
 #define NIR_DEBUG_PRINT_PASS_FLAGS       (1u << 22)
+#define NIR_DEBUG_PROFILE_PASSES         (1u << 23)
+#define NIR_DEBUG_VALIDATE_INCREMENTAL   (1u << 24)
 
 #define NIR_DEBUG_PRINT (NIR_DEBUG_PRINT_VS |  \
                          NIR_DEBUG_PRINT_TCS | \
@@ -3362,6 +3364,18 @@ typedef enum {
     */
    nir_metadata_instr_index = 0x20,
 
+   /** Indicates that the impl has not changed since it was last validated.
+    *
+    * Set by nir_validate_shader() and used with
+    * NIR_DEBUG=validate_incremental to skip impls which a pass left alone.
+    * Inserting an instruction that defines an SSA value also clears it.
+    *
+    * This is not part of nir_metadata_all, a pass which changes an impl
+    * drops it even if all other metadata stays valid.  Passes which do not
+    * change an impl at all should preserve it by calling nir_no_progress().
+    */
+   nir_metadata_validated = 0x40,
+
    /** All control flow metadata
     *
     * This includes all metadata preserved by a pass that preserves control flow
@@ -3376,12 +3390,12 @@ typedef enum {
 
    /** All metadata
     *
-    * This includes all nir_metadata flags except not_properly_reset.  Passes
-    * which do not change the shader in any way should call
+    * This includes all nir_metadata flags except not_properly_reset and
+    * validated.  Passes which do not change the shader in any way should call
     *
-    *    nir_metadata_preserve(impl, nir_metadata_all);
+    *    nir_no_progress(impl);
     */
-   nir_metadata_all = ~nir_metadata_not_properly_reset,
+   nir_metadata_all = ~(nir_metadata_not_properly_reset | nir_metadata_validated),
 } nir_metadata;
 MESA_DEFINE_CPP_ENUM_BITFIELD_OPERATORS(nir_metadata)
 
@@ -4678,6 +4692,7 @@ nir_function_impl *nir_cf_node_get_function(nir_cf_node *node);
 void nir_metadata_require(nir_function_impl *impl, nir_metadata required, ...);
 /** dirties all but the preserved metadata */
 void nir_metadata_preserve(nir_function_impl *impl, nir_metadata preserved);
+bool nir_no_progress(nir_function_impl *impl);
 /** Preserves all metadata for the given shader */
 void nir_shader_preserve_all_metadata(nir_shader *shader);
 
@@ -5272,8 +5287,14 @@ void nir_shader_replace(nir_shader *dest, nir_shader *src);
 
 void nir_shader_serialize_deserialize(nir_shader *s);
 
+typedef struct nir_pass_profile_state {
+   int64_t start_ns;
+   unsigned instrs;
+} nir_pass_profile_state;
+
 #ifndef NDEBUG
 void nir_validate_shader(nir_shader *shader, const char *when);
+void nir_validate_shader_incremental(nir_shader *shader, const char *when);
 void nir_validate_ssa_dominance(nir_shader *shader, const char *when);
 void nir_metadata_set_validation_flag(nir_shader *shader);
 void nir_metadata_check_validation_flag(nir_shader *shader);
@@ -5305,6 +5326,25 @@ should_print_nir(nir_shader *shader)
 
    return unlikely(nir_debug_print_shader[shader->info.stage]);
 }
+
+void _nir_pass_profile_begin(nir_shader *shader, nir_pass_profile_state *state);
+void _nir_pass_profile_end(nir_shader *shader, const char *pass,
+                           const nir_pass_profile_state *state, bool progress);
+
+static inline void
+nir_pass_profile_begin(nir_shader *shader, nir_pass_profile_state *state)
+{
+   if (NIR_DEBUG(PROFILE_PASSES))
+      _nir_pass_profile_begin(shader, state);
+}
+
+static inline void
+nir_pass_profile_end(nir_shader *shader, const char *pass,
+                     const nir_pass_profile_state *state, bool progress)
+{
+   if (NIR_DEBUG(PROFILE_PASSES))
+      _nir_pass_profile_end(shader, pass, state, progress);
+}
 #else
 static inline void
 nir_validate_shader(nir_shader *shader, const char *when)
@@ -5313,6 +5353,12 @@ nir_validate_shader(nir_shader *shader, const char *when)
    (void)when;
 }
 static inline void
+nir_validate_shader_incremental(nir_shader *shader, const char *when)
+{
+   (void)shader;
+   (void)when;
+}
+static inline void
 nir_validate_ssa_dominance(nir_shader *shader, const char *when)
 {
    (void)shader;
@@ -5338,6 +5384,17 @@ should_print_nir(UNUSED nir_shader *shader)
 {
    return false;
 }
+static inline void
+nir_pass_profile_begin(UNUSED nir_shader *shader,
+                       UNUSED nir_pass_profile_state *state)
+{
+}
+static inline void
+nir_pass_profile_end(UNUSED nir_shader *shader, UNUSED const char *pass,
+                     UNUSED const nir_pass_profile_state *state,
+                     UNUSED bool progress)
+{
+}
 #endif /* NDEBUG */
 
 #define _PASS(pass, nir, do_pass)                                       \
@@ -5356,24 +5413,32 @@ should_print_nir(UNUSED nir_shader *shader)
       }                                                                 \
    } while (0)
 
-#define NIR_PASS(progress, nir, pass, ...) _PASS(pass, nir, {   \
-   nir_metadata_set_validation_flag(nir);                       \
-   if (should_print_nir(nir))                                   \
-      printf("%s\n", #pass);                                    \
-   if (pass(nir, ##__VA_ARGS__)) {                              \
-      nir_validate_shader(nir, "after " #pass " in " __FILE__); \
-      UNUSED bool _;                                            \
-      progress = true;                                          \
-      if (should_print_nir(nir))                                \
-         nir_print_shader(nir, stdout);                         \
-      nir_metadata_check_validation_flag(nir);                  \
-   }                                                            \
+#define NIR_PASS(progress, nir, pass, ...) _PASS(pass, nir, {               \
+   nir_pass_profile_state _profile = {0};                                   \
+   nir_metadata_set_validation_flag(nir);                                   \
+   if (should_print_nir(nir))                                               \
+      printf("%s\n", #pass);                                                \
+   nir_pass_profile_begin(nir, &_profile);                                  \
+   bool _pass_progress = pass(nir, ##__VA_ARGS__);                          \
+   nir_pass_profile_end(nir, #pass, &_profile, _pass_progress);             \
+   if (_pass_progress) {                                                    \
+      nir_validate_shader_incremental(nir, "after " #pass " in " __FILE__); \
+      UNUSED bool _;                                                        \
+      progress = true;                                                      \
+      if (should_print_nir(nir))                                            \
+         nir_print_shader(nir, stdout);                                     \
+      nir_metadata_check_validation_flag(nir);                              \
+   }                                                                        \
 })
 
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir, {        \
+   nir_pass_profile_state _profile = {0};                    \
    if (should_print_nir(nir))                                \
       printf("%s\n", #pass);                                 \
+   nir_pass_profile_begin(nir, &_profile);                   \
    pass(nir, ##__VA_ARGS__);                                 \
+   /* the return value, if any, is dropped */                \
+   nir_pass_profile_end(nir, #pass, &_profile, false);       \
    nir_validate_shader(nir, "after " #pass " in " __FILE__); \
    if (should_print_nir(nir))                                \
       nir_print_shader(nir, stdout);                         \
@@ -5426,6 +5491,49 @@ do {                                                                 \
 
 #define NIR_SKIP(name) should_skip_nir(#name)
 
+/* Coarse classes of IR, used as dependency hints by nir_opt_fixpoint(). */
+typedef enum {
+   /** ALU instructions and intrinsics computing SSA values */
+   nir_fixpoint_ssa = BITFIELD_BIT(0),
+   /** blocks, ifs, loops and phis */
+   nir_fixpoint_cf = BITFIELD_BIT(1),
+   /** variables, derefs and the loads/stores/copies through them */
+   nir_fixpoint_vars = BITFIELD_BIT(2),
+   nir_fixpoint_all = BITFIELD_MASK(3),
+} nir_fixpoint_deps;
+
+typedef struct nir_fixpoint_pass {
+   const char *name;
+
+   /* exactly one of these is set */
+   bool (*pass)(nir_shader *shader);
+   bool (*pass_with_data)(nir_shader *shader, const void *data);
+   const void *data;
+
+   /* what the pass looks at and what it may change, 0 means everything */
+   nir_fixpoint_deps reads;
+   nir_fixpoint_deps writes;
+
+   /* running the pass again straight after it made progress is a no-op */
+   bool idempotent;
+
+   /* progress of this pass does not make other passes run again, like
+    * NIR_PASS(_, ...) in a hand-written loop
+    */
+   bool ignore_progress;
+} nir_fixpoint_pass;
+
+#define NIR_FIXPOINT_PASS(fn) .name = #fn, .pass = fn
+
+/* Runs the passes in order until none of them is left to run, and returns
+ * whether any made progress.  Unlike a do { ... } while (progress) loop, a
+ * pass only runs again once a pass whose writes overlap its reads made
+ * progress since its last run (or, unless it is idempotent, after its own
+ * progress).  At most 32 passes.
+ */
+bool nir_opt_fixpoint(nir_shader *shader, const nir_fixpoint_pass *passes,
+                      unsigned num_passes);
+
 /** An instruction filtering callback with writemask
  *
  * Returns true if the instruction should be processed with the associated
@@ -108,7 +108,7 @@ nir_function_instructions_pass(nir_function_impl *impl,
    if (progress) {
       nir_metadata_preserve(impl, preserved);
    } else {
-      nir_metadata_preserve(impl, nir_metadata_all);
+      nir_no_progress(impl);
    }
 
    return progress;
@@ -175,7 +175,7 @@ nir_shader_intrinsics_pass(nir_shader *shader,
          nir_metadata_preserve(impl, preserved);
          progress = true;
       } else {
-         nir_metadata_preserve(impl, nir_metadata_all);
+         nir_no_progress(impl);
       }
    }
 
@@ -208,7 +208,7 @@ nir_shader_alu_pass(nir_shader *shader,
          nir_metadata_preserve(impl, preserved);
          progress = true;
       } else {
-         nir_metadata_preserve(impl, nir_metadata_all);
+         nir_no_progress(impl);
       }
    }
 
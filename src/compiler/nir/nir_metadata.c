@@ -64,6 +64,19 @@ nir_metadata_preserve(nir_function_impl *impl, nir_metadata preserved)
    impl->valid_metadata &= preserved;
 }
 
+/**
+ * Preserves all metadata, including nir_metadata_validated, of an impl which
+ * a pass did not change.
+ *
+ * \return false, for passes to return as their progress
+ */
+bool
+nir_no_progress(nir_function_impl *impl)
+{
+   nir_metadata_preserve(impl, nir_metadata_all | nir_metadata_validated);
+   return false;
+}
+
 void
 nir_shader_preserve_all_metadata(nir_shader *shader)
 {
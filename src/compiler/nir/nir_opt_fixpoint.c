@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2024 Mesa contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nir.h"
+
+/* Same debug behaviour as NIR_PASS, with the name taken from the table. */
+static bool
+run_pass(nir_shader *shader, const nir_fixpoint_pass *p)
+{
+   if (should_skip_nir(p->name)) {
+      printf("skipping %s\n", p->name);
+      return false;
+   }
+
+   nir_pass_profile_state profile = { 0 };
+   nir_metadata_set_validation_flag(shader);
+   if (should_print_nir(shader))
+      printf("%s\n", p->name);
+
+   nir_pass_profile_begin(shader, &profile);
+   bool progress = p->pass_with_data ? p->pass_with_data(shader, p->data)
+                                     : p->pass(shader);
+   nir_pass_profile_end(shader, p->name, &profile, progress);
+
+   if (progress) {
+      nir_validate_shader_incremental(shader, p->name);
+      if (should_print_nir(shader))
+         nir_print_shader(shader, stdout);
+      nir_metadata_check_validation_flag(shader);
+   }
+
+   if (NIR_DEBUG(CLONE)) {
+      nir_shader *clone = nir_shader_clone(ralloc_parent(shader), shader);
+      nir_shader_replace(shader, clone);
+   }
+   if (NIR_DEBUG(SERIALIZE))
+      nir_shader_serialize_deserialize(shader);
+
+   return progress;
+}
+
+bool
+nir_opt_fixpoint(nir_shader *shader, const nir_fixpoint_pass *passes,
+                 unsigned num_passes)
+{
+   assert(num_passes <= 32);
+
+   /* passes which have not run yet, or which read something that changed
+    * since they last ran
+    */
+   uint32_t pending = BITFIELD_MASK(num_passes);
+   bool progress = false;
+
+   while (pending) {
+      for (unsigned i = 0; i < num_passes; i++) {
+         const nir_fixpoint_pass *p = &passes[i];
+
+         if (!(pending & BITFIELD_BIT(i)))
+            continue;
+         pending &= ~BITFIELD_BIT(i);
+
+         assert(!p->pass != !p->pass_with_data);
+         if (!run_pass(shader, p) || p->ignore_progress)
+            continue;
+
+         progress = true;
+
+         nir_fixpoint_deps writes = p->writes ? p->writes : nir_fixpoint_all;
+         for (unsigned j = 0; j < num_passes; j++) {
+            nir_fixpoint_deps reads = passes[j].reads ? passes[j].reads : nir_fixpoint_all;
+            if ((j != i || !p->idempotent) && (reads & writes))
+               pending |= BITFIELD_BIT(j);
+         }
+      }
+   }
+
+   return progress;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright © 2024 Mesa contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Per-pass compile time profiler, enabled with NIR_DEBUG=profile_passes.
+ *
+ * Every NIR_PASS/NIR_PASS_V invocation adds its wall time, the instruction
+ * count of the shader before and after the pass, and whether it made
+ * progress to a process-wide table keyed by the pass name.  The table is
+ * printed to stderr at exit, sorted by total time, and written as JSON to
+ * the file named by NIR_PASS_PROFILE_JSON if that is set.
+ */
+
+#ifndef NDEBUG
+
+#include "nir.h"
+#include "util/hash_table.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+#include "util/u_call_once.h"
+
+struct pass_profile_entry {
+   const char *name;
+   uint64_t calls;
+   uint64_t progress;
+   int64_t time_ns;
+   uint64_t instrs_before;
+   uint64_t instrs_after;
+};
+
+static struct {
+   simple_mtx_t lock;
+   struct hash_table *entries;
+} profile = {
+   SIMPLE_MTX_INITIALIZER,
+   NULL,
+};
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function_impl(impl, shader) {
+      nir_foreach_block(block, impl)
+         count += exec_list_length(&block->instr_list);
+   }
+
+   return count;
+}
+
+static int
+compare_entries(const void *_a, const void *_b)
+{
+   const struct pass_profile_entry *a = *(const struct pass_profile_entry **)_a;
+   const struct pass_profile_entry *b = *(const struct pass_profile_entry **)_b;
+
+   if (a->time_ns != b->time_ns)
+      return a->time_ns < b->time_ns ? 1 : -1;
+   return strcmp(a->name, b->name);
+}
+
+static void
+write_json(FILE *fp, struct pass_profile_entry **sorted, unsigned count)
+{
+   fprintf(fp, "[\n");
+   for (unsigned i = 0; i < count; i++) {
+      const struct pass_profile_entry *e = sorted[i];
+      fprintf(fp, "  {\"pass\": \"%s\", \"calls\": %" PRIu64 ", "
+                  "\"progress\": %" PRIu64 ", \"time_ns\": %" PRId64 ", "
+                  "\"instrs_before\": %" PRIu64 ", \"instrs_after\": %" PRIu64 "}%s\n",
+              e->name, e->calls, e->progress, e->time_ns,
+              e->instrs_before, e->instrs_after, i + 1 < count ? "," : "");
+   }
+   fprintf(fp, "]\n");
+}
+
+static void
+write_table(FILE *fp, struct pass_profile_entry **sorted, unsigned count)
+{
+   int64_t total_ns = 0;
+   for (unsigned i = 0; i < count; i++)
+      total_ns += sorted[i]->time_ns;
+
+   fprintf(fp, "NIR pass profile, %.3f ms total\n", total_ns / 1000000.0);
+   fprintf(fp, "%-40s %10s %10s %12s %7s %14s %14s\n",
+           "pass", "calls", "progress", "time (ms)", "%",
+           "instrs before", "instrs after");
+   for (unsigned i = 0; i < count; i++) {
+      const struct pass_profile_entry *e = sorted[i];
+      fprintf(fp, "%-40s %10" PRIu64 " %10" PRIu64 " %12.3f %6.2f%% %14" PRIu64 " %14" PRIu64 "\n",
+              e->name, e->calls, e->progress, e->time_ns / 1000000.0,
+              total_ns ? e->time_ns * 100.0 / total_ns : 0.0,
+              e->instrs_before, e->instrs_after);
+   }
+}
+
+static void
+dump_profile(void)
+{
+   simple_mtx_lock(&profile.lock);
+
+   unsigned count = profile.entries->entries;
+   struct pass_profile_entry **sorted = malloc(count * sizeof(*sorted));
+   if (!sorted) {
+      simple_mtx_unlock(&profile.lock);
+      return;
+   }
+
+   unsigned i = 0;
+   hash_table_foreach(profile.entries, he)
+      sorted[i++] = he->data;
+   qsort(sorted, count, sizeof(*sorted), compare_entries);
+
+   write_table(stderr, sorted, count);
+
+   const char *json = getenv("NIR_PASS_PROFILE_JSON");
+   if (json) {
+      FILE *fp = fopen(json, "w");
+      if (fp) {
+         write_json(fp, sorted, count);
+         fclose(fp);
+      } else {
+         fprintf(stderr, "NIR: failed to open %s for the pass profile\n", json);
+      }
+   }
+
+   free(sorted);
+   simple_mtx_unlock(&profile.lock);
+}
+
+static void
+init_profile(void)
+{
+   profile.entries = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                             _mesa_key_string_equal);
+   atexit(dump_profile);
+}
+
+void
+_nir_pass_profile_begin(nir_shader *shader, nir_pass_profile_state *state)
+{
+   state->instrs = count_instrs(shader);
+   state->start_ns = os_time_get_nano();
+}
+
+void
+_nir_pass_profile_end(nir_shader *shader, const char *pass,
+                      const nir_pass_profile_state *state, bool progress)
+{
+   int64_t time_ns = os_time_get_nano() - state->start_ns;
+   unsigned instrs = count_instrs(shader);
+
+   static util_once_flag once = UTIL_ONCE_FLAG_INIT;
+   util_call_once(&once, init_profile);
+
+   simple_mtx_lock(&profile.lock);
+
+   struct hash_entry *he = _mesa_hash_table_search(profile.entries, pass);
+   struct pass_profile_entry *e;
+   if (he) {
+      e = he->data;
+   } else {
+      /* pass names come from string literals, so they outlive the table */
+      e = rzalloc(profile.entries, struct pass_profile_entry);
+      e->name = pass;
+      _mesa_hash_table_insert(profile.entries, pass, e);
+   }
+
+   e->calls++;
+   e->progress += progress;
+   e->time_ns += time_ns;
+   e->instrs_before += state->instrs;
+   e->instrs_after += instrs;
+
+   simple_mtx_unlock(&profile.lock);
+}
+
+#endif /* NDEBUG */
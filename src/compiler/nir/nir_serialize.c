@@ -30,6 +30,15 @@
 #define NIR_SERIALIZE_FUNC_HAS_IMPL ((void *)(intptr_t)1)
 #define MAX_OBJECT_IDS              (1 << 20)
 
+/* The first uint32 of a serialized shader is "NIR" followed by a format
+ * version, which must be bumped whenever the encoding changes.  Streams
+ * written before the version existed start with the object count instead,
+ * which is always below MAX_OBJECT_IDS and so never matches.
+ */
+#define NIR_SERIALIZE_MAGIC   0x4e4952
+#define NIR_SERIALIZE_VERSION 1
+#define NIR_SERIALIZE_HEADER  ((NIR_SERIALIZE_MAGIC << 8) | NIR_SERIALIZE_VERSION)
+
 typedef struct {
    size_t blob_offset;
    nir_def *src;
@@ -44,6 +53,12 @@ typedef struct {
    /* maps pointer to index */
    struct hash_table *remap_table;
 
+   /* maps nir_def::index to index for the defs of the current impl, which
+    * are the bulk of all objects and cheaper to look up this way
+    */
+   uint32_t *def_ids;
+   uint32_t num_def_ids;
+
    /* the next index to assign to a NIR in-memory object */
    uint32_t next_idx;
 
@@ -105,6 +120,23 @@ write_lookup_object(write_ctx *ctx, const void *obj)
    return (uint32_t)(uintptr_t)entry->data;
 }
 
+static void
+write_add_def(write_ctx *ctx, const nir_def *def)
+{
+   uint32_t index = ctx->next_idx++;
+   assert(index != MAX_OBJECT_IDS);
+   assert(def->index < ctx->num_def_ids);
+   ctx->def_ids[def->index] = index;
+}
+
+static uint32_t
+write_lookup_def(write_ctx *ctx, const nir_def *def)
+{
+   assert(def->index < ctx->num_def_ids);
+   assert(ctx->def_ids[def->index] != UINT32_MAX);
+   return ctx->def_ids[def->index];
+}
+
 static void
 read_add_object(read_ctx *ctx, void *obj)
 {
@@ -454,7 +486,7 @@ union packed_src {
 static void
 write_src_full(write_ctx *ctx, const nir_src *src, union packed_src header)
 {
-   header.any.object_idx = write_lookup_object(ctx, src->ssa);
+   header.any.object_idx = write_lookup_def(ctx, src->ssa);
    blob_write_uint32(ctx->blob, header.u32);
 }
 
@@ -653,7 +685,7 @@ write_def(write_ctx *ctx, const nir_def *def, union packed_instr header,
    if (pdef.num_components == NUM_COMPONENTS_IS_SEPARATE_7)
       blob_write_uint32(ctx->blob, def->num_components);
 
-   write_add_object(ctx, def);
+   write_add_def(ctx, def);
 }
 
 static void
@@ -734,7 +766,7 @@ write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 
    if (header.alu.packed_src_ssa_16bit) {
       for (unsigned i = 0; i < num_srcs; i++) {
-         unsigned idx = write_lookup_object(ctx, alu->src[i].src.ssa);
+         unsigned idx = write_lookup_def(ctx, alu->src[i].src.ssa);
          assert(idx < (1 << 16));
          blob_write_uint16(ctx->blob, idx);
       }
@@ -930,9 +962,9 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
    case nir_deref_type_ptr_as_array:
       if (header.deref.packed_src_ssa_16bit) {
          blob_write_uint16(ctx->blob,
-                           write_lookup_object(ctx, deref->parent.ssa));
+                           write_lookup_def(ctx, deref->parent.ssa));
          blob_write_uint16(ctx->blob,
-                           write_lookup_object(ctx, deref->arr.index.ssa));
+                           write_lookup_def(ctx, deref->arr.index.ssa));
       } else {
          write_src(ctx, &deref->parent);
          write_src(ctx, &deref->arr.index);
@@ -1246,7 +1278,7 @@ write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
       }
    }
 
-   write_add_object(ctx, &lc->def);
+   write_add_def(ctx, &lc->def);
 }
 
 static nir_load_const_instr *
@@ -1340,7 +1372,7 @@ write_ssa_undef(write_ctx *ctx, const nir_undef_instr *undef)
    header.undef.bit_size = encode_bit_size_3bits(undef->def.bit_size);
 
    blob_write_uint32(ctx->blob, header.u32);
-   write_add_object(ctx, &undef->def);
+   write_add_def(ctx, &undef->def);
 }
 
 static nir_undef_instr *
@@ -1493,7 +1525,7 @@ write_fixup_phis(write_ctx *ctx)
 {
    util_dynarray_foreach(&ctx->phi_fixups, write_phi_fixup, fixup) {
       blob_overwrite_uint32(ctx->blob, fixup->blob_offset,
-                            write_lookup_object(ctx, fixup->src));
+                            write_lookup_def(ctx, fixup->src));
       blob_overwrite_uint32(ctx->blob, fixup->blob_offset + sizeof(uint32_t),
                             write_lookup_object(ctx, fixup->block));
    }
@@ -1760,12 +1792,47 @@ read_instr(read_ctx *ctx, nir_block *block)
    return 1;
 }
 
+/* Control flow nodes are written as a single uint32 holding the node type
+ * and all of its flags, followed by whatever the node contains.
+ */
+union packed_cf_node {
+   uint32_t u32;
+   struct {
+      unsigned type : 2; /* always present */
+      unsigned _pad : 30;
+   } any;
+   struct {
+      unsigned type : 2;
+      unsigned divergent : 1;
+      unsigned num_instrs : 29;
+   } block;
+   struct {
+      unsigned type : 2;
+      unsigned control : 2;
+      unsigned _pad : 28;
+   } nif;
+   struct {
+      unsigned type : 2;
+      unsigned control : 2;
+      unsigned divergent_continue : 1;
+      unsigned divergent_break : 1;
+      unsigned has_continue_construct : 1;
+      unsigned _pad : 25;
+   } loop;
+};
+
 static void
 write_block(write_ctx *ctx, const nir_block *block)
 {
    write_add_object(ctx, block);
-   blob_write_uint8(ctx->blob, block->divergent);
-   blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+
+   union packed_cf_node header;
+   header.u32 = 0;
+   header.block.type = nir_cf_node_block;
+   header.block.divergent = block->divergent;
+   header.block.num_instrs = exec_list_length(&block->instr_list);
+   assert(header.block.num_instrs == exec_list_length(&block->instr_list));
+   blob_write_uint32(ctx->blob, header.u32);
 
    ctx->last_instr_type = ~0;
    ctx->last_alu_header_offset = 0;
@@ -1777,7 +1844,8 @@ write_block(write_ctx *ctx, const nir_block *block)
 }
 
 static void
-read_block(read_ctx *ctx, struct exec_list *cf_list)
+read_block(read_ctx *ctx, struct exec_list *cf_list,
+           union packed_cf_node header)
 {
    /* Don't actually create a new block.  Just use the one from the tail of
     * the list.  NIR guarantees that the tail of the list is a block and that
@@ -1787,8 +1855,8 @@ read_block(read_ctx *ctx, struct exec_list *cf_list)
       exec_node_data(nir_block, exec_list_get_tail(cf_list), cf_node.node);
 
    read_add_object(ctx, block);
-   block->divergent = blob_read_uint8(ctx->blob);
-   unsigned num_instrs = blob_read_uint32(ctx->blob);
+   block->divergent = header.block.divergent;
+   unsigned num_instrs = header.block.num_instrs;
    for (unsigned i = 0; i < num_instrs;) {
       i += read_instr(ctx, block);
    }
@@ -1803,20 +1871,25 @@ read_cf_list(read_ctx *ctx, struct exec_list *cf_list);
 static void
 write_if(write_ctx *ctx, nir_if *nif)
 {
+   union packed_cf_node header;
+   header.u32 = 0;
+   header.nif.type = nir_cf_node_if;
+   header.nif.control = nif->control;
+   blob_write_uint32(ctx->blob, header.u32);
+
    write_src(ctx, &nif->condition);
-   blob_write_uint8(ctx->blob, nif->control);
 
    write_cf_list(ctx, &nif->then_list);
    write_cf_list(ctx, &nif->else_list);
 }
 
 static void
-read_if(read_ctx *ctx, struct exec_list *cf_list)
+read_if(read_ctx *ctx, struct exec_list *cf_list, union packed_cf_node header)
 {
    nir_if *nif = nir_if_create(ctx->nir);
 
    read_src(ctx, &nif->condition);
-   nif->control = blob_read_uint8(ctx->blob);
+   nif->control = header.nif.control;
 
    nir_cf_node_insert_end(cf_list, &nif->cf_node);
 
@@ -1827,11 +1900,16 @@ read_if(read_ctx *ctx, struct exec_list *cf_list)
 static void
 write_loop(write_ctx *ctx, nir_loop *loop)
 {
-   blob_write_uint8(ctx->blob, loop->control);
-   blob_write_uint8(ctx->blob, loop->divergent_continue);
-   blob_write_uint8(ctx->blob, loop->divergent_break);
    bool has_continue_construct = nir_loop_has_continue_construct(loop);
-   blob_write_uint8(ctx->blob, has_continue_construct);
+
+   union packed_cf_node header;
+   header.u32 = 0;
+   header.loop.type = nir_cf_node_loop;
+   header.loop.control = loop->control;
+   header.loop.divergent_continue = loop->divergent_continue;
+   header.loop.divergent_break = loop->divergent_break;
+   header.loop.has_continue_construct = has_continue_construct;
+   blob_write_uint32(ctx->blob, header.u32);
 
    write_cf_list(ctx, &loop->body);
    if (has_continue_construct) {
@@ -1840,16 +1918,17 @@ write_loop(write_ctx *ctx, nir_loop *loop)
 }
 
 static void
-read_loop(read_ctx *ctx, struct exec_list *cf_list)
+read_loop(read_ctx *ctx, struct exec_list *cf_list,
+          union packed_cf_node header)
 {
    nir_loop *loop = nir_loop_create(ctx->nir);
 
    nir_cf_node_insert_end(cf_list, &loop->cf_node);
 
-   loop->control = blob_read_uint8(ctx->blob);
-   loop->divergent_continue = blob_read_uint8(ctx->blob);
-   loop->divergent_break = blob_read_uint8(ctx->blob);
-   bool has_continue_construct = blob_read_uint8(ctx->blob);
+   loop->control = header.loop.control;
+   loop->divergent_continue = header.loop.divergent_continue;
+   loop->divergent_break = header.loop.divergent_break;
+   bool has_continue_construct = header.loop.has_continue_construct;
 
    read_cf_list(ctx, &loop->body);
    if (has_continue_construct) {
@@ -1861,8 +1940,6 @@ read_loop(read_ctx *ctx, struct exec_list *cf_list)
 static void
 write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 {
-   blob_write_uint32(ctx->blob, cf->type);
-
    switch (cf->type) {
    case nir_cf_node_block:
       write_block(ctx, nir_cf_node_as_block(cf));
@@ -1881,17 +1958,18 @@ write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 static void
 read_cf_node(read_ctx *ctx, struct exec_list *list)
 {
-   nir_cf_node_type type = blob_read_uint32(ctx->blob);
+   union packed_cf_node header;
+   header.u32 = blob_read_uint32(ctx->blob);
 
-   switch (type) {
+   switch (header.any.type) {
    case nir_cf_node_block:
-      read_block(ctx, list);
+      read_block(ctx, list, header);
       break;
    case nir_cf_node_if:
-      read_if(ctx, list);
+      read_if(ctx, list, header);
       break;
    case nir_cf_node_loop:
-      read_loop(ctx, list);
+      read_loop(ctx, list, header);
       break;
    default:
       unreachable("bad cf type");
@@ -1926,6 +2004,14 @@ write_function_impl(write_ctx *ctx, const nir_function_impl *fi)
 
    write_var_list(ctx, &fi->locals);
 
+   if (fi->ssa_alloc > ctx->num_def_ids) {
+      ctx->def_ids = realloc(ctx->def_ids, fi->ssa_alloc * sizeof(uint32_t));
+      ctx->num_def_ids = fi->ssa_alloc;
+   }
+#ifndef NDEBUG
+   memset(ctx->def_ids, 0xff, ctx->num_def_ids * sizeof(uint32_t));
+#endif
+
    write_cf_list(ctx, &fi->body);
    write_fixup_phis(ctx);
 }
@@ -2107,6 +2193,7 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
    ctx.strip = strip;
    util_dynarray_init(&ctx.phi_fixups, NULL);
 
+   blob_write_uint32(blob, NIR_SERIALIZE_HEADER);
    size_t idx_size_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
@@ -2152,13 +2239,26 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
 
    _mesa_hash_table_destroy(ctx.remap_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
+   free(ctx.def_ids);
 }
 
+/**
+ * Deserialize NIR written by nir_serialize().
+ *
+ * Returns NULL if the blob was written with a different format version.
+ * Only NIR stored by a different build can have one.  NIR serialized by the
+ * same process, embedded at build time or loaded from caches keyed on the
+ * build ID (the disk cache and the Vulkan pipeline caches) can't, and
+ * callers which only see such NIR don't need to check for NULL.
+ */
 nir_shader *
 nir_deserialize(void *mem_ctx,
                 const struct nir_shader_compiler_options *options,
                 struct blob_reader *blob)
 {
+   if (blob_read_uint32(blob) != NIR_SERIALIZE_HEADER)
+      return NULL;
+
    read_ctx ctx = { 0 };
    ctx.blob = blob;
    list_inithead(&ctx.phi_srcs);
@@ -1742,12 +1742,9 @@ dump_errors(validate_state *state, const char *when)
    abort();
 }
 
-void
-nir_validate_shader(nir_shader *shader, const char *when)
+static void
+validate_shader(nir_shader *shader, const char *when, bool incremental)
 {
-   if (NIR_DEBUG(NOVALIDATE))
-      return;
-
    validate_state state;
    init_validate_state(&state);
 
@@ -1789,6 +1786,13 @@ nir_validate_shader(nir_shader *shader, const char *when)
 
    exec_list_validate(&shader->functions);
    foreach_list_typed(nir_function, func, node, &shader->functions) {
+      /* Impls which kept nir_metadata_validated haven't changed since they
+       * were last validated.
+       */
+      if (incremental && func->impl &&
+          (func->impl->valid_metadata & nir_metadata_validated))
+         continue;
+
       validate_function(func, &state);
    }
 
@@ -1807,9 +1811,38 @@ nir_validate_shader(nir_shader *shader, const char *when)
    if (_mesa_hash_table_num_entries(state.errors) > 0)
       dump_errors(&state, when);
 
+   nir_foreach_function_impl(impl, shader)
+      impl->valid_metadata |= nir_metadata_validated;
+
    destroy_validate_state(&state);
 }
 
+void
+nir_validate_shader(nir_shader *shader, const char *when)
+{
+   if (NIR_DEBUG(NOVALIDATE))
+      return;
+
+   validate_shader(shader, when, false);
+}
+
+/**
+ * Validation after a pass made progress, as done by NIR_PASS.
+ *
+ * With NIR_DEBUG=validate_incremental, this only validates the shader-level
+ * state and the impls a pass changed, going by nir_metadata_validated.  This
+ * relies on passes preserving metadata correctly, so every direct call to
+ * nir_validate_shader() remains a full validation and acts as a checkpoint.
+ */
+void
+nir_validate_shader_incremental(nir_shader *shader, const char *when)
+{
+   if (NIR_DEBUG(NOVALIDATE))
+      return;
+
+   validate_shader(shader, when, NIR_DEBUG(VALIDATE_INCREMENTAL));
+}
+
 void
 nir_validate_ssa_dominance(nir_shader *shader, const char *when)
 {
@@ -117,4 +117,31 @@ TEST_F(nir_core_test, nir_instr_free_and_dce_multiple_src_test)
    nir_validate_shader(b->shader, "after remove_and_dce");
 }
 
+#ifndef NDEBUG
+TEST_F(nir_core_test, nir_metadata_validated_test)
+{
+   nir_def *one = nir_imm_int(b, 1);
+   nir_validate_shader(b->shader, NULL);
+   ASSERT_TRUE(b->impl->valid_metadata & nir_metadata_validated);
+
+   /* an unchanged impl stays validated */
+   nir_no_progress(b->impl);
+   ASSERT_TRUE(b->impl->valid_metadata & nir_metadata_validated);
+
+   /* a pass which changes the impl but keeps all other metadata doesn't */
+   nir_metadata_preserve(b->impl, nir_metadata_all);
+   ASSERT_FALSE(b->impl->valid_metadata & nir_metadata_validated);
+   nir_validate_shader(b->shader, NULL);
+
+   nir_iadd(b, one, one);
+   ASSERT_FALSE(b->impl->valid_metadata & nir_metadata_validated);
+
+   nir_validate_shader_incremental(b->shader, NULL);
+   ASSERT_TRUE(b->impl->valid_metadata & nir_metadata_validated);
+
+   nir_metadata_preserve(b->impl, nir_metadata_control_flow);
+   ASSERT_FALSE(b->impl->valid_metadata & nir_metadata_validated);
+}
+#endif
+
 }
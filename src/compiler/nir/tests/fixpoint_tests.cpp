@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2024 Mesa contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nir_test.h"
+
+namespace {
+
+/* reports progress on its first "progress_calls" calls */
+struct fake_pass {
+   unsigned progress_calls;
+   unsigned calls;
+};
+
+bool
+fake_pass_run(nir_shader *shader, const void *data)
+{
+   fake_pass *p = (fake_pass *)data;
+
+   if (p->calls++ >= p->progress_calls)
+      return false;
+
+   nir_shader_preserve_all_metadata(shader);
+   return true;
+}
+
+class nir_opt_fixpoint_test : public nir_test {
+protected:
+   nir_opt_fixpoint_test()
+      : nir_test::nir_test("nir_opt_fixpoint_test")
+   {
+   }
+
+   nir_fixpoint_pass pass(const char *name, fake_pass *p,
+                          unsigned reads = 0, unsigned writes = 0)
+   {
+      nir_fixpoint_pass fp = {};
+      fp.name = name;
+      fp.pass_with_data = fake_pass_run;
+      fp.data = p;
+      fp.reads = (nir_fixpoint_deps)reads;
+      fp.writes = (nir_fixpoint_deps)writes;
+      return fp;
+   }
+};
+
+} /* namespace */
+
+TEST_F(nir_opt_fixpoint_test, no_progress_runs_each_pass_once)
+{
+   fake_pass first = {}, second = {}, third = {};
+   nir_fixpoint_pass passes[] = {
+      pass("first", &first), pass("second", &second), pass("third", &third),
+   };
+
+   EXPECT_FALSE(nir_opt_fixpoint(b->shader, passes, ARRAY_SIZE(passes)));
+   EXPECT_EQ(first.calls, 1);
+   EXPECT_EQ(second.calls, 1);
+   EXPECT_EQ(third.calls, 1);
+}
+
+TEST_F(nir_opt_fixpoint_test, progress_reruns_only_readers)
+{
+   fake_pass a = { .progress_calls = 2 }, vars = {}, ssa = {};
+   nir_fixpoint_pass passes[] = {
+      pass("a", &a, nir_fixpoint_ssa, nir_fixpoint_ssa),
+      pass("vars", &vars, nir_fixpoint_vars, nir_fixpoint_vars),
+      pass("ssa", &ssa, nir_fixpoint_ssa, nir_fixpoint_ssa),
+   };
+
+   EXPECT_TRUE(nir_opt_fixpoint(b->shader, passes, ARRAY_SIZE(passes)));
+   /* two runs with progress and the one that finds nothing */
+   EXPECT_EQ(a.calls, 3);
+   EXPECT_EQ(vars.calls, 1);
+   /* after each of the two changes of a, the first one also being its initial run */
+   EXPECT_EQ(ssa.calls, 2);
+}
+
+TEST_F(nir_opt_fixpoint_test, earlier_pass_reruns_after_later_progress)
+{
+   fake_pass first = {}, second = { .progress_calls = 1 };
+   nir_fixpoint_pass passes[] = {
+      pass("first", &first),
+      pass("second", &second),
+   };
+   passes[1].idempotent = true;
+
+   EXPECT_TRUE(nir_opt_fixpoint(b->shader, passes, ARRAY_SIZE(passes)));
+   EXPECT_EQ(first.calls, 2);
+   EXPECT_EQ(second.calls, 1);
+}
+
+TEST_F(nir_opt_fixpoint_test, non_idempotent_pass_reruns_itself)
+{
+   fake_pass a = { .progress_calls = 3 };
+   nir_fixpoint_pass passes[] = {
+      pass("a", &a),
+   };
+
+   EXPECT_TRUE(nir_opt_fixpoint(b->shader, passes, ARRAY_SIZE(passes)));
+   EXPECT_EQ(a.calls, 4);
+}
+
+TEST_F(nir_opt_fixpoint_test, ignored_progress)
+{
+   fake_pass first = {}, second = { .progress_calls = 1 };
+   nir_fixpoint_pass passes[] = {
+      pass("first", &first),
+      pass("second", &second),
+   };
+   passes[1].ignore_progress = true;
+
+   EXPECT_FALSE(nir_opt_fixpoint(b->shader, passes, ARRAY_SIZE(passes)));
+   EXPECT_EQ(first.calls, 1);
+   EXPECT_EQ(second.calls, 1);
+}
@@ -22,10 +22,16 @@
  */
 
 #include <gtest/gtest.h>
+#include <inttypes.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 #include "nir.h"
 #include "nir_builder.h"
 #include "nir_serialize.h"
+#include "util/os_time.h"
 
 namespace {
 
@@ -100,6 +106,19 @@ nir_serialize_test::ASSERT_SWIZZLE_EQ(nir_alu_instr *a, nir_alu_instr *b, unsign
 
 class nir_serialize_all_test : public nir_serialize_test {};
 class nir_serialize_all_but_one_test : public nir_serialize_test {};
+class nir_serialize_cf_test : public nir_serialize_test {};
+
+/* Bytes allocated from the heap, or -1 if that can't be queried. */
+static int64_t
+heap_in_use()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+   struct mallinfo2 info = mallinfo2();
+   return info.uordblks + info.hblkhd;
+#else
+   return -1;
+#endif
+}
 
 } // namespace
 
@@ -195,3 +214,141 @@ TEST_P(nir_serialize_all_but_one_test, single_channel)
 
    ASSERT_SWIZZLE_EQ(vec_alu, vec_alu_dup, 1, 0);
 }
+
+TEST_F(nir_serialize_cf_test, cf_node_flags)
+{
+   nir_def *cond = nir_channel(b, nir_load_local_invocation_id(b), 0);
+
+   nir_if *nif = nir_push_if(b, nir_ieq_imm(b, cond, 0));
+   nif->control = nir_selection_control_divergent_always_taken;
+   nir_pop_if(b, nif);
+
+   nir_loop *loop = nir_push_loop(b);
+   loop->control = nir_loop_control_dont_unroll;
+   loop->divergent_continue = false;
+   loop->divergent_break = true;
+   nir_jump(b, nir_jump_break);
+   nir_loop_add_continue_construct(loop);
+   nir_pop_loop(b, loop);
+   nir_loop_first_block(loop)->divergent = true;
+
+   serialize();
+
+   nir_function_impl *impl = nir_shader_get_entrypoint(dup);
+   nir_if *dup_if = NULL;
+   nir_loop *dup_loop = NULL;
+   foreach_list_typed(nir_cf_node, node, node, &impl->body) {
+      if (node->type == nir_cf_node_if)
+         dup_if = nir_cf_node_as_if(node);
+      else if (node->type == nir_cf_node_loop)
+         dup_loop = nir_cf_node_as_loop(node);
+   }
+
+   ASSERT_NE(dup_if, nullptr);
+   ASSERT_NE(dup_loop, nullptr);
+   EXPECT_EQ(dup_if->control, nir_selection_control_divergent_always_taken);
+   EXPECT_EQ(dup_loop->control, nir_loop_control_dont_unroll);
+   EXPECT_TRUE(dup_loop->divergent_break);
+   EXPECT_FALSE(dup_loop->divergent_continue);
+   EXPECT_TRUE(nir_loop_has_continue_construct(dup_loop));
+   EXPECT_TRUE(nir_loop_first_block(dup_loop)->divergent);
+   EXPECT_EQ(exec_list_length(&nir_loop_first_block(dup_loop)->instr_list), 1);
+}
+
+TEST_F(nir_serialize_cf_test, version_mismatch)
+{
+   nir_store_global(b, nir_imm_int64(b, 0), 4, nir_imm_int(b, 1), 0x1);
+
+   struct blob blob;
+   blob_init(&blob);
+   nir_serialize(&blob, b->shader, false);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob.data, blob.size);
+   uint32_t header = blob_read_uint32(&reader);
+
+   /* Blobs from other format versions, or no NIR at all, are rejected. */
+   const uint32_t bad_headers[] = { header + 1, header - 1, 0 };
+   for (unsigned i = 0; i < ARRAY_SIZE(bad_headers); i++) {
+      blob_overwrite_uint32(&blob, 0, bad_headers[i]);
+      blob_reader_init(&reader, blob.data, blob.size);
+      EXPECT_EQ(nir_deserialize(NULL, &options, &reader), nullptr);
+   }
+
+   blob_overwrite_uint32(&blob, 0, header);
+   blob_reader_init(&reader, blob.data, blob.size);
+   nir_shader *copy = nir_deserialize(NULL, &options, &reader);
+   EXPECT_NE(copy, nullptr);
+   ralloc_free(copy);
+
+   blob_finish(&blob);
+}
+
+/* Round-trip latency and memory of a large shader, run with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(nir_serialize_cf_test, DISABLED_round_trip_benchmark)
+{
+   const unsigned num_ifs = 1000, iterations = 100;
+
+   nir_def *id = nir_load_global_invocation_id(b, 32);
+   nir_def *x = nir_channel(b, id, 0);
+   for (unsigned i = 0; i < num_ifs; i++) {
+      nir_push_if(b, nir_ilt_imm(b, x, i));
+      nir_def *y = x;
+      for (unsigned k = 0; k < 20; k++)
+         y = nir_iadd(b, nir_imul_imm(b, y, k + 3), id);
+      nir_store_global(b, nir_u2u64(b, nir_channel(b, y, 0)), 4, y, 0x7);
+      nir_def *then_x = nir_channel(b, y, 1);
+      nir_push_else(b, NULL);
+      nir_def *else_x = nir_f2u32(b, nir_fadd_imm(b, nir_u2f32(b, x), 1.0));
+      nir_pop_if(b, NULL);
+      x = nir_if_phi(b, then_x, else_x);
+   }
+   nir_store_global(b, nir_imm_int64(b, 0), 4, x, 0x1);
+
+   int64_t serialize_ns = 0, deserialize_ns = 0;
+   size_t size = 0;
+
+   /* What a round trip leaves allocated while the blob and the copy are
+    * alive.  This is not the peak, the temporaries of nir_deserialize() are
+    * already freed.  It is negative if the heap shrank.
+    */
+   int64_t retained = INT64_MIN;
+
+   for (unsigned i = 0; i < iterations; i++) {
+      int64_t heap_before = heap_in_use();
+
+      struct blob blob;
+      blob_init(&blob);
+
+      int64_t start = os_time_get_nano();
+      nir_serialize(&blob, b->shader, true);
+      int64_t mid = os_time_get_nano();
+
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob.data, blob.size);
+      nir_shader *copy = nir_deserialize(NULL, &options, &reader);
+      int64_t end = os_time_get_nano();
+
+      ASSERT_NE(copy, nullptr);
+      if (heap_before >= 0)
+         retained = MAX2(retained, heap_in_use() - heap_before);
+      serialize_ns += mid - start;
+      deserialize_ns += end - mid;
+      size = blob.size;
+
+      ralloc_free(copy);
+      blob_finish(&blob);
+   }
+
+   printf("%u SSA defs, %zu bytes serialized\n",
+          nir_shader_get_entrypoint(b->shader)->ssa_alloc, size);
+   printf("serialize %.1f us, deserialize %.1f us, ",
+          serialize_ns / 1000.0 / iterations,
+          deserialize_ns / 1000.0 / iterations);
+   if (retained == INT64_MIN)
+      printf("retained heap growth n/a\n");
+   else
+      printf("retained heap growth %" PRId64 " KiB\n", retained / 1024);
+}
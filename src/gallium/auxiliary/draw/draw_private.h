@@ -45,6 +45,8 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_shader_tokens.h"
 
+#include "util/u_queue.h"
+
 #include "draw_vertex_header.h"
 
 #if DRAW_LLVM_AVAILABLE
@@ -196,6 +198,9 @@ struct draw_context
          struct draw_pt_front_end *vsplit;
       } front;
 
+      /** Threads running the vertex shader of large draws (DRAW_VS_THREADS) */
+      struct util_queue vs_queue;
+
       struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
       unsigned nr_vertex_buffers;
 
@@ -213,6 +218,8 @@ struct draw_context
 
       bool test_fse;         /* enable FSE even though its not correct (eg for softpipe) */
       bool no_fse;           /* disable FSE even when it is correct */
+      bool large_vcache;     /* never shade an index twice per segment */
+      bool vcache_stats;     /* count VS invocations per unique vertex */
 
       /* user-space vertex data, buffers */
       struct {
@@ -46,6 +46,9 @@
 
 DEBUG_GET_ONCE_BOOL_OPTION(draw_fse, "DRAW_FSE", false)
 DEBUG_GET_ONCE_BOOL_OPTION(draw_no_fse, "DRAW_NO_FSE", false)
+DEBUG_GET_ONCE_BOOL_OPTION(draw_large_vcache, "DRAW_LARGE_VCACHE", false)
+DEBUG_GET_ONCE_BOOL_OPTION(draw_vcache_stats, "DRAW_VCACHE_STATS", false)
+DEBUG_GET_ONCE_NUM_OPTION(draw_vs_threads, "DRAW_VS_THREADS", 0)
 
 
 /* Overall we split things into:
@@ -192,6 +195,8 @@ draw_pt_init(struct draw_context *draw)
 {
    draw->pt.test_fse = debug_get_option_draw_fse();
    draw->pt.no_fse = debug_get_option_draw_no_fse();
+   draw->pt.large_vcache = debug_get_option_draw_large_vcache();
+   draw->pt.vcache_stats = debug_get_option_draw_vcache_stats();
 
    draw->pt.front.vsplit = draw_pt_vsplit(draw);
    if (!draw->pt.front.vsplit)
@@ -209,6 +214,13 @@ draw_pt_init(struct draw_context *draw)
    if (draw->llvm) {
       draw->pt.middle.llvm = draw_pt_fetch_pipeline_or_emit_llvm(draw);
       draw->pt.middle.mesh = draw_pt_mesh_pipeline_or_emit(draw);
+
+      /* Only the LLVM middle end can shade vertices in parallel. */
+      unsigned num_threads = MIN2(debug_get_option_draw_vs_threads(), 16);
+      if (num_threads &&
+          !util_queue_init(&draw->pt.vs_queue, "draw_vs", 64, num_threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL))
+         return false;
    }
 #endif
 
@@ -219,6 +231,9 @@ draw_pt_init(struct draw_context *draw)
 void
 draw_pt_destroy(struct draw_context *draw)
 {
+   if (util_queue_is_initialized(&draw->pt.vs_queue))
+      util_queue_destroy(&draw->pt.vs_queue);
+
    if (draw->pt.middle.mesh) {
       draw->pt.middle.mesh->destroy(draw->pt.middle.mesh);
       draw->pt.middle.mesh = NULL;
@@ -124,6 +124,14 @@ struct draw_pt_middle_end {
 
    int (*get_max_vertex_count)(struct draw_pt_middle_end *);
 
+   /**
+    * Optional.  Front ends enable this around the runs split from a single
+    * large draw, during which the middle end may shade the vertices on
+    * worker threads.  The runs are still emitted in order, at the latest
+    * when this is disabled again.
+    */
+   void (*set_parallel)(struct draw_pt_middle_end *, bool parallel);
+
    void (*finish)(struct draw_pt_middle_end *);
    void (*destroy)(struct draw_pt_middle_end *);
 };
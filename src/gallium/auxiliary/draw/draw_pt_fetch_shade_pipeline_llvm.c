@@ -41,6 +41,36 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/* Max number of batches of a parallel draw waiting to be emitted */
+#define LLVM_MAX_QUEUED_BATCHES 32
+
+
+/**
+ * The vertices of one middle end run, and the draw state the vertex shader
+ * depends on.  Batches of a parallel draw get their own copy of the
+ * elements, as the front end reuses its buffers for the next run.
+ */
+struct llvm_vs_batch {
+   struct util_queue_fence fence;
+   struct llvm_middle_end *fpme;
+
+   struct draw_fetch_info fetch_info;
+   struct draw_prim_info prim_info;
+   unsigned draw_count;
+
+   unsigned start;
+   unsigned vertex_id_offset;
+   unsigned instance_id;
+   unsigned start_instance;
+   unsigned drawid;
+   unsigned viewid;
+
+   /* Vertex shader outputs */
+   struct draw_vertex_info vert_info;
+   bool clipped;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -58,6 +88,12 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /* Batches queued on draw->pt.vs_queue, in submission order */
+   bool parallel;
+   struct llvm_vs_batch *batches[LLVM_MAX_QUEUED_BATCHES];
+   unsigned first_batch;
+   unsigned num_batches;
 };
 
 
@@ -492,11 +528,103 @@ emit(struct pt_emit *emit,
 
 
 static void
-llvm_pipeline_generic(struct draw_pt_middle_end *middle,
-                      const struct draw_fetch_info *fetch_info,
-                      const struct draw_prim_info *in_prim_info)
+llvm_update_statistics(struct draw_context *draw,
+                       const struct draw_fetch_info *fetch_info,
+                       const struct draw_prim_info *prim_info)
+{
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += prim_info->count;
+      if (prim_info->prim == MESA_PRIM_PATCHES)
+         draw->statistics.ia_primitives +=
+            prim_info->count / draw->pt.vertices_per_patch;
+      else
+         draw->statistics.ia_primitives +=
+            u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
+      draw->statistics.vs_invocations += fetch_info->count;
+   }
+}
+
+
+static void
+llvm_vs_batch_init(struct llvm_middle_end *fpme,
+                   struct llvm_vs_batch *batch,
+                   const struct draw_fetch_info *fetch_info)
+{
+   struct draw_context *draw = fpme->draw;
+
+   batch->fpme = fpme;
+   batch->fetch_info = *fetch_info;
+
+   if (fetch_info->linear) {
+      batch->start = fetch_info->start;
+      batch->vertex_id_offset = draw->start_index;
+   } else {
+      batch->start = draw->pt.user.eltMax;
+      batch->vertex_id_offset = draw->pt.user.eltBias;
+   }
+
+   batch->instance_id = draw->instance_id;
+   batch->start_instance = draw->start_instance;
+   batch->drawid = draw->pt.user.drawid;
+   batch->viewid = draw->pt.user.viewid;
+}
+
+
+/**
+ * Run vertex fetch and the vertex shader, including clip testing and the
+ * viewport transform.  Only reads state that doesn't change during a draw,
+ * so this may run on a worker thread.
+ */
+static void
+llvm_vs_batch_run(struct llvm_vs_batch *batch)
+{
+   struct llvm_middle_end *fpme = batch->fpme;
+   struct draw_context *draw = fpme->draw;
+   const struct draw_fetch_info *fetch_info = &batch->fetch_info;
+   struct draw_vertex_info *vert_info = &batch->vert_info;
+
+   assert(fetch_info->count > 0);
+
+   vert_info->count = fetch_info->count;
+   vert_info->vertex_size = fpme->vertex_size;
+   vert_info->stride = fpme->vertex_size;
+   vert_info->verts = (struct vertex_header *)
+      MALLOC(fpme->vertex_size *
+             align(fetch_info->count, lp_native_vector_width / 32) +
+             DRAW_EXTRA_VERTICES_PADDING);
+   if (!vert_info->verts) {
+      assert(0);
+      return;
+   }
+
+   /* Run vertex fetch shader */
+   batch->clipped = fpme->current_variant->jit_func(&fpme->llvm->vs_jit_context,
+                                                    &fpme->llvm->jit_resources[PIPE_SHADER_VERTEX],
+                                                    vert_info->verts,
+                                                    draw->pt.user.vbuffer,
+                                                    fetch_info->count,
+                                                    batch->start,
+                                                    fpme->vertex_size,
+                                                    draw->pt.vertex_buffer,
+                                                    batch->instance_id,
+                                                    batch->vertex_id_offset,
+                                                    batch->start_instance,
+                                                    fetch_info->linear ? NULL : fetch_info->elts,
+                                                    batch->drawid,
+                                                    batch->viewid);
+}
+
+
+/**
+ * Run the remaining stages on the vertex shader outputs, and emit the
+ * result.  Takes ownership of vs_vert_info->verts.
+ */
+static void
+llvm_pipeline_shaded(struct llvm_middle_end *fpme,
+                     struct draw_vertex_info *vs_vert_info,
+                     const struct draw_prim_info *in_prim_info,
+                     bool clipped)
 {
-   struct llvm_middle_end *fpme = llvm_middle_end(middle);
    struct draw_context *draw = fpme->draw;
    struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
    struct draw_tess_ctrl_shader *tcs_shader = draw->tcs.tess_ctrl_shader;
@@ -504,77 +632,16 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
    struct draw_prim_info tcs_prim_info;
    struct draw_prim_info tes_prim_info;
    struct draw_prim_info gs_prim_info[TGSI_MAX_VERTEX_STREAMS];
-   struct draw_vertex_info llvm_vert_info;
    struct draw_vertex_info tcs_vert_info;
    struct draw_vertex_info tes_vert_info;
-   struct draw_vertex_info *vert_info;
+   struct draw_vertex_info *vert_info = vs_vert_info;
    struct draw_prim_info ia_prim_info;
    struct draw_vertex_info ia_vert_info;
    const struct draw_prim_info *prim_info = in_prim_info;
    bool free_prim_info = false;
    unsigned opt = fpme->opt;
-   bool clipped = 0;
    uint16_t *tes_elts_out = NULL;
 
-   assert(fetch_info->count > 0);
-
-   llvm_vert_info.count = fetch_info->count;
-   llvm_vert_info.vertex_size = fpme->vertex_size;
-   llvm_vert_info.stride = fpme->vertex_size;
-   llvm_vert_info.verts = (struct vertex_header *)
-      MALLOC(fpme->vertex_size *
-             align(fetch_info->count, lp_native_vector_width / 32) +
-             DRAW_EXTRA_VERTICES_PADDING);
-   if (!llvm_vert_info.verts) {
-      assert(0);
-      return;
-   }
-
-   if (draw->collect_statistics) {
-      draw->statistics.ia_vertices += prim_info->count;
-      if (prim_info->prim == MESA_PRIM_PATCHES)
-         draw->statistics.ia_primitives +=
-            prim_info->count / draw->pt.vertices_per_patch;
-      else
-         draw->statistics.ia_primitives +=
-            u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
-      draw->statistics.vs_invocations += fetch_info->count;
-   }
-
-   {
-      unsigned start, vertex_id_offset;
-      const unsigned *elts;
-
-      if (fetch_info->linear) {
-         start = fetch_info->start;
-         vertex_id_offset = draw->start_index;
-         elts = NULL;
-      } else {
-         start = draw->pt.user.eltMax;
-         vertex_id_offset = draw->pt.user.eltBias;
-         elts = fetch_info->elts;
-      }
-      /* Run vertex fetch shader */
-      clipped = fpme->current_variant->jit_func(&fpme->llvm->vs_jit_context,
-                                                &fpme->llvm->jit_resources[PIPE_SHADER_VERTEX],
-                                                llvm_vert_info.verts,
-                                                draw->pt.user.vbuffer,
-                                                fetch_info->count,
-                                                start,
-                                                fpme->vertex_size,
-                                                draw->pt.vertex_buffer,
-                                                draw->instance_id,
-                                                vertex_id_offset,
-                                                draw->start_instance,
-                                                elts,
-                                                draw->pt.user.drawid,
-                                                draw->pt.user.viewid);
-
-      /* Finished with fetch and vs */
-      fetch_info = NULL;
-      vert_info = &llvm_vert_info;
-   }
-
    /* Keep track of the patch lengths if we have a geometry shader, this way we can increment
     * gl_PrimitiveID once per patch, instead of per tessellation output primitive.
     * The Vulkan and OpenGL specs say:
@@ -743,6 +810,133 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
 }
 
 
+/**
+ * Wait for the oldest batch of a parallel draw, and emit it.
+ */
+static void
+llvm_retire_batch(struct llvm_middle_end *fpme)
+{
+   struct llvm_vs_batch *batch = fpme->batches[fpme->first_batch];
+
+   assert(fpme->num_batches);
+   fpme->first_batch = (fpme->first_batch + 1) % LLVM_MAX_QUEUED_BATCHES;
+   fpme->num_batches--;
+
+   util_queue_fence_wait(&batch->fence);
+   util_queue_fence_destroy(&batch->fence);
+
+   if (batch->vert_info.verts)
+      llvm_pipeline_shaded(fpme, &batch->vert_info, &batch->prim_info,
+                           batch->clipped);
+
+   FREE(batch);
+}
+
+
+static void
+llvm_retire_batches(struct llvm_middle_end *fpme)
+{
+   while (fpme->num_batches)
+      llvm_retire_batch(fpme);
+}
+
+
+static void
+llvm_vs_batch_execute(void *data, void *gdata, int thread_index)
+{
+   /* Same as draw_vbo() */
+   unsigned fpstate = util_fpstate_get();
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   llvm_vs_batch_run(data);
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Queue the vertex shading of a run on the worker threads.  The batches
+ * are emitted in order once shaded, so the primitive order is preserved.
+ */
+static void
+llvm_queue_batch(struct llvm_middle_end *fpme,
+                 const struct draw_fetch_info *fetch_info,
+                 const struct draw_prim_info *prim_info)
+{
+   const size_t fetch_elts_size =
+      fetch_info->linear ? 0 : fetch_info->count * sizeof(unsigned);
+   const size_t draw_elts_size =
+      prim_info->linear ? 0 : prim_info->count * sizeof(uint16_t);
+
+   struct llvm_vs_batch *batch =
+      MALLOC(sizeof(*batch) + fetch_elts_size + draw_elts_size);
+   if (!batch) {
+      /* Keep the order and fall back to shading on this thread */
+      llvm_retire_batches(fpme);
+
+      struct llvm_vs_batch local;
+      llvm_vs_batch_init(fpme, &local, fetch_info);
+      llvm_vs_batch_run(&local);
+      if (local.vert_info.verts)
+         llvm_pipeline_shaded(fpme, &local.vert_info, prim_info,
+                              local.clipped);
+      return;
+   }
+
+   llvm_vs_batch_init(fpme, batch, fetch_info);
+   batch->vert_info.verts = NULL;
+
+   uint8_t *elts = (uint8_t *)(batch + 1);
+   if (fetch_elts_size) {
+      memcpy(elts, fetch_info->elts, fetch_elts_size);
+      batch->fetch_info.elts = (const unsigned *)elts;
+      elts += fetch_elts_size;
+   }
+
+   batch->prim_info = *prim_info;
+   batch->draw_count = prim_info->count;
+   batch->prim_info.primitive_lengths = &batch->draw_count;
+   assert(prim_info->primitive_count == 1);
+   if (draw_elts_size) {
+      memcpy(elts, prim_info->elts, draw_elts_size);
+      batch->prim_info.elts = (const uint16_t *)elts;
+   }
+
+   if (fpme->num_batches == LLVM_MAX_QUEUED_BATCHES)
+      llvm_retire_batch(fpme);
+
+   fpme->batches[(fpme->first_batch + fpme->num_batches) %
+                 LLVM_MAX_QUEUED_BATCHES] = batch;
+   fpme->num_batches++;
+
+   util_queue_fence_init(&batch->fence);
+   util_queue_add_job(&fpme->draw->pt.vs_queue, batch, &batch->fence,
+                      llvm_vs_batch_execute, NULL, 0);
+}
+
+
+static void
+llvm_pipeline_generic(struct draw_pt_middle_end *middle,
+                      const struct draw_fetch_info *fetch_info,
+                      const struct draw_prim_info *prim_info)
+{
+   struct llvm_middle_end *fpme = llvm_middle_end(middle);
+
+   llvm_update_statistics(fpme->draw, fetch_info, prim_info);
+
+   if (fpme->parallel) {
+      llvm_queue_batch(fpme, fetch_info, prim_info);
+      return;
+   }
+
+   struct llvm_vs_batch batch;
+   llvm_vs_batch_init(fpme, &batch, fetch_info);
+   llvm_vs_batch_run(&batch);
+   if (batch.vert_info.verts)
+      llvm_pipeline_shaded(fpme, &batch.vert_info, prim_info, batch.clipped);
+}
+
+
 static inline enum mesa_prim
 prim_type(enum mesa_prim prim, unsigned flags)
 {
@@ -843,10 +1037,35 @@ llvm_middle_end_linear_run_elts(struct draw_pt_middle_end *middle,
 }
 
 
+static void
+llvm_middle_end_set_parallel(struct draw_pt_middle_end *middle,
+                             bool parallel)
+{
+   struct llvm_middle_end *fpme = llvm_middle_end(middle);
+   struct draw_context *draw = fpme->draw;
+
+   if (parallel) {
+      /* The later shader stages run when the batches are emitted, and
+       * depend on draw state which changes between runs.
+       */
+      fpme->parallel = fpme->current_variant &&
+                       !draw->tcs.tess_ctrl_shader &&
+                       !draw->tes.tess_eval_shader &&
+                       !draw->gs.geometry_shader;
+   } else {
+      llvm_retire_batches(fpme);
+      fpme->parallel = false;
+   }
+}
+
+
 static void
 llvm_middle_end_finish(struct draw_pt_middle_end *middle)
 {
-   /* nothing to do */
+   struct llvm_middle_end *fpme = llvm_middle_end(middle);
+
+   llvm_retire_batches(fpme);
+   fpme->parallel = false;
 }
 
 
@@ -888,6 +1107,7 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
    fpme->base.run             = llvm_middle_end_run;
    fpme->base.run_linear      = llvm_middle_end_linear_run;
    fpme->base.run_linear_elts = llvm_middle_end_linear_run_elts;
+   fpme->base.set_parallel    = llvm_middle_end_set_parallel;
    fpme->base.finish          = llvm_middle_end_finish;
    fpme->base.destroy         = llvm_middle_end_destroy;
 
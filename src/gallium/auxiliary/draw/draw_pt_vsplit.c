@@ -25,6 +25,7 @@
 
 #include <stdbool.h>
 
+#include "util/bitset.h"
 #include "util/macros.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -36,6 +37,21 @@
 #define SEGMENT_SIZE 1024
 #define MAP_SIZE     256
 
+/* With DRAW_LARGE_VCACHE, the cache is an open addressing hash table that
+ * can hold all the elements of a segment, so that an index is never shaded
+ * twice per segment.  The last slot is reserved for DRAW_MAX_FETCH_IDX,
+ * which marks the empty slots.
+ */
+#define LARGE_MAP_BITS 12
+#define LARGE_MAP_SIZE (1 << LARGE_MAP_BITS)
+static_assert(LARGE_MAP_SIZE >= 2 * SEGMENT_SIZE, "vsplit cache too small");
+
+/* Don't count the unique vertices of draws with a larger index range */
+#define STATS_MAX_RANGE (1 << 26)
+
+/* Draws with fewer vertices aren't worth shading on worker threads */
+#define PARALLEL_MIN_VERTICES (4 * SEGMENT_SIZE)
+
 struct vsplit_frontend {
    struct draw_pt_front_end base;
    struct draw_context *draw;
@@ -44,6 +60,9 @@ struct vsplit_frontend {
 
    struct draw_pt_middle_end *middle;
 
+   /* The run function for the current element size */
+   void (*run)(struct draw_pt_front_end *, unsigned start, unsigned count);
+
    unsigned max_vertices;
    uint16_t segment_size;
 
@@ -54,20 +73,52 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      uint16_t draws[MAP_SIZE];
+      unsigned fetches[LARGE_MAP_SIZE + 1];
+      uint16_t draws[LARGE_MAP_SIZE + 1];
       bool has_max_fetch;
+      bool large;
 
       uint16_t num_fetch_elts;
       uint16_t num_draw_elts;
    } cache;
+
+   /* DRAW_VCACHE_STATS, for the indexed draws */
+   struct {
+      bool counting;
+      uint64_t invocations;
+      uint64_t unique;
+   } stats;
 };
 
 
+/**
+ * Returns the cache slot of a fetch element: either the slot holding it, or
+ * the one to store it in.
+ */
+static inline unsigned
+vsplit_cache_slot(const struct vsplit_frontend *vsplit, unsigned fetch)
+{
+   if (!vsplit->cache.large)
+      return fetch % MAP_SIZE;
+
+   if (fetch == DRAW_MAX_FETCH_IDX)
+      return LARGE_MAP_SIZE;
+
+   unsigned hash = (fetch * 0x9e3779b1u) >> (32 - LARGE_MAP_BITS);
+   while (vsplit->cache.fetches[hash] != fetch &&
+          vsplit->cache.fetches[hash] != DRAW_MAX_FETCH_IDX)
+      hash = (hash + 1) % LARGE_MAP_SIZE;
+
+   return hash;
+}
+
+
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
+   memset(vsplit->cache.fetches, 0xff,
+          vsplit->cache.large ? sizeof(vsplit->cache.fetches) :
+                                MAP_SIZE * sizeof(vsplit->cache.fetches[0]));
    vsplit->cache.has_max_fetch = false;
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
@@ -77,6 +128,9 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   if (vsplit->stats.counting)
+      vsplit->stats.invocations += vsplit->cache.num_fetch_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -91,7 +145,7 @@ vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch)
 {
    unsigned hash;
 
-   hash = fetch % MAP_SIZE;
+   hash = vsplit_cache_slot(vsplit, fetch);
 
    /* If the value isn't in the cache or it's an overflow due to the
     * element bias */
@@ -130,7 +184,7 @@ vsplit_add_cache_uint8(struct vsplit_frontend *vsplit, const uint8_t *elts,
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
    /* unlike the uint32_t case this can only happen with elt_bias */
    if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
+      unsigned hash = vsplit_cache_slot(vsplit, elt_idx);
       vsplit->cache.fetches[hash] = 0;
       vsplit->cache.has_max_fetch = true;
    }
@@ -148,7 +202,7 @@ vsplit_add_cache_uint16(struct vsplit_frontend *vsplit, const uint16_t *elts,
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
    /* unlike the uint32_t case this can only happen with elt_bias */
    if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
+      unsigned hash = vsplit_cache_slot(vsplit, elt_idx);
       vsplit->cache.fetches[hash] = 0;
       vsplit->cache.has_max_fetch = true;
    }
@@ -173,7 +227,7 @@ vsplit_add_cache_uint32(struct vsplit_frontend *vsplit, const uint32_t *elts,
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
    /* Take care for DRAW_MAX_FETCH_IDX (since cache is initialized to -1). */
    if (elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
+      unsigned hash = vsplit_cache_slot(vsplit, elt_idx);
       /* force update - any value will do except DRAW_MAX_FETCH_IDX */
       vsplit->cache.fetches[hash] = 0;
       vsplit->cache.has_max_fetch = true;
@@ -201,6 +255,89 @@ vsplit_add_cache_uint32(struct vsplit_frontend *vsplit, const uint32_t *elts,
 #include "draw_pt_vsplit_tmp.h"
 
 
+static inline unsigned
+vsplit_get_elt(const struct draw_context *draw, unsigned start, unsigned i)
+{
+   const unsigned elt_idx = vsplit_get_base_idx(start, i);
+
+   switch (draw->pt.user.eltSize) {
+   case 1:
+      return DRAW_GET_IDX((const uint8_t *)draw->pt.user.elts, elt_idx);
+   case 2:
+      return DRAW_GET_IDX((const uint16_t *)draw->pt.user.elts, elt_idx);
+   default:
+      return DRAW_GET_IDX((const uint32_t *)draw->pt.user.elts, elt_idx);
+   }
+}
+
+
+/**
+ * Count the unique vertices of an indexed draw, for DRAW_VCACHE_STATS.
+ * Returns false if the index range is too large to be counted.
+ */
+static bool
+vsplit_count_unique(struct vsplit_frontend *vsplit,
+                    unsigned start, unsigned count)
+{
+   const struct draw_context *draw = vsplit->draw;
+   unsigned min_index = ~0u, max_index = 0;
+
+   for (unsigned i = 0; i < count; i++) {
+      const unsigned idx = vsplit_get_elt(draw, start, i);
+      min_index = MIN2(min_index, idx);
+      max_index = MAX2(max_index, idx);
+   }
+
+   if (!count || max_index - min_index >= STATS_MAX_RANGE)
+      return false;
+
+   BITSET_WORD *seen = CALLOC(BITSET_WORDS(max_index - min_index + 1),
+                              sizeof(BITSET_WORD));
+   if (!seen)
+      return false;
+
+   for (unsigned i = 0; i < count; i++) {
+      const unsigned idx = vsplit_get_elt(draw, start, i) - min_index;
+      if (!BITSET_TEST(seen, idx)) {
+         BITSET_SET(seen, idx);
+         vsplit->stats.unique++;
+      }
+   }
+
+   FREE(seen);
+   return true;
+}
+
+
+/**
+ * Split the draw into segments, and let the middle end shade them in
+ * parallel if there are enough of them.
+ */
+static void
+vsplit_run(struct draw_pt_front_end *frontend,
+           unsigned start,
+           unsigned count)
+{
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+   struct draw_pt_middle_end *middle = vsplit->middle;
+   const bool parallel = middle->set_parallel &&
+                         count >= PARALLEL_MIN_VERTICES &&
+                         util_queue_is_initialized(&vsplit->draw->pt.vs_queue);
+
+   vsplit->stats.counting = vsplit->draw->pt.vcache_stats &&
+                            vsplit->draw->pt.user.eltSize &&
+                            vsplit_count_unique(vsplit, start, count);
+
+   if (parallel)
+      middle->set_parallel(middle, true);
+
+   vsplit->run(frontend, start, count);
+
+   if (parallel)
+      middle->set_parallel(middle, false);
+}
+
+
 static void
 vsplit_prepare(struct draw_pt_front_end *frontend,
                enum mesa_prim in_prim,
@@ -211,16 +348,16 @@ vsplit_prepare(struct draw_pt_front_end *frontend,
 
    switch (vsplit->draw->pt.user.eltSize) {
    case 0:
-      vsplit->base.run = vsplit_run_linear;
+      vsplit->run = vsplit_run_linear;
       break;
    case 1:
-      vsplit->base.run = vsplit_run_uint8;
+      vsplit->run = vsplit_run_uint8;
       break;
    case 2:
-      vsplit->base.run = vsplit_run_uint16;
+      vsplit->run = vsplit_run_uint16;
       break;
    case 4:
-      vsplit->base.run = vsplit_run_uint32;
+      vsplit->run = vsplit_run_uint32;
       break;
    default:
       assert(0);
@@ -252,6 +389,15 @@ vsplit_flush(struct draw_pt_front_end *frontend, unsigned flags)
 static void
 vsplit_destroy(struct draw_pt_front_end *frontend)
 {
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   if (vsplit->stats.unique) {
+      _debug_printf("draw: %" PRIu64 " vertex shader invocations for %" PRIu64
+                    " unique vertices of indexed draws (%.2f per vertex)\n",
+                    vsplit->stats.invocations, vsplit->stats.unique,
+                    (double)vsplit->stats.invocations / vsplit->stats.unique);
+   }
+
    FREE(frontend);
 }
 
@@ -265,10 +411,11 @@ draw_pt_vsplit(struct draw_context *draw)
       return NULL;
 
    vsplit->base.prepare = vsplit_prepare;
-   vsplit->base.run     = NULL;
+   vsplit->base.run     = vsplit_run;
    vsplit->base.flush   = vsplit_flush;
    vsplit->base.destroy = vsplit_destroy;
    vsplit->draw = draw;
+   vsplit->cache.large = draw->pt.large_vcache;
 
    for (unsigned i = 0; i < SEGMENT_SIZE; i++)
       vsplit->identity_draw_elts[i] = i;
@@ -381,6 +381,42 @@ lp_build_gather_avx2(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * 16-wide gather of 32 bit values.  There's no need for the x86 specific
+ * intrinsics here, llvm.masked.gather with an all-ones mask becomes a single
+ * vpgatherdd with AVX-512.
+ */
+static LLVMValueRef
+lp_build_gather_avx512(struct gallivm_state *gallivm,
+                       unsigned length,
+                       unsigned src_width,
+                       struct lp_type dst_type,
+                       LLVMValueRef base_ptr,
+                       LLVMValueRef offsets)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8_type = LLVMInt8TypeInContext(gallivm->context);
+   LLVMTypeRef src_type = LLVMIntTypeInContext(gallivm->context, src_width);
+   LLVMTypeRef src_vec_type = LLVMVectorType(src_type, length);
+   struct lp_type res_type = dst_type;
+   res_type.length *= length;
+
+   assert(LLVMTypeOf(base_ptr) == LLVMPointerType(i8_type, 0));
+
+   LLVMValueRef src_ptr = LLVMBuildGEP2(builder, i8_type, base_ptr,
+                                        &offsets, 1, "vector-gep");
+   src_ptr = LLVMBuildBitCast(builder, src_ptr,
+                              LLVMVectorType(LLVMPointerType(src_type, 0),
+                                             length), "");
+
+   LLVMValueRef mask = LLVMConstAllOnes(LLVMTypeOf(offsets));
+   LLVMValueRef res = lp_build_masked_gather(gallivm, length, src_width,
+                                             src_vec_type, src_ptr, mask);
+
+   return LLVMBuildBitCast(builder, res, lp_build_vec_type(gallivm, res_type), "");
+}
+
+
 /**
  * Gather elements from scatter positions in memory into a single vector.
  * Use for fetching texels from a texture.
@@ -491,6 +527,10 @@ lp_build_gather(struct gallivm_state *gallivm,
               src_width == 32 && (length == 4 || length == 8)) {
       return lp_build_gather_avx2(gallivm, length, src_width, dst_type,
                                   base_ptr, offsets);
+   } else if (util_get_cpu_caps()->has_avx512f && !need_expansion &&
+              src_width == 32 && length == 16) {
+      return lp_build_gather_avx512(gallivm, length, src_width, dst_type,
+                                    base_ptr, offsets);
    /*
     * This looks bad on paper wrt throughtput/latency on Haswell.
     * Even on Broadwell it doesn't look stellar.
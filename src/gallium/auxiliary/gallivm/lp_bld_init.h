@@ -67,6 +67,11 @@ struct gallivm_state
    LLVMBuilderRef builder;
    struct lp_cached_code *cache;
    unsigned compiled;
+   /* Compile quickly without IR optimizations, must be set before
+    * gallivm_compile_module().  Ignored by ORCJIT, and the legacy pass
+    * manager still runs its IR passes.
+    */
+   bool no_opt;
    LLVMValueRef coro_malloc_hook;
    LLVMValueRef coro_free_hook;
    LLVMValueRef debug_printf_hook;
@@ -27,6 +27,7 @@
 
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_math.h"
 #include "lp_bld.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_init.h"
@@ -68,12 +69,19 @@ unsigned lp_native_vector_width;
 unsigned
 lp_build_init_native_width(void)
 {
-   // Default to 256 until we're confident llvmpipe with 512 is as correct and not slower than 256
-   lp_native_vector_width = MIN2(util_get_cpu_caps()->max_vector_bits, 256);
-   assert(lp_native_vector_width);
-
-   lp_native_vector_width = debug_get_num_option("LP_NATIVE_VECTOR_WIDTH", lp_native_vector_width);
-   assert(lp_native_vector_width);
+   // Default to 256 until we're confident llvmpipe with 512 is as correct and not slower than 256.
+   // LP_NATIVE_VECTOR_WIDTH=512 opts in to 16-wide SoA code on AVX-512 CPUs.
+   const unsigned default_width = MIN2(util_get_cpu_caps()->max_vector_bits, 256);
+   assert(default_width);
+
+   lp_native_vector_width = debug_get_num_option("LP_NATIVE_VECTOR_WIDTH", default_width);
+   if (!util_is_power_of_two_nonzero(lp_native_vector_width) ||
+       lp_native_vector_width < 128 ||
+       lp_native_vector_width > LP_MAX_VECTOR_WIDTH) {
+      debug_printf("gallivm: invalid LP_NATIVE_VECTOR_WIDTH %u, using %u\n",
+                   lp_native_vector_width, default_width);
+      lp_native_vector_width = default_width;
+   }
 
    return lp_native_vector_width;
 }
@@ -3009,6 +3009,18 @@ bool lp_build_nir_llvm(struct lp_build_nir_context *bld_base,
 }
 
 
+static bool
+lower_tex(nir_shader *nir, const void *options)
+{
+   return nir_lower_tex(nir, options);
+}
+
+static bool
+lower_subgroups(nir_shader *nir, const void *options)
+{
+   return nir_lower_subgroups(nir, options);
+}
+
 /* do some basic opts to remove some things we don't want to see. */
 void
 lp_build_opt_nir(struct nir_shader *nir)
@@ -3033,26 +3045,28 @@ lp_build_opt_nir(struct nir_shader *nir)
 
    NIR_PASS(_, nir, nir_lower_alu);
 
-   do {
-      progress = false;
-      NIR_PASS(progress, nir, nir_opt_constant_folding);
-      NIR_PASS(progress, nir, nir_opt_algebraic);
-      NIR_PASS(progress, nir, nir_lower_pack);
-
-      nir_lower_tex_options options = { .lower_invalid_implicit_lod = true, };
-      NIR_PASS_V(nir, nir_lower_tex, &options);
-
-      const nir_lower_subgroups_options subgroups_options = {
-         .subgroup_size = lp_native_vector_width / 32,
-         .ballot_bit_size = 32,
-         .ballot_components = 1,
-         .lower_to_scalar = true,
-         .lower_subgroup_masks = true,
-         .lower_relative_shuffle = true,
-         .lower_inverse_ballot = true,
-      };
-      NIR_PASS(progress, nir, nir_lower_subgroups, &subgroups_options);
-   } while (progress);
+   static const nir_lower_tex_options lower_lod_options = {
+      .lower_invalid_implicit_lod = true,
+   };
+   const nir_lower_subgroups_options subgroups_options = {
+      .subgroup_size = lp_native_vector_width / 32,
+      .ballot_bit_size = 32,
+      .ballot_components = 1,
+      .lower_to_scalar = true,
+      .lower_subgroup_masks = true,
+      .lower_relative_shuffle = true,
+      .lower_inverse_ballot = true,
+   };
+   const nir_fixpoint_pass opt_passes[] = {
+      { NIR_FIXPOINT_PASS(nir_opt_constant_folding) },
+      { NIR_FIXPOINT_PASS(nir_opt_algebraic) },
+      { NIR_FIXPOINT_PASS(nir_lower_pack), .idempotent = true },
+      { .name = "nir_lower_tex", .pass_with_data = lower_tex,
+        .data = &lower_lod_options, .idempotent = true, .ignore_progress = true },
+      { .name = "nir_lower_subgroups", .pass_with_data = lower_subgroups,
+        .data = &subgroups_options, .idempotent = true },
+   };
+   nir_opt_fixpoint(nir, opt_passes, ARRAY_SIZE(opt_passes));
 
    do {
       progress = false;
@@ -1324,6 +1324,21 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "main-thread-busy") == 0) {
          hud_thread_busy_install(pane, name, true);
       }
+      else if (strcmp(name, "tc-batch-fill") == 0) {
+         hud_tc_counter_install(pane, name, HUD_TC_BATCH_FILL);
+      }
+      else if (strcmp(name, "tc-batch-size") == 0) {
+         hud_tc_counter_install(pane, name, HUD_TC_BATCH_SIZE);
+      }
+      else if (strcmp(name, "tc-num-syncs") == 0) {
+         hud_tc_counter_install(pane, name, HUD_TC_SYNCS);
+      }
+      else if (strcmp(name, "tc-stall-time") == 0) {
+         hud_tc_counter_install(pane, name, HUD_TC_STALL_TIME);
+      }
+      else if (strcmp(name, "tc-driver-thread-idle") == 0) {
+         hud_tc_counter_install(pane, name, HUD_TC_DRIVER_IDLE);
+      }
 #ifdef HAVE_GALLIUM_EXTRA_HUD
       else if (sscanf(name, "nic-rx-%s", arg_name) == 1) {
          hud_nic_graph_install(pane, arg_name, NIC_DIRECTION_RX);
@@ -1640,6 +1655,12 @@ print_help(struct pipe_screen *screen)
    for (i = 0; i < num_cpus; i++)
       printf("    cpu%i\n", i);
 
+   puts("    tc-batch-fill (% of the batch size, with threaded contexts)");
+   puts("    tc-batch-size");
+   puts("    tc-num-syncs");
+   puts("    tc-stall-time (waiting for an idle batch)");
+   puts("    tc-driver-thread-idle (%)");
+
    if (has_occlusion_query(screen))
       puts("    samples-passed");
    if (has_streamout(screen))
@@ -33,6 +33,7 @@
 #include "util/u_thread.h"
 #include "util/u_memory.h"
 #include "util/u_queue.h"
+#include "util/u_threaded_context.h"
 #include <stdio.h>
 #include <inttypes.h>
 #if DETECT_OS_WINDOWS
@@ -474,3 +475,100 @@ void hud_thread_counter_install(struct hud_pane *pane, const char *name,
    hud_pane_add_graph(pane, gr);
    hud_pane_set_max_value(pane, 100);
 }
+
+struct tc_counter_values {
+   int64_t time;
+   unsigned offloaded_slots;
+   uint64_t batch_capacity;
+   unsigned syncs;
+   uint64_t stall_time_ns;
+   uint64_t driver_idle_time_ns;
+};
+
+struct tc_counter_info {
+   enum hud_tc_counter counter;
+   struct tc_counter_values last;
+};
+
+static void
+query_tc_counter(struct hud_graph *gr, struct pipe_context *pipe)
+{
+   struct tc_counter_info *info = gr->query_data;
+   struct threaded_context *tc = threaded_context_from_pipe(pipe);
+
+   if (!tc)
+      return;
+
+   struct tc_counter_values cur = {
+      .time = os_time_get_nano(),
+      .offloaded_slots = p_atomic_read(&tc->num_offloaded_slots),
+      .batch_capacity = p_atomic_read(&tc->flushed_batch_capacity),
+      .syncs = p_atomic_read(&tc->num_syncs),
+      .stall_time_ns = p_atomic_read(&tc->stall_time_ns),
+      .driver_idle_time_ns = p_atomic_read(&tc->driver_idle_time_ns),
+   };
+
+   if (info->last.time) {
+      if (info->last.time + gr->pane->period*1000 > cur.time)
+         return;
+
+      uint64_t value = 0;
+
+      switch (info->counter) {
+      case HUD_TC_BATCH_FILL:
+         if (cur.batch_capacity != info->last.batch_capacity) {
+            value = (uint64_t)(cur.offloaded_slots - info->last.offloaded_slots) *
+                    100 / (cur.batch_capacity - info->last.batch_capacity);
+         }
+         break;
+      case HUD_TC_BATCH_SIZE:
+         value = tc->batch_size;
+         break;
+      case HUD_TC_SYNCS:
+         value = cur.syncs - info->last.syncs;
+         break;
+      case HUD_TC_STALL_TIME:
+         value = (cur.stall_time_ns - info->last.stall_time_ns) / 1000;
+         break;
+      case HUD_TC_DRIVER_IDLE:
+         value = (cur.driver_idle_time_ns - info->last.driver_idle_time_ns) *
+                 100 / (cur.time - info->last.time);
+         break;
+      }
+
+      hud_graph_add_value(gr, value);
+   }
+
+   info->last = cur;
+}
+
+void hud_tc_counter_install(struct hud_pane *pane, const char *name,
+                            enum hud_tc_counter counter)
+{
+   struct hud_graph *gr = CALLOC_STRUCT(hud_graph);
+   if (!gr)
+      return;
+
+   strcpy(gr->name, name);
+
+   gr->query_data = CALLOC_STRUCT(tc_counter_info);
+   if (!gr->query_data) {
+      FREE(gr);
+      return;
+   }
+
+   ((struct tc_counter_info*)gr->query_data)->counter = counter;
+   gr->query_new_value = query_tc_counter;
+
+   /* Don't use free() as our callback as that messes up Gallium's
+    * memory debugger.  Use simple free_query_data() wrapper.
+    */
+   gr->free_query_data = free_query_data;
+
+   if (counter == HUD_TC_STALL_TIME)
+      pane->type = PIPE_DRIVER_QUERY_TYPE_MICROSECONDS;
+
+   hud_pane_add_graph(pane, gr);
+   hud_pane_set_max_value(pane, counter == HUD_TC_BATCH_SIZE ?
+                                   TC_MAX_SLOTS_PER_BATCH : 100);
+}
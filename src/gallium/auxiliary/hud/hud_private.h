@@ -42,6 +42,14 @@ enum hud_counter {
    HUD_COUNTER_BATCHES,
 };
 
+enum hud_tc_counter {
+   HUD_TC_BATCH_FILL,
+   HUD_TC_BATCH_SIZE,
+   HUD_TC_SYNCS,
+   HUD_TC_STALL_TIME,
+   HUD_TC_DRIVER_IDLE,
+};
+
 struct hud_context {
    int refcount;
    bool simple;
@@ -172,6 +180,8 @@ void hud_cpu_graph_install(struct hud_pane *pane, unsigned cpu_index);
 void hud_thread_busy_install(struct hud_pane *pane, const char *name, bool main);
 void hud_thread_counter_install(struct hud_pane *pane, const char *name,
                                 enum hud_counter counter);
+void hud_tc_counter_install(struct hud_pane *pane, const char *name,
+                            enum hud_tc_counter counter);
 void hud_pipe_query_install(struct hud_batch_query_context **pbq,
                             struct hud_pane *pane,
                             const char *name,
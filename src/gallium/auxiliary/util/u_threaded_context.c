@@ -30,6 +30,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
+#include "util/os_time.h"
 #include "driver_trace/tr_context.h"
 #include "util/log.h"
 #include "util/perf/cpu_trace.h"
@@ -78,13 +79,13 @@ static void
 tc_batch_check(UNUSED struct tc_batch *batch)
 {
    tc_assert(batch->sentinel == TC_SENTINEL);
-   tc_assert(batch->num_total_slots <= TC_SLOTS_PER_BATCH);
+   tc_assert(batch->num_total_slots <= batch->tc->slots_per_batch);
 }
 
 static void
 tc_debug_check(struct threaded_context *tc)
 {
-   for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
+   for (unsigned i = 0; i < tc->num_batches; i++) {
       tc_batch_check(&tc->batch_slots[i]);
       tc_assert(tc->batch_slots[i].tc == tc);
    }
@@ -520,7 +521,7 @@ tc_batch_execute(void *job, UNUSED void *gdata, int thread_index)
        * the buffer list fences, so that the producer thread can reuse the buffer
        * list structures for the next batches without waiting.
        */
-      unsigned half_ring = TC_MAX_BUFFER_LISTS / 2;
+      unsigned half_ring = tc->num_buffer_lists / 2;
       if (batch->buffer_list_index % half_ring == half_ring - 1)
          pipe->flush(pipe, NULL, PIPE_FLUSH_ASYNC);
    } else {
@@ -536,10 +537,28 @@ tc_batch_execute(void *job, UNUSED void *gdata, int thread_index)
    batch->tc->last_completed = batch->batch_idx;
 }
 
+/* The job of the driver thread, which also measures how long that thread
+ * waited for batches.
+ */
+static void
+tc_batch_execute_queued(void *job, void *gdata, int thread_index)
+{
+   struct tc_batch *batch = job;
+   struct threaded_context *tc = batch->tc;
+   int64_t start = os_time_get_nano();
+
+   if (tc->driver_idle_since)
+      p_atomic_add(&tc->driver_idle_time_ns, start - tc->driver_idle_since);
+
+   tc_batch_execute(job, gdata, thread_index);
+
+   tc->driver_idle_since = os_time_get_nano();
+}
+
 static void
 tc_begin_next_buffer_list(struct threaded_context *tc)
 {
-   tc->next_buf_list = (tc->next_buf_list + 1) % TC_MAX_BUFFER_LISTS;
+   tc->next_buf_list = (tc->next_buf_list + 1) % tc->num_buffer_lists;
 
    tc->batch_slots[tc->next].buffer_list_index = tc->next_buf_list;
 
@@ -560,18 +579,50 @@ tc_add_call_end(struct tc_batch *next)
     * of the batch. It's for calls that always look at the next call and this
     * stops them looking farther ahead.
     */
-   assert(next->num_total_slots < TC_SLOTS_PER_BATCH);
+   assert(next->num_total_slots < next->tc->slots_per_batch);
    struct tc_call_base *call =
       (struct tc_call_base*)&next->slots[next->num_total_slots];
    call->call_id = TC_NUM_CALLS;
    call->num_slots = 1;
 }
 
+/* Adjust the size at which batches are flushed, based on how the driver
+ * thread and the application thread waited for each other since the last
+ * update:
+ * - if the driver thread is often idle, flush smaller batches, so that it
+ *   gets the calls sooner and the application executes fewer unflushed
+ *   calls itself when it syncs;
+ * - if the application thread is waiting for idle batches instead, the
+ *   driver thread is the bottleneck: flush larger batches, which lowers the
+ *   queuing overhead and lets more calls be recorded ahead.
+ */
+static void
+tc_adapt_batch_size(struct threaded_context *tc)
+{
+   int64_t now = os_time_get_nano();
+   uint64_t driver_idle_time_ns = p_atomic_read(&tc->driver_idle_time_ns);
+
+   if (tc->adapt.time) {
+      uint64_t elapsed = now - tc->adapt.time;
+      uint64_t idle = driver_idle_time_ns - tc->adapt.driver_idle_time_ns;
+      uint64_t stall = tc->stall_time_ns - tc->adapt.stall_time_ns;
+
+      if (stall * 8 > elapsed)
+         tc->batch_size = MIN2(tc->batch_size * 2, tc->slots_per_batch);
+      else if (idle * 4 > elapsed)
+         tc->batch_size = MAX2(tc->batch_size / 2, TC_MIN_SLOTS_PER_BATCH);
+   }
+
+   tc->adapt.time = now;
+   tc->adapt.driver_idle_time_ns = driver_idle_time_ns;
+   tc->adapt.stall_time_ns = tc->stall_time_ns;
+}
+
 static void
 tc_batch_flush(struct threaded_context *tc, bool full_copy)
 {
    struct tc_batch *next = &tc->batch_slots[tc->next];
-   unsigned next_id = (tc->next + 1) % TC_MAX_BATCHES;
+   unsigned next_id = (tc->next + 1) % tc->num_batches;
 
    tc_assert(next->num_total_slots != 0);
    tc_add_call_end(next);
@@ -581,6 +632,8 @@ tc_batch_flush(struct threaded_context *tc, bool full_copy)
    tc->bytes_mapped_estimate = 0;
    tc->bytes_replaced_estimate = 0;
    p_atomic_add(&tc->num_offloaded_slots, next->num_total_slots);
+   p_atomic_inc(&tc->num_flushed_batches);
+   p_atomic_add(&tc->flushed_batch_capacity, tc->batch_size);
 
    if (next->token) {
       next->token->tc = NULL;
@@ -597,12 +650,26 @@ tc_batch_flush(struct threaded_context *tc, bool full_copy)
       tc_batch_increment_renderpass_info(tc, next_id, full_copy);
    }
 
-   util_queue_add_job(&tc->queue, next, &next->fence, tc_batch_execute,
+   /* If the next batch is still queued or executing, this waits for it. */
+   struct tc_batch *following = &tc->batch_slots[next_id];
+   const bool stall = !util_queue_fence_is_signalled(&following->fence);
+   int64_t stall_start = stall ? os_time_get_nano() : 0;
+
+   util_queue_add_job(&tc->queue, next, &next->fence, tc_batch_execute_queued,
                       NULL, 0);
+
+   if (stall) {
+      util_queue_fence_wait(&following->fence);
+      p_atomic_add(&tc->stall_time_ns, os_time_get_nano() - stall_start);
+   }
+
    tc->last = tc->next;
    tc->next = next_id;
-   if (next_id == 0)
+   if (next_id == 0) {
       tc->batch_generation++;
+      if (tc->adaptive_batch_size)
+         tc_adapt_batch_size(tc);
+   }
    tc_begin_next_buffer_list(tc);
 
 }
@@ -617,10 +684,14 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
 {
    TC_TRACE_SCOPE(id);
    struct tc_batch *next = &tc->batch_slots[tc->next];
-   assert(num_slots <= TC_SLOTS_PER_BATCH - 1);
+   assert(num_slots <= tc->slots_per_batch - 1);
    tc_debug_check(tc);
 
-   if (unlikely(next->num_total_slots + num_slots > TC_SLOTS_PER_BATCH - 1)) {
+   /* A call larger than batch_size starts a new batch and may fill it up to
+    * slots_per_batch.
+    */
+   if (unlikely(next->num_total_slots + num_slots > tc->batch_size - 1 &&
+                next->num_total_slots)) {
       /* copy existing renderpass info during flush */
       tc_batch_flush(tc, true);
       next = &tc->batch_slots[tc->next];
@@ -686,7 +757,7 @@ tc_enlarge_last_mergeable_call(struct threaded_context *tc, unsigned desired_num
 
    unsigned added_slots = desired_num_slots - call->num_slots;
 
-   if (unlikely(batch->num_total_slots + added_slots > TC_SLOTS_PER_BATCH - 1))
+   if (unlikely(batch->num_total_slots + added_slots > tc->batch_size - 1))
       return false;
 
    batch->num_total_slots += added_slots;
@@ -1052,7 +1123,7 @@ tc_is_buffer_busy(struct threaded_context *tc, struct threaded_resource *tbuf,
 
    uint32_t id_hash = tbuf->buffer_id_unique & TC_BUFFER_ID_MASK;
 
-   for (unsigned i = 0; i < TC_MAX_BUFFER_LISTS; i++) {
+   for (unsigned i = 0; i < tc->num_buffer_lists; i++) {
       struct tc_buffer_list *buf_list = &tc->buffer_lists[i];
 
       /* If the buffer is referenced by a batch that hasn't been flushed (by tc or the driver),
@@ -3767,7 +3838,7 @@ tc_call_draw_single(struct pipe_context *pipe, void *call)
    if (next->base.call_id == TC_CALL_draw_single) {
       if (is_next_call_a_mergeable_draw(first, next)) {
          /* The maximum number of merged draws is given by the batch size. */
-         struct pipe_draw_start_count_bias multi[TC_SLOTS_PER_BATCH / call_size(tc_draw_single)];
+         struct pipe_draw_start_count_bias multi[TC_MAX_SLOTS_PER_BATCH / call_size(tc_draw_single)];
          unsigned num_draws = 2;
          bool index_bias_varies = first->index_bias != next->index_bias;
 
@@ -4027,10 +4098,10 @@ tc_draw_multi(struct pipe_context *_pipe, const struct pipe_draw_info *info,
    while (num_draws) {
       struct tc_batch *next = &tc->batch_slots[tc->next];
 
-      int nb_slots_left = TC_SLOTS_PER_BATCH - 1 - next->num_total_slots;
+      int nb_slots_left = (int)tc->batch_size - 1 - next->num_total_slots;
       /* If there isn't enough place for one draw, try to fill the next one */
       if (nb_slots_left < SLOTS_FOR_ONE_DRAW)
-         nb_slots_left = TC_SLOTS_PER_BATCH - 1;
+         nb_slots_left = tc->batch_size - 1;
       const int size_left_bytes = nb_slots_left * sizeof(struct tc_call_base);
 
       /* How many draws can we fit in the current batch */
@@ -4096,10 +4167,10 @@ tc_draw_user_indices_multi(struct pipe_context *_pipe,
    while (num_draws) {
       struct tc_batch *next = &tc->batch_slots[tc->next];
 
-      int nb_slots_left = TC_SLOTS_PER_BATCH - 1 - next->num_total_slots;
+      int nb_slots_left = (int)tc->batch_size - 1 - next->num_total_slots;
       /* If there isn't enough place for one draw, try to fill the next one */
       if (nb_slots_left < SLOTS_FOR_ONE_DRAW)
-         nb_slots_left = TC_SLOTS_PER_BATCH - 1;
+         nb_slots_left = tc->batch_size - 1;
       const int size_left_bytes = nb_slots_left * sizeof(struct tc_call_base);
 
       /* How many draws can we fit in the current batch */
@@ -4295,7 +4366,7 @@ tc_call_draw_vstate_single(struct pipe_context *pipe, void *call)
    /* If at least 2 consecutive draw calls can be merged... */
    if (is_next_call_a_mergeable_draw_vstate(first, next)) {
       /* The maximum number of merged draws is given by the batch size. */
-      struct pipe_draw_start_count_bias draws[TC_SLOTS_PER_BATCH /
+      struct pipe_draw_start_count_bias draws[TC_MAX_SLOTS_PER_BATCH /
                                               call_size(tc_draw_vstate_single)];
       unsigned num_draws = 2;
 
@@ -4391,10 +4462,10 @@ tc_draw_vertex_state(struct pipe_context *_pipe,
    while (num_draws) {
       struct tc_batch *next = &tc->batch_slots[tc->next];
 
-      int nb_slots_left = TC_SLOTS_PER_BATCH - 1 - next->num_total_slots;
+      int nb_slots_left = (int)tc->batch_size - 1 - next->num_total_slots;
       /* If there isn't enough place for one draw, try to fill the next one */
       if (nb_slots_left < slots_for_one_draw)
-         nb_slots_left = TC_SLOTS_PER_BATCH - 1;
+         nb_slots_left = tc->batch_size - 1;
       const int size_left_bytes = nb_slots_left * sizeof(struct tc_call_base);
 
       /* How many draws can we fit in the current batch */
@@ -5137,13 +5208,16 @@ tc_destroy(struct pipe_context *_pipe)
    if (util_queue_is_initialized(&tc->queue)) {
       util_queue_destroy(&tc->queue);
 
-      for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
+      for (unsigned i = 0; i < tc->num_batches; i++) {
          util_queue_fence_destroy(&tc->batch_slots[i].fence);
          util_dynarray_fini(&tc->batch_slots[i].renderpass_infos);
          assert(!tc->batch_slots[i].token);
       }
    }
 
+   for (unsigned i = 0; i < tc->num_batches; i++)
+      FREE(tc->batch_slots[i].slots);
+
    slab_destroy_child(&tc->pool_transfers);
    assert(tc->batch_slots[tc->next].num_total_slots == 0);
    pipe->destroy(pipe);
@@ -5243,15 +5317,35 @@ threaded_context_create(struct pipe_context *pipe,
 
    tc->use_forced_staging_uploads = true;
 
+   tc->num_batches = CLAMP(debug_get_num_option("GALLIUM_THREAD_BATCHES",
+                                                TC_DEFAULT_BATCHES),
+                           3, TC_MAX_BATCHES);
+   tc->num_buffer_lists = tc->num_batches * TC_BUFFER_LISTS_PER_BATCH;
+   tc->adaptive_batch_size =
+      debug_get_bool_option("GALLIUM_THREAD_ADAPTIVE_BATCHES", false);
+   tc->batch_size = CLAMP(debug_get_num_option("GALLIUM_THREAD_BATCH_SLOTS",
+                                               TC_SLOTS_PER_BATCH),
+                          TC_MIN_SLOTS_PER_BATCH, TC_MAX_SLOTS_PER_BATCH);
+   /* Adaptive batches start at the configured size, but can grow. */
+   tc->slots_per_batch = tc->adaptive_batch_size ? TC_MAX_SLOTS_PER_BATCH :
+                                                   tc->batch_size;
+
+   for (unsigned i = 0; i < tc->num_batches; i++) {
+      tc->batch_slots[i].slots =
+         MALLOC(tc->slots_per_batch * sizeof(tc->batch_slots[i].slots[0]));
+      if (!tc->batch_slots[i].slots)
+         goto fail;
+   }
+
    /* The queue size is the number of batches "waiting". Batches are removed
     * from the queue before being executed, so keep one tc_batch slot for that
     * execution. Also, keep one unused slot for an unflushed batch.
     */
-   if (!util_queue_init(&tc->queue, "gdrv", TC_MAX_BATCHES - 2, 1, 0, NULL))
+   if (!util_queue_init(&tc->queue, "gdrv", tc->num_batches - 2, 1, 0, NULL))
       goto fail;
 
    tc->last_completed = -1;
-   for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
+   for (unsigned i = 0; i < tc->num_batches; i++) {
 #if !defined(NDEBUG) && TC_DEBUG >= 1
       tc->batch_slots[i].sentinel = TC_SENTINEL;
 #endif
@@ -5435,6 +5529,16 @@ fail:
    return NULL;
 }
 
+/**
+ * Return the threaded_context wrapping a pipe_context, or NULL if the
+ * context isn't threaded.
+ */
+struct threaded_context *
+threaded_context_from_pipe(struct pipe_context *pipe)
+{
+   return pipe && pipe->destroy == tc_destroy ? threaded_context(pipe) : NULL;
+}
+
 void
 threaded_context_init_bytes_mapped_limit(struct threaded_context *tc, unsigned divisor)
 {
@@ -236,27 +236,39 @@ struct tc_unflushed_batch_token;
 /* Size of the queue = number of batch slots in memory.
  * - 1 batch is always idle and records new commands
  * - 1 batch is being executed
- * so the queue size is TC_MAX_BATCHES - 2 = number of waiting batches.
+ * so the queue size is the number of batches - 2 = number of waiting batches.
  *
  * Use a size as small as possible for low CPU L2 cache usage but large enough
  * so that the queue isn't stalled too often for not having enough idle batch
  * slots.
+ *
+ * The number of batches can be changed with GALLIUM_THREAD_BATCHES, up to
+ * TC_MAX_BATCHES.
  */
-#define TC_MAX_BATCHES        10
+#define TC_DEFAULT_BATCHES    10
+#define TC_MAX_BATCHES        16
 
 /* The size of one batch. Non-trivial calls (i.e. not setting a CSO pointer)
  * can occupy multiple call slots.
  *
  * The idea is to have batches as small as possible but large enough so that
  * the queuing and mutex overhead is negligible.
+ *
+ * The size can be changed with GALLIUM_THREAD_BATCH_SLOTS, between
+ * TC_MIN_SLOTS_PER_BATCH and TC_MAX_SLOTS_PER_BATCH.  With
+ * GALLIUM_THREAD_ADAPTIVE_BATCHES, batches are flushed when they reach a
+ * size that is adjusted within these bounds, see tc_adapt_batch_size().
  */
-#define TC_SLOTS_PER_BATCH    1536
+#define TC_SLOTS_PER_BATCH     1536
+#define TC_MIN_SLOTS_PER_BATCH 256
+#define TC_MAX_SLOTS_PER_BATCH 4096
 
 /* The buffer list queue is much deeper than the batch queue because buffer
  * lists need to stay around until the driver internally flushes its command
  * buffer.
  */
-#define TC_MAX_BUFFER_LISTS   (TC_MAX_BATCHES * 4)
+#define TC_BUFFER_LISTS_PER_BATCH 4
+#define TC_MAX_BUFFER_LISTS   (TC_MAX_BATCHES * TC_BUFFER_LISTS_PER_BATCH)
 
 /* This mask is used to get a hash of a buffer ID. It's also the bit size of
  * the buffer list - 1. It must be 2^n - 1. The size should be as low as
@@ -528,7 +540,8 @@ struct tc_batch {
    bool first_set_fb;
    uint8_t batch_idx;
    struct tc_unflushed_batch_token *token;
-   uint64_t slots[TC_SLOTS_PER_BATCH];
+   /* threaded_context::slots_per_batch call slots */
+   uint64_t *slots;
    struct util_dynarray renderpass_infos;
 };
 
@@ -590,6 +603,32 @@ struct threaded_context {
    unsigned num_offloaded_slots;
    unsigned num_direct_slots;
    unsigned num_syncs;
+   /* Batches sent to the driver thread, and the sum of their flush sizes */
+   unsigned num_flushed_batches;
+   uint64_t flushed_batch_capacity;
+   /* Time the application thread waited for an idle batch */
+   uint64_t stall_time_ns;
+   /* Time the driver thread waited for a batch, updated by that thread */
+   uint64_t driver_idle_time_ns;
+   int64_t driver_idle_since;
+
+   /* The batches are allocated with slots_per_batch slots, but flushed
+    * when they reach batch_size slots.
+    */
+   unsigned num_batches;
+   unsigned num_buffer_lists;
+   unsigned slots_per_batch;
+   unsigned batch_size;
+
+   /* GALLIUM_THREAD_ADAPTIVE_BATCHES: counters at the last batch size
+    * update.
+    */
+   bool adaptive_batch_size;
+   struct {
+      int64_t time;
+      uint64_t driver_idle_time_ns;
+      uint64_t stall_time_ns;
+   } adapt;
 
    bool use_forced_staging_uploads;
    bool add_all_gfx_bindings_to_buffer_list;
@@ -710,6 +749,9 @@ threaded_context_create(struct pipe_context *pipe,
 void
 threaded_context_init_bytes_mapped_limit(struct threaded_context *tc, unsigned divisor);
 
+struct threaded_context *
+threaded_context_from_pipe(struct pipe_context *pipe);
+
 void
 threaded_context_flush(struct pipe_context *_pipe,
                        struct tc_unflushed_batch_token *token,
@@ -514,6 +514,53 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Return the lower (half = 0) or upper (half = 1) half of a vector,
+ * or NULL for a NULL vector.
+ */
+static LLVMValueRef
+extract_half(struct gallivm_state *gallivm, LLVMValueRef vec, unsigned half)
+{
+   if (!vec)
+      return NULL;
+
+   unsigned length = LLVMGetVectorSize(LLVMTypeOf(vec)) / 2;
+   return lp_build_extract_range(gallivm, vec, half * length, length);
+}
+
+
+/**
+ * Concatenate two vectors of the same type.
+ */
+static LLVMValueRef
+concat_halves(struct gallivm_state *gallivm, LLVMValueRef lo, LLVMValueRef hi)
+{
+   LLVMValueRef shuffles[LP_MAX_VECTOR_LENGTH];
+   unsigned length = LLVMGetVectorSize(LLVMTypeOf(lo)) * 2;
+
+   assert(length <= ARRAY_SIZE(shuffles));
+   for (unsigned i = 0; i < length; i++) {
+      shuffles[i] = lp_build_const_int32(gallivm, i);
+   }
+   return LLVMBuildShuffleVector(gallivm->builder, lo, hi,
+                                 LLVMConstVector(shuffles, length), "");
+}
+
+
+/**
+ * Loop counter for one 8-wide half of a 16-wide vector.
+ */
+static LLVMValueRef
+half_loop_counter(struct gallivm_state *gallivm, LLVMValueRef loop_counter,
+                  unsigned half)
+{
+   LLVMValueRef counter = LLVMBuildShl(gallivm->builder, loop_counter,
+                                       lp_build_const_int32(gallivm, 1), "");
+   return LLVMBuildAdd(gallivm->builder, counter,
+                       lp_build_const_int32(gallivm, half), "");
+}
+
+
 /**
  * Load depth/stencil values.
  * The stored values are linear, swizzle them.
@@ -549,6 +596,34 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
 
    LLVMTypeRef zs_dst_type = lp_build_vec_type(gallivm, zs_load_type);
 
+   if (z_src_type.length == 16) {
+      /*
+       * 16-wide vectors cover the whole 4x4 block, with quads 0 and 1 in
+       * the lower half and quads 2 and 3 in the upper half.  Each half has
+       * the same layout as an 8-wide vector, so just do two 8-wide loads.
+       */
+      struct lp_type half_type = z_src_type;
+      LLVMValueRef z_half[2], s_half[2];
+
+      half_type.length = 8;
+      for (unsigned h = 0; h < (is_1d ? 1 : 2); h++) {
+         lp_build_depth_stencil_load_swizzled(gallivm, half_type, format_desc,
+                                              is_1d, depth_ptr, depth_stride,
+                                              &z_half[h], &s_half[h],
+                                              half_loop_counter(gallivm,
+                                                                loop_counter,
+                                                                h));
+      }
+      if (is_1d) {
+         z_half[1] = LLVMGetUndef(LLVMTypeOf(z_half[0]));
+         s_half[1] = LLVMGetUndef(LLVMTypeOf(s_half[0]));
+      }
+
+      *z_fb = concat_halves(gallivm, z_half[0], z_half[1]);
+      *s_fb = concat_halves(gallivm, s_half[0], s_half[1]);
+      return;
+   }
+
    if (z_src_type.length == 4) {
       LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
                                           lp_build_const_int32(gallivm, 1), "");
@@ -691,6 +766,27 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
    struct lp_type z_type = zs_type;
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /* See lp_build_depth_stencil_load_swizzled() */
+      struct lp_type half_type = z_src_type;
+
+      half_type.length = 8;
+      for (unsigned h = 0; h < (is_1d ? 1 : 2); h++) {
+         lp_build_depth_stencil_write_swizzled(gallivm, half_type, format_desc,
+                                               is_1d,
+                                               extract_half(gallivm, mask_value, h),
+                                               extract_half(gallivm, z_fb, h),
+                                               extract_half(gallivm, s_fb, h),
+                                               half_loop_counter(gallivm,
+                                                                 loop_counter,
+                                                                 h),
+                                               depth_ptr, depth_stride,
+                                               extract_half(gallivm, z_value, h),
+                                               extract_half(gallivm, s_value, h));
+      }
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
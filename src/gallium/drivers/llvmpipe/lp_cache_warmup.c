@@ -0,0 +1,271 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Shader cache warm-up.
+ *
+ * The disk cache keys of all the shader variants an application uses are
+ * recorded in the disk cache itself, under a key derived from the process
+ * name.  When the next instance of the application creates its screen, a
+ * background thread reads that list and loads the cached objects into
+ * memory, so the first lookups of those variants don't have to go to the
+ * disk.
+ *
+ * The cached objects can't be linked ahead of time, as MCJIT needs the IR
+ * module generated from the shader and its state, which only exists once
+ * the application creates the shader.
+ */
+
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "util/set.h"
+#include "util/u_atomic.h"
+#include "util/u_process.h"
+#include "util/u_queue.h"
+#include "lp_cache_warmup.h"
+
+
+/** Max number of variants recorded per application */
+#define LP_CACHE_WARMUP_MAX_KEYS 4096
+
+/** Max amount of cached objects held in memory */
+#define LP_CACHE_WARMUP_MAX_SIZE (64 * 1024 * 1024)
+
+
+struct lp_cache_warmup_blob
+{
+   void *data;
+   size_t size;
+};
+
+
+struct lp_cache_warmup
+{
+   struct disk_cache *cache;
+
+   /** Where the list of used variants is stored */
+   cache_key list_key;
+
+   struct util_queue queue;
+   struct util_queue_fence fence;
+   bool exiting;
+
+   mtx_t mutex;
+
+   /** The stored list */
+   uint8_t *list;
+   unsigned list_count;
+
+   /** Keys of the variants in the list, or used in this run */
+   struct set *used;
+   /** Whether 'used' differs from the stored list */
+   bool dirty;
+
+   /** Keys of the variants used in this run */
+   struct set *requested;
+
+   /** Objects loaded ahead of time, cache_key -> lp_cache_warmup_blob */
+   struct hash_table *prefetched;
+   size_t prefetched_size;
+};
+
+
+static uint32_t
+key_hash(const void *key)
+{
+   /* The keys are SHA-1 hashes already */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof hash);
+   return hash;
+}
+
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+
+static void
+prefetch(void *data, void *gdata, int thread_index)
+{
+   struct lp_cache_warmup *warmup = data;
+
+   for (unsigned i = 0; i < warmup->list_count; i++) {
+      const uint8_t *key = warmup->list + i * CACHE_KEY_SIZE;
+
+      mtx_lock(&warmup->mutex);
+      const bool skip = p_atomic_read(&warmup->exiting) ||
+         warmup->prefetched_size >= LP_CACHE_WARMUP_MAX_SIZE ||
+         _mesa_set_search(warmup->requested, key);
+      mtx_unlock(&warmup->mutex);
+
+      if (skip)
+         continue;
+
+      size_t size;
+      void *blob = disk_cache_get(warmup->cache, key, &size);
+
+      mtx_lock(&warmup->mutex);
+      if (!blob) {
+         /* Evicted from the disk cache, drop it from the list */
+         _mesa_set_remove_key(warmup->used, key);
+         warmup->dirty = true;
+      } else if (!_mesa_set_search(warmup->requested, key)) {
+         struct lp_cache_warmup_blob *entry =
+            ralloc(warmup, struct lp_cache_warmup_blob);
+         entry->data = blob;
+         entry->size = size;
+         _mesa_hash_table_insert(warmup->prefetched, key, entry);
+         warmup->prefetched_size += size;
+         blob = NULL;
+      }
+      mtx_unlock(&warmup->mutex);
+
+      free(blob);
+   }
+}
+
+
+struct lp_cache_warmup *
+lp_cache_warmup_create(struct disk_cache *cache)
+{
+   const char *process_name = util_get_process_name();
+   if (!cache || !process_name)
+      return NULL;
+
+   struct lp_cache_warmup *warmup = rzalloc(NULL, struct lp_cache_warmup);
+   if (!warmup)
+      return NULL;
+
+   warmup->cache = cache;
+   warmup->used = _mesa_set_create(warmup, key_hash, key_equal);
+   warmup->requested = _mesa_set_create(warmup, key_hash, key_equal);
+   warmup->prefetched = _mesa_hash_table_create(warmup, key_hash, key_equal);
+   (void) mtx_init(&warmup->mutex, mtx_plain);
+
+   char name[256];
+   snprintf(name, sizeof(name), "llvmpipe warm-up list: %s", process_name);
+   disk_cache_compute_key(cache, name, strlen(name), warmup->list_key);
+
+   /* The list itself is small, only the objects are loaded in the
+    * background.
+    */
+   size_t list_size;
+   warmup->list = disk_cache_get(cache, warmup->list_key, &list_size);
+   if (warmup->list) {
+      warmup->list_count = MIN2(list_size / CACHE_KEY_SIZE,
+                                LP_CACHE_WARMUP_MAX_KEYS);
+      for (unsigned i = 0; i < warmup->list_count; i++)
+         _mesa_set_add(warmup->used, warmup->list + i * CACHE_KEY_SIZE);
+   }
+
+   util_queue_fence_init(&warmup->fence);
+   if (warmup->list_count &&
+       util_queue_init(&warmup->queue, "lpwarm", 1, 1,
+                       UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, NULL)) {
+      util_queue_add_job(&warmup->queue, warmup, &warmup->fence,
+                         prefetch, NULL, 0);
+   }
+
+   return warmup;
+}
+
+
+/**
+ * Store the list of used variants if it changed, and free everything.
+ */
+void
+lp_cache_warmup_destroy(struct lp_cache_warmup *warmup)
+{
+   if (!warmup)
+      return;
+
+   p_atomic_set(&warmup->exiting, true);
+   if (util_queue_is_initialized(&warmup->queue)) {
+      util_queue_fence_wait(&warmup->fence);
+      util_queue_destroy(&warmup->queue);
+   }
+   util_queue_fence_destroy(&warmup->fence);
+
+   if (warmup->dirty) {
+      const unsigned count = MIN2(warmup->used->entries,
+                                  LP_CACHE_WARMUP_MAX_KEYS);
+      uint8_t *list = malloc(count * CACHE_KEY_SIZE);
+      if (list) {
+         unsigned i = 0;
+         set_foreach(warmup->used, entry) {
+            if (i == count)
+               break;
+            memcpy(list + i++ * CACHE_KEY_SIZE, entry->key, CACHE_KEY_SIZE);
+         }
+         disk_cache_put(warmup->cache, warmup->list_key, list,
+                        count * CACHE_KEY_SIZE, NULL);
+         free(list);
+      }
+   }
+
+   hash_table_foreach(warmup->prefetched, entry) {
+      struct lp_cache_warmup_blob *blob = entry->data;
+      free(blob->data);
+   }
+
+   free(warmup->list);
+   mtx_destroy(&warmup->mutex);
+   ralloc_free(warmup);
+}
+
+
+/**
+ * Record that a variant is used by the application, either found in or
+ * added to the disk cache.
+ */
+void
+lp_cache_warmup_record(struct lp_cache_warmup *warmup, const cache_key key)
+{
+   if (!warmup)
+      return;
+
+   mtx_lock(&warmup->mutex);
+   if (!_mesa_set_search(warmup->requested, key)) {
+      void *key_copy = ralloc_memdup(warmup, key, CACHE_KEY_SIZE);
+      _mesa_set_add(warmup->requested, key_copy);
+
+      if (!_mesa_set_search(warmup->used, key)) {
+         _mesa_set_add(warmup->used, key_copy);
+         warmup->dirty = true;
+      }
+   }
+   mtx_unlock(&warmup->mutex);
+}
+
+
+/**
+ * Look up an object loaded ahead of time.  The caller takes ownership of the
+ * returned data, which must be freed with free().
+ */
+void *
+lp_cache_warmup_find(struct lp_cache_warmup *warmup, const cache_key key,
+                     size_t *size)
+{
+   void *data = NULL;
+
+   if (!warmup)
+      return NULL;
+
+   mtx_lock(&warmup->mutex);
+   struct hash_entry *entry =
+      _mesa_hash_table_search(warmup->prefetched, key);
+   if (entry) {
+      struct lp_cache_warmup_blob *blob = entry->data;
+      data = blob->data;
+      *size = blob->size;
+      warmup->prefetched_size -= blob->size;
+      _mesa_hash_table_remove(warmup->prefetched, entry);
+   }
+   mtx_unlock(&warmup->mutex);
+
+   return data;
+}
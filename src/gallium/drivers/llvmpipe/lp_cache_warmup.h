@@ -0,0 +1,25 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LP_CACHE_WARMUP_H
+#define LP_CACHE_WARMUP_H
+
+#include "util/disk_cache.h"
+
+struct lp_cache_warmup;
+
+struct lp_cache_warmup *
+lp_cache_warmup_create(struct disk_cache *cache);
+
+void
+lp_cache_warmup_destroy(struct lp_cache_warmup *warmup);
+
+void
+lp_cache_warmup_record(struct lp_cache_warmup *warmup, const cache_key key);
+
+void *
+lp_cache_warmup_find(struct lp_cache_warmup *warmup, const cache_key key,
+                     size_t *size);
+
+#endif /* LP_CACHE_WARMUP_H */
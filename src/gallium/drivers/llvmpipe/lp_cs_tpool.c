@@ -30,6 +30,8 @@
 
 #include "util/u_thread.h"
 #include "util/u_memory.h"
+#include "util/u_debug.h"
+#include "util/thread_sched.h"
 #include "lp_cs_tpool.h"
 
 static int
@@ -96,11 +98,21 @@ lp_cs_tpool_create(unsigned num_threads)
 
    list_inithead(&pool->workqueue);
    assert (num_threads <= LP_MAX_THREADS);
+
+   if (num_threads) {
+      pool->threads = CALLOC(num_threads, sizeof(thrd_t));
+      if (!pool->threads)
+         num_threads = 0;
+   }
+
+   const bool numa_pin = debug_get_bool_option("LP_NUMA_PIN", true);
    for (unsigned i = 0; i < num_threads; i++) {
       if (thrd_success != u_thread_create(pool->threads + i, lp_cs_tpool_worker, pool)) {
          num_threads = i;  /* previous thread is max */
          break;
       }
+      if (numa_pin)
+         util_thread_sched_pin_to_numa_node(pool->threads[i], i, num_threads);
    }
    pool->num_threads = num_threads;
    return pool;
@@ -123,6 +135,7 @@ lp_cs_tpool_destroy(struct lp_cs_tpool *pool)
 
    cnd_destroy(&pool->new_work);
    mtx_destroy(&pool->m);
+   FREE(pool->threads);
    FREE(pool);
 }
 
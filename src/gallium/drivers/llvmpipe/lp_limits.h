@@ -66,7 +66,18 @@
 
 #define LP_MAX_SAMPLES 4
 
-#define LP_MAX_THREADS 32
+/**
+ * Upper bound on the number of rasterizer and compute threads, same as
+ * UTIL_MAX_CPUS.  Per-thread state is allocated for the number of threads
+ * actually in use.
+ */
+#define LP_MAX_THREADS 1024
+
+/**
+ * Max number of threads compiling optimized fragment shader variants in the
+ * background, see LP_ASYNC_FS_COMPILE.
+ */
+#define LP_MAX_ASYNC_FS_THREADS 4
 
 
 /**
@@ -121,6 +121,8 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
+      debug_printf("llvmpipe: nr_async_fs_compiles:         %u\n", lp_count.nr_async_fs_compiles);
+      debug_printf("llvmpipe: max_async_fs_queue_depth:     %u\n", lp_count.max_async_fs_queue_depth);
 
    }
 }
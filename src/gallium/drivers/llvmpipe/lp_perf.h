@@ -64,6 +64,8 @@ struct lp_counters
    unsigned nr_non_empty_4;
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
+   unsigned nr_async_fs_compiles;  /**< draws not stalled by optimization */
+   unsigned max_async_fs_queue_depth;
 
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
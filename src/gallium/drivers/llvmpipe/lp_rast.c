@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+#include <inttypes.h>
 #include <limits.h>
 #include "util/u_memory.h"
 #include "util/u_math.h"
@@ -33,6 +34,7 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/thread_sched.h"
 #include "util/u_memset.h"
 #include "util/os_time.h"
 
@@ -78,7 +80,7 @@ lp_rast_begin(struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __func__);
 
    lp_scene_begin_rasterization(scene);
-   lp_scene_bin_iter_begin(scene);
+   lp_scene_bin_iter_begin(scene, rast->num_threads);
 }
 
 
@@ -1060,12 +1062,20 @@ rasterize_scene(struct lp_rasterizer_task *task,
       /* loop over scene bins, rasterize each */
       struct cmd_bin *bin;
       int i, j;
+      bool stolen;
+      int64_t start = os_time_get_nano();
 
       assert(scene);
-      while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-         if (!is_empty_bin(bin))
+      while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                           &i, &j, &stolen))) {
+         if (!is_empty_bin(bin)) {
             rasterize_bin(task, bin, i, j);
+            task->bins_rasterized++;
+            task->bins_stolen += stolen;
+         }
       }
+
+      task->busy_time += os_time_get_nano() - start;
    }
 
 #if LP_BUILD_FORMAT_CACHE_DEBUG
@@ -1231,8 +1241,17 @@ thread_function(void *init_data)
 static void
 create_rast_threads(struct lp_rasterizer *rast)
 {
+   const unsigned num_threads = rast->num_threads;
+
+   /* Threads with neighbouring indices rasterize neighbouring tiles, so
+    * they are pinned to NUMA nodes in contiguous blocks.  Their per-thread
+    * buffers are first touched by the pinned thread and thus end up in
+    * node-local memory.
+    */
+   const bool numa_pin = debug_get_bool_option("LP_NUMA_PIN", true);
+
    /* NOTE: if num_threads is zero, we won't use any threads */
-   for (unsigned i = 0; i < rast->num_threads; i++) {
+   for (unsigned i = 0; i < num_threads; i++) {
       util_semaphore_init(&rast->tasks[i].work_ready, 0);
       util_semaphore_init(&rast->tasks[i].work_done, 0);
 #ifdef _WIN32
@@ -1243,6 +1262,8 @@ create_rast_threads(struct lp_rasterizer *rast)
          rast->num_threads = i; /* previous thread is max */
          break;
       }
+      if (numa_pin)
+         util_thread_sched_pin_to_numa_node(rast->threads[i], i, num_threads);
    }
 }
 
@@ -1265,6 +1286,12 @@ lp_rast_create(unsigned num_threads)
       goto no_full_scenes;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof(struct lp_rasterizer_task));
+   rast->threads = CALLOC(MAX2(1, num_threads), sizeof(thrd_t));
+   if (!rast->tasks || !rast->threads) {
+      goto no_tasks;
+   }
+
    for (unsigned i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
@@ -1292,12 +1319,15 @@ lp_rast_create(unsigned num_threads)
    return rast;
 
 no_thread_data_cache:
-   for (unsigned i = 0; i < MAX2(1, rast->num_threads); i++) {
+   for (unsigned i = 0; i < MAX2(1, num_threads); i++) {
       if (rast->tasks[i].thread_data.cache) {
          align_free(rast->tasks[i].thread_data.cache);
       }
    }
 
+no_tasks:
+   FREE(rast->tasks);
+   FREE(rast->threads);
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
@@ -1346,6 +1376,16 @@ lp_rast_destroy(struct lp_rasterizer *rast)
       util_semaphore_destroy(&rast->tasks[i].exited);
 #endif
    }
+   if (LP_DEBUG & DEBUG_SCHED) {
+      for (unsigned i = 0; i < MAX2(1, rast->num_threads); i++) {
+         const struct lp_rasterizer_task *task = &rast->tasks[i];
+         debug_printf("llvmpipe-%u: %"PRIu64" bins, %"PRIu64" stolen, "
+                      "busy %.3f ms\n", task->thread_index,
+                      task->bins_rasterized, task->bins_stolen,
+                      task->busy_time / 1000000.0);
+      }
+   }
+
    for (unsigned i = 0; i < MAX2(1, rast->num_threads); i++) {
       align_free(rast->tasks[i].thread_data.cache);
    }
@@ -1359,6 +1399,8 @@ lp_rast_destroy(struct lp_rasterizer *rast)
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->tasks);
+   FREE(rast->threads);
    FREE(rast);
 }
 
@@ -100,6 +100,11 @@ struct lp_rasterizer_task
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** Tile scheduling statistics, reported with LP_DEBUG=sched */
+   uint64_t bins_rasterized;
+   uint64_t bins_stolen;
+   int64_t busy_time;  /**< total, in nanoseconds */
+
    util_semaphore work_ready;
    util_semaphore work_done;
 #ifdef _WIN32
@@ -125,10 +130,10 @@ struct lp_rasterizer
    struct lp_scene *curr_scene;
 
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
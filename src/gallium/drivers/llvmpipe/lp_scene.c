@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+#include "util/u_atomic.h"
 #include "util/u_framebuffer.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -73,6 +74,14 @@ lp_scene_create(struct lp_setup_context *setup)
    scene->setup = setup;
    scene->data.head = &scene->data.first;
 
+   scene->max_bin_ranges = MAX2(1, setup->num_threads);
+   scene->bin_ranges = CALLOC(scene->max_bin_ranges,
+                              sizeof(struct lp_scene_bin_range));
+   if (!scene->bin_ranges) {
+      slab_free_st(&setup->scene_slab, scene);
+      return NULL;
+   }
+
    (void) mtx_init(&scene->mutex, mtx_plain);
 
 #if MESA_DEBUG
@@ -103,6 +112,7 @@ lp_scene_destroy(struct lp_scene *scene)
    lp_scene_end_rasterization(scene);
    mtx_destroy(&scene->mutex);
    free(scene->tiles);
+   FREE(scene->bin_ranges);
    assert(scene->data.head == &scene->data.first);
    slab_free_st(&scene->setup->scene_slab, scene);
 }
@@ -146,6 +156,9 @@ lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y)
 {
    struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
 
+   if (scene->reset_bins)
+      BITSET_SET(scene->reset_bins, scene->tiles_x * y + x);
+
    bin->last_state = NULL;
    bin->head = bin->tail;
    if (bin->tail) {
@@ -548,60 +561,202 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 }
 
 
-/** advance curr_x,y to the next bin */
-static bool
-next_bin(struct lp_scene *scene)
+/**
+ * Split the scene's bins into one contiguous range per rasterizer thread.
+ * Neighbouring tiles thus tend to be rendered by the same thread, which
+ * helps cache reuse of shared scene data and framebuffer rows.
+ */
+void
+lp_scene_bin_iter_begin(struct lp_scene *scene, unsigned num_threads)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
+   const unsigned num_bins = lp_scene_get_num_bins(scene);
+   const unsigned num_ranges = CLAMP(num_threads, 1, scene->max_bin_ranges);
+
+   for (unsigned i = 0; i < num_ranges; i++) {
+      scene->bin_ranges[i].next = num_bins * i / num_ranges;
+      scene->bin_ranges[i].end = num_bins * (i + 1) / num_ranges;
    }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return false;
+   scene->num_bin_ranges = num_ranges;
+}
+
+
+/**
+ * Return pointer to next bin to be rendered by the given thread.
+ * Multiple rendering threads will call this function to get a chunk
+ * of work (a bin) to work on.  A thread first drains its own range of
+ * bins, then steals from the ranges of the other threads.  No locks are
+ * taken: each bin index is handed out exactly once by the atomic
+ * increment, and indices past the end of a range are simply discarded.
+ *
+ * \param stolen  returns whether the bin came from another thread's range
+ */
+struct cmd_bin *
+lp_scene_bin_iter_next(struct lp_scene *scene, unsigned thread_index,
+                       int *x, int *y, bool *stolen)
+{
+   const unsigned num_ranges = scene->num_bin_ranges;
+
+   for (unsigned i = 0; i < num_ranges; i++) {
+      struct lp_scene_bin_range *range =
+         &scene->bin_ranges[(thread_index + i) % num_ranges];
+
+      /* Avoid bumping the counter of ranges which are already done */
+      if (p_atomic_read(&range->next) >= range->end)
+         continue;
+
+      int idx = p_atomic_inc_return(&range->next) - 1;
+      if (idx < range->end) {
+         *x = idx % scene->tiles_x;
+         *y = idx / scene->tiles_x;
+         *stolen = i != 0;
+         return &scene->tiles[idx];
+      }
    }
-   return true;
+
+   return NULL;
+}
+
+
+/**
+ * Initialize the private scene of a binning thread.  Only the bins, the
+ * data blocks and the state needed by triangle setup are used.
+ */
+void
+lp_scene_init_thread_scene(struct lp_scene *tscene,
+                           struct lp_setup_context *setup)
+{
+   memset(tscene, 0, sizeof *tscene);
+   tscene->pipe = setup->pipe;
+   tscene->setup = setup;
+   tscene->data.head = &tscene->data.first;
+   (void) mtx_init(&tscene->mutex, mtx_plain);
 }
 
 
 void
-lp_scene_bin_iter_begin(struct lp_scene *scene)
+lp_scene_fini_thread_scene(struct lp_scene *tscene)
 {
-   scene->curr_x = scene->curr_y = -1;
+   mtx_destroy(&tscene->mutex);
+   free(tscene->tiles);
+   free(tscene->reset_bins);
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
- * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * Prepare a binning thread's private scene for binning on behalf of
+ * 'scene'.  The private scene may allocate data blocks until its size
+ * reaches LP_SCENE_MAX_SIZE, starting at 'scene_size'.
  */
-struct cmd_bin *
-lp_scene_bin_iter_next(struct lp_scene *scene , int *x, int *y)
+bool
+lp_scene_begin_thread_binning(struct lp_scene *tscene,
+                              const struct lp_scene *scene,
+                              unsigned scene_size)
 {
-   struct cmd_bin *bin = NULL;
+   const unsigned num_bins = lp_scene_get_num_bins(scene);
+
+   if (tscene->num_alloced_tiles < num_bins) {
+      free(tscene->tiles);
+      free(tscene->reset_bins);
+      tscene->num_alloced_tiles = 0;
+      tscene->tiles = calloc(num_bins, sizeof(struct cmd_bin));
+      tscene->reset_bins = calloc(BITSET_WORDS(num_bins), sizeof(BITSET_WORD));
+      if (!tscene->tiles || !tscene->reset_bins)
+         return false;
+      tscene->num_alloced_tiles = num_bins;
+   } else {
+      memset(tscene->tiles, 0, num_bins * sizeof(struct cmd_bin));
+      memset(tscene->reset_bins, 0,
+             BITSET_WORDS(num_bins) * sizeof(BITSET_WORD));
+   }
+
+   /* Not referenced, the framebuffer is only looked at */
+   tscene->fb = scene->fb;
+   tscene->fb_max_layer = scene->fb_max_layer;
+   tscene->fb_max_samples = scene->fb_max_samples;
+   memcpy(tscene->fixed_sample_pos, scene->fixed_sample_pos,
+          sizeof(scene->fixed_sample_pos));
+   tscene->had_queries = scene->had_queries;
+   tscene->permit_linear_rasterizer = scene->permit_linear_rasterizer;
+   tscene->tiles_x = scene->tiles_x;
+   tscene->tiles_y = scene->tiles_y;
+
+   /* The embedded first block lives as long as the thread scene, so never
+    * allocate from it: all data must outlive the binning.
+    */
+   tscene->data.first.used = DATA_BLOCK_SIZE;
+   tscene->data.first.next = NULL;
+   tscene->data.head = &tscene->data.first;
+   tscene->scene_size = scene_size;
+   tscene->alloc_failed = false;
 
-   mtx_lock(&scene->mutex);
+   return true;
+}
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   } else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+
+/**
+ * Finish binning in a binning thread's private scene.  If 'merge' is set,
+ * append the commands of each private bin to the matching bin of 'scene',
+ * and hand over the data blocks.  Otherwise everything is discarded.
+ */
+void
+lp_scene_end_thread_binning(struct lp_scene *scene,
+                            struct lp_scene *tscene,
+                            bool merge)
+{
+   struct data_block *block = tscene->data.head;
+
+   if (!merge) {
+      while (block != &tscene->data.first) {
+         struct data_block *next = block->next;
+         FREE(block);
+         block = next;
+      }
+      tscene->data.head = &tscene->data.first;
+      return;
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   for (unsigned y = 0; y < scene->tiles_y; y++) {
+      for (unsigned x = 0; x < scene->tiles_x; x++) {
+         const unsigned idx = scene->tiles_x * y + x;
+         const struct cmd_bin *tbin = &tscene->tiles[idx];
+         struct cmd_bin *bin = &scene->tiles[idx];
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+         /* Previous commands were overwritten by an opaque tile */
+         if (BITSET_TEST(tscene->reset_bins, idx))
+            lp_scene_bin_reset(scene, x, y);
+
+         if (!tbin->head)
+            continue;
+
+         if (bin->tail)
+            bin->tail->next = tbin->head;
+         else
+            bin->head = tbin->head;
+         bin->tail = tbin->tail;
+
+         if (tbin->last_state)
+            bin->last_state = tbin->last_state;
+      }
+   }
+
+   /* Keep scene->data.head as the current block, the thread's blocks are
+    * full enough.
+    */
+   if (block != &tscene->data.first) {
+      struct data_block *last = block;
+      unsigned num_blocks = 1;
+
+      while (last->next != &tscene->data.first) {
+         last = last->next;
+         num_blocks++;
+      }
+
+      last->next = scene->data.head->next;
+      scene->data.head->next = block;
+      scene->scene_size += num_blocks * sizeof(struct data_block);
+   }
+
+   tscene->data.head = &tscene->data.first;
 }
 
 
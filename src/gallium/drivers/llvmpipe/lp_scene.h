@@ -35,7 +35,10 @@
 #ifndef LP_SCENE_H
 #define LP_SCENE_H
 
+#include "util/bitset.h"
+#include "util/u_memory.h"
 #include "util/u_thread.h"
+#include "lp_limits.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
 
@@ -116,6 +119,20 @@ struct data_block_list {
    struct data_block *head;
 };
 
+/**
+ * A contiguous run of bins, in raster order, initially assigned to one
+ * rasterizer thread.  Bins are claimed by atomically incrementing 'next',
+ * both by the owning thread and by other threads which steal from it once
+ * their own range is exhausted.  Padded to a cache line to avoid false
+ * sharing between threads.
+ */
+struct lp_scene_bin_range {
+   int next;
+   int end;
+   uint8_t pad[CACHE_LINE_SIZE - 2 * sizeof(int)];
+};
+
+
 struct resource_ref;
 
 struct shader_ref;
@@ -195,12 +212,18 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
+   /** Per-thread bin ranges, for iterating over bins */
+   struct lp_scene_bin_range *bin_ranges;
+   unsigned max_bin_ranges, num_bin_ranges;
+
    mtx_t mutex;
 
    unsigned num_alloced_tiles;
    struct cmd_bin *tiles;
    struct data_block_list data;
+
+   /** For the private scenes of binning threads: bins which were reset */
+   BITSET_WORD *reset_bins;
 };
 
 
@@ -396,12 +419,33 @@ lp_scene_get_num_bins(const struct lp_scene *scene)
 
 
 void
-lp_scene_bin_iter_begin(struct lp_scene *scene);
+lp_scene_bin_iter_begin(struct lp_scene *scene, unsigned num_threads);
 
 struct cmd_bin *
-lp_scene_bin_iter_next(struct lp_scene *scene, int *x, int *y);
+lp_scene_bin_iter_next(struct lp_scene *scene, unsigned thread_index,
+                       int *x, int *y, bool *stolen);
+
 
 
+/* Private scenes used by the binning threads
+ */
+void
+lp_scene_init_thread_scene(struct lp_scene *tscene,
+                           struct lp_setup_context *setup);
+
+void
+lp_scene_fini_thread_scene(struct lp_scene *tscene);
+
+bool
+lp_scene_begin_thread_binning(struct lp_scene *tscene,
+                              const struct lp_scene *scene,
+                              unsigned scene_size);
+
+void
+lp_scene_end_thread_binning(struct lp_scene *scene,
+                            struct lp_scene *tscene,
+                            bool merge);
+
 
 /* Begin/end binning of a scene
  */
@@ -54,6 +54,7 @@
 #include "lp_limits.h"
 #include "lp_rast.h"
 #include "lp_cs_tpool.h"
+#include "lp_cache_warmup.h"
 #include "lp_flush.h"
 
 #include "frontend/sw_winsys.h"
@@ -84,6 +85,7 @@ static const struct debug_named_value lp_debug_flags[] = {
    { "mem", DEBUG_MEM, NULL },
    { "fs", DEBUG_FS, NULL },
    { "cs", DEBUG_CS, NULL },
+   { "sched", DEBUG_SCHED, NULL },
    { "accurate_a0", DEBUG_ACCURATE_A0 },
    { "mesh", DEBUG_MESH },
    DEBUG_NAMED_VALUE_END
@@ -927,6 +929,12 @@ llvmpipe_destroy_screen(struct pipe_screen *_screen)
 {
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
 
+   if (util_queue_is_initialized(&screen->async_fs_queue)) {
+      util_queue_destroy(&screen->async_fs_queue);
+      for (unsigned i = 0; i < ARRAY_SIZE(screen->async_fs_context); i++)
+         lp_context_destroy(&screen->async_fs_context[i]);
+   }
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -935,6 +943,7 @@ llvmpipe_destroy_screen(struct pipe_screen *_screen)
 
    lp_jit_screen_cleanup(screen);
 
+   lp_cache_warmup_destroy(screen->cache_warmup);
    disk_cache_destroy(screen->disk_shader_cache);
 
    glsl_type_singleton_decref();
@@ -1065,12 +1074,15 @@ lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
                           20, sha1);
 
    size_t binary_size;
-   uint8_t *buffer = disk_cache_get(screen->disk_shader_cache,
-                                    sha1, &binary_size);
+   uint8_t *buffer = lp_cache_warmup_find(screen->cache_warmup,
+                                          sha1, &binary_size);
+   if (!buffer)
+      buffer = disk_cache_get(screen->disk_shader_cache, sha1, &binary_size);
    if (!buffer) {
       cache->data_size = 0;
       return;
    }
+   lp_cache_warmup_record(screen->cache_warmup, sha1);
    cache->data_size = binary_size;
    cache->data = buffer;
 }
@@ -1089,6 +1101,7 @@ lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
                           20, sha1);
    disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
                   cache->data_size, NULL);
+   lp_cache_warmup_record(screen->cache_warmup, sha1);
 }
 
 
@@ -1122,6 +1135,26 @@ llvmpipe_screen_late_init(struct llvmpipe_screen *screen)
    lp_build_init(); /* get lp_native_vector_width initialised */
 
    lp_disk_cache_create(screen);
+   if (debug_get_bool_option("LP_CACHE_WARMUP", false))
+      screen->cache_warmup = lp_cache_warmup_create(screen->disk_shader_cache);
+
+#if !GALLIVM_USE_ORCJIT
+   if (screen->async_fs_compile) {
+      const unsigned num_threads =
+         CLAMP(util_get_cpu_caps()->nr_cpus / 4, 1, LP_MAX_ASYNC_FS_THREADS);
+
+      for (unsigned i = 0; i < num_threads; i++)
+         lp_context_create(&screen->async_fs_context[i]);
+
+      if (!util_queue_init(&screen->async_fs_queue, "lpfs", 64, num_threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                           UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, screen)) {
+         for (unsigned i = 0; i < num_threads; i++)
+            lp_context_destroy(&screen->async_fs_context[i]);
+      }
+   }
+#endif
+
    screen->late_init_done = true;
 out:
    mtx_unlock(&screen->late_mutex);
@@ -1187,6 +1220,14 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
                                               screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
+   /* Binning threads run on the compute thread pool */
+   screen->num_bin_threads = screen->num_threads ?
+      debug_get_num_option("LP_BIN_THREADS", 0) : 0;
+   screen->num_bin_threads = MIN2(screen->num_bin_threads, LP_MAX_THREADS);
+
+   screen->async_fs_compile = debug_get_bool_option("LP_ASYNC_FS_COMPILE",
+                                                    false);
+
 #if defined(HAVE_LIBDRM) && defined(HAVE_LINUX_UDMABUF_H)
    screen->udmabuf_fd = open("/dev/udmabuf", O_RDWR);
    llvmpipe_init_screen_fence_funcs(&screen->base);
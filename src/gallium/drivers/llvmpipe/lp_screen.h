@@ -38,12 +38,15 @@
 #include "pipe/p_defines.h"
 #include "util/u_thread.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/vma.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
+#include "lp_limits.h"
 
 struct sw_winsys;
 struct lp_cs_tpool;
+struct lp_cache_warmup;
 
 struct llvmpipe_screen
 {
@@ -52,6 +55,7 @@ struct llvmpipe_screen
    struct sw_winsys *winsys;
 
    unsigned num_threads;
+   unsigned num_bin_threads;
 
    /* Increments whenever textures are modified.  Contexts can track this.
     */
@@ -63,6 +67,15 @@ struct llvmpipe_screen
    struct lp_cs_tpool *cs_tpool;
    mtx_t cs_mutex;
 
+   /* Background compilation of optimized fragment shader variants, only
+    * initialized with LP_ASYNC_FS_COMPILE.  Each queue thread has its own
+    * LLVM context.
+    */
+   bool async_fs_compile;
+   struct util_queue async_fs_queue;
+   lp_context_ref async_fs_context[LP_MAX_ASYNC_FS_THREADS];
+   int async_fs_pending;
+
    bool allow_cl;
 
    mtx_t late_mutex;
@@ -74,6 +87,7 @@ struct llvmpipe_screen
    char renderer_string[100];
 
    struct disk_cache *disk_shader_cache;
+   struct lp_cache_warmup *cache_warmup;
 
 #if defined(HAVE_LIBDRM) && defined(HAVE_LINUX_UDMABUF_H)
    int udmabuf_fd;
@@ -1316,6 +1316,8 @@ lp_setup_destroy(struct lp_setup_context *setup)
    LP_DBG(DEBUG_SETUP, "number of scenes used: %d\n", setup->num_active_scenes);
    slab_destroy(&setup->scene_slab);
 
+   lp_setup_destroy_bin_threads(setup);
+
    FREE(setup);
 }
 
@@ -1352,6 +1354,10 @@ lp_setup_create(struct pipe_context *pipe,
       goto no_vbuf;
    }
 
+   if (!lp_setup_init_bin_threads(setup, screen->num_bin_threads)) {
+      goto no_bin_threads;
+   }
+
    draw_set_rasterize_stage(draw, setup->vbuf);
    draw_set_render(draw, &setup->base);
 
@@ -1384,6 +1390,8 @@ no_scenes:
       }
    }
 
+   lp_setup_destroy_bin_threads(setup);
+no_bin_threads:
    setup->vbuf->destroy(setup->vbuf);
 no_vbuf:
    FREE(setup);
@@ -1520,6 +1528,14 @@ lp_setup_flush_and_restart(struct lp_setup_context *setup)
 {
    if (0) debug_printf("%s\n", __func__);
 
+   /* Binning threads can't flush, the application thread will bin the
+    * remaining primitives once they're done.
+    */
+   if (setup->bin_thread) {
+      lp_setup_bin_thread_failed(setup);
+      return false;
+   }
+
    assert(setup->state == SETUP_ACTIVE);
 
    if (!set_scene_state(setup, SETUP_FLUSHED, __func__))
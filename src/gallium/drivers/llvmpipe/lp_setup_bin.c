@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Multi-threaded triangle setup and binning.
+ *
+ * A list of triangles is split into contiguous runs which are set up and
+ * binned concurrently on the compute thread pool.  Each binning thread
+ * works on a private copy of the setup context whose scene has its own
+ * bins and data blocks.  Once all threads are done the per-thread bins are
+ * appended to the real scene's bins in thread order, which preserves the
+ * primitive order within every bin.
+ *
+ * Binning threads can't flush the scene when it runs out of memory.  In
+ * that case the thread stops, everything binned before the failing
+ * triangle is kept, and the application thread bins the remaining
+ * triangles the usual way.
+ */
+
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "lp_setup_context.h"
+#include "lp_context.h"
+#include "lp_cs_tpool.h"
+#include "lp_screen.h"
+#include "lp_debug.h"
+
+
+/** Don't bother splitting off runs shorter than this */
+#define LP_BIN_MIN_TRIANGLES 32
+
+
+struct lp_setup_bin_thread
+{
+   /** Copy of the application thread's setup context, binning into 'scene' */
+   struct lp_setup_context setup;
+
+   /** Private bins and data blocks, merged into the real scene afterwards */
+   struct lp_scene scene;
+
+   /** Triangles [first, last) of the current vertex list */
+   unsigned first, last;
+
+   /** Set when the scene ran out of memory at triangle 'failed_tri' */
+   bool failed;
+   unsigned failed_tri;
+};
+
+
+struct lp_setup_bin_job
+{
+   struct lp_setup_context *setup;
+   const void *vertex_buffer;
+   const uint16_t *indices;
+   unsigned stride;
+};
+
+
+static inline const float (*
+get_vert(const struct lp_setup_bin_job *job, unsigned i))[4]
+{
+   const unsigned idx = job->indices ? job->indices[i] : i;
+   return (const float (*)[4])((const char *)job->vertex_buffer +
+                               idx * job->stride);
+}
+
+
+static void
+bin_triangles_task(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   const struct lp_setup_bin_job *job = data;
+   struct lp_setup_bin_thread *thread = &job->setup->bin_threads[iter_idx];
+   struct lp_setup_context *setup = &thread->setup;
+
+   for (unsigned t = thread->first; t < thread->last; t++) {
+      setup->triangle(setup,
+                      get_vert(job, t * 3 + 0),
+                      get_vert(job, t * 3 + 1),
+                      get_vert(job, t * 3 + 2));
+
+      /* Set by lp_setup_bin_thread_failed() */
+      if (thread->failed) {
+         thread->failed_tri = t;
+         return;
+      }
+   }
+}
+
+
+/**
+ * Called instead of flushing the scene when a binning thread runs out of
+ * scene memory.
+ */
+void
+lp_setup_bin_thread_failed(struct lp_setup_context *setup)
+{
+   setup->bin_thread->failed = true;
+}
+
+
+/**
+ * Set up and bin a list of triangles on the binning threads.
+ *
+ * \param indices  vertex indices, or NULL for sequential vertices
+ * \param nr  number of vertices/indices
+ * \return number of vertices/indices consumed; the caller must bin any
+ *         remaining triangles itself
+ */
+unsigned
+lp_setup_bin_triangles(struct lp_setup_context *setup,
+                       const void *vertex_buffer,
+                       unsigned stride,
+                       const uint16_t *indices,
+                       unsigned nr)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(setup->pipe->screen);
+   struct lp_scene *scene = setup->scene;
+   const unsigned num_tris = nr / 3;
+   const unsigned num_jobs = MIN2(setup->num_bin_threads,
+                                  num_tris / LP_BIN_MIN_TRIANGLES);
+
+   if (num_jobs < 2 || !scene || setup->state != SETUP_ACTIVE)
+      return 0;
+
+   /* Share the remaining scene memory equally among the threads */
+   const unsigned headroom = LP_SCENE_MAX_SIZE - MIN2(scene->scene_size,
+                                                      LP_SCENE_MAX_SIZE);
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      struct lp_setup_bin_thread *thread = &setup->bin_threads[j];
+
+      if (!lp_scene_begin_thread_binning(&thread->scene, scene,
+                                         LP_SCENE_MAX_SIZE -
+                                         headroom / num_jobs))
+         return 0;
+
+      memcpy(&thread->setup, setup, sizeof *setup);
+      thread->setup.scene = &thread->scene;
+      thread->setup.bin_thread = thread;
+      thread->first = num_tris * j / num_jobs;
+      thread->last = num_tris * (j + 1) / num_jobs;
+      thread->failed = false;
+   }
+
+   struct lp_setup_bin_job job = {
+      .setup = setup,
+      .vertex_buffer = vertex_buffer,
+      .indices = indices,
+      .stride = stride,
+   };
+
+   struct lp_cs_tpool_task *task =
+      lp_cs_tpool_queue_task(screen->cs_tpool, bin_triangles_task,
+                             &job, num_jobs);
+   if (!task) {
+      for (unsigned j = 0; j < num_jobs; j++)
+         lp_scene_end_thread_binning(scene, &setup->bin_threads[j].scene,
+                                     false);
+      return 0;
+   }
+
+   lp_cs_tpool_wait_for_task(screen->cs_tpool, &task);
+
+   /* Merge in primitive order.  Everything after the first failure is
+    * discarded and gets binned again by the caller.
+    */
+   unsigned num_binned = num_tris;
+   bool failed = false;
+   for (unsigned j = 0; j < num_jobs; j++) {
+      struct lp_setup_bin_thread *thread = &setup->bin_threads[j];
+
+      lp_scene_end_thread_binning(scene, &thread->scene, !failed);
+
+      if (!failed && thread->failed) {
+         failed = true;
+         num_binned = thread->failed_tri;
+      }
+   }
+
+   if (LP_DEBUG & DEBUG_SETUP)
+      debug_printf("%s: %u triangles on %u threads, %u binned\n",
+                   __func__, num_tris, num_jobs, num_binned);
+
+   return num_binned * 3;
+}
+
+
+bool
+lp_setup_init_bin_threads(struct lp_setup_context *setup,
+                          unsigned num_bin_threads)
+{
+   if (num_bin_threads < 2)
+      return true;
+
+   setup->bin_threads = CALLOC(num_bin_threads,
+                               sizeof(struct lp_setup_bin_thread));
+   if (!setup->bin_threads)
+      return false;
+
+   for (unsigned j = 0; j < num_bin_threads; j++)
+      lp_scene_init_thread_scene(&setup->bin_threads[j].scene, setup);
+
+   setup->num_bin_threads = num_bin_threads;
+   return true;
+}
+
+
+void
+lp_setup_destroy_bin_threads(struct lp_setup_context *setup)
+{
+   for (unsigned j = 0; j < setup->num_bin_threads; j++)
+      lp_scene_fini_thread_scene(&setup->bin_threads[j].scene);
+
+   FREE(setup->bin_threads);
+   setup->bin_threads = NULL;
+   setup->num_bin_threads = 0;
+}
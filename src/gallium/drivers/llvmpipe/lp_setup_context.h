@@ -53,6 +53,7 @@
 #define LP_SETUP_NEW_SSBOS       0x20
 
 struct lp_setup_variant;
+struct lp_setup_bin_thread;
 
 
 /** Max number of scenes */
@@ -91,6 +92,13 @@ struct lp_setup_context
    unsigned num_threads;
    unsigned scene_idx;
 
+   /** Multi-threaded binning, see lp_setup_bin.c */
+   unsigned num_bin_threads;
+   struct lp_setup_bin_thread *bin_threads;
+
+   /** Non-NULL in the setup context copies used by the binning threads */
+   struct lp_setup_bin_thread *bin_thread;
+
    struct slab_mempool scene_slab;
    int num_active_scenes;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
@@ -285,6 +293,23 @@ struct lp_rast_rectangle *
 lp_setup_alloc_rectangle(struct lp_scene *scene,
                          unsigned nr_inputs);
 
+bool
+lp_setup_init_bin_threads(struct lp_setup_context *setup,
+                          unsigned num_bin_threads);
+
+void
+lp_setup_destroy_bin_threads(struct lp_setup_context *setup);
+
+unsigned
+lp_setup_bin_triangles(struct lp_setup_context *setup,
+                       const void *vertex_buffer,
+                       unsigned stride,
+                       const uint16_t *indices,
+                       unsigned nr);
+
+void
+lp_setup_bin_thread_failed(struct lp_setup_context *setup);
+
 bool
 lp_setup_analyse_triangles(struct lp_setup_context *setup,
                            const void *vb,
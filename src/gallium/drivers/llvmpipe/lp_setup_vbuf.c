@@ -223,7 +223,8 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const uint16_t *indices, uint nr
       break;
 
    case MESA_PRIM_TRIANGLES:
-      if (nr % 6 == 0 && !uses_constant_interp) {
+      if (nr % 6 == 0 && !uses_constant_interp &&
+          setup->permit_linear_rasterizer) {
          for (i = 5; i < nr; i += 6) {
             rect(setup,
                  get_vert(vertex_buffer, indices[i-5], stride),
@@ -234,7 +235,10 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const uint16_t *indices, uint nr
                  get_vert(vertex_buffer, indices[i-0], stride));
          }
       } else {
-         for (i = 2; i < nr; i += 3) {
+         /* bin what we can on the binning threads, if any */
+         i = 2 + lp_setup_bin_triangles(setup, vertex_buffer, stride,
+                                        indices, nr);
+         for (; i < nr; i += 3) {
             setup->triangle(setup,
                             get_vert(vertex_buffer, indices[i-2], stride),
                             get_vert(vertex_buffer, indices[i-1], stride),
@@ -431,7 +435,8 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case MESA_PRIM_TRIANGLES:
-      if (nr % 6 == 0 && !uses_constant_interp) {
+      if (nr % 6 == 0 && !uses_constant_interp &&
+          setup->permit_linear_rasterizer) {
          for (i = 5; i < nr; i += 6) {
             rect(setup,
                  get_vert(vertex_buffer, i-5, stride),
@@ -441,13 +446,16 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
                  get_vert(vertex_buffer, i-1, stride),
                  get_vert(vertex_buffer, i-0, stride));
          }
-      } else if (!uses_constant_interp &&
+      } else if (nr % 6 != 0 && !uses_constant_interp &&
                lp_setup_analyse_triangles(setup, vertex_buffer, stride, nr)) {
          /* If lp_setup_analyse_triangles() returned true, it also
           * emitted (setup) the rect or triangles.
           */
       } else {
-         for (i = 2; i < nr; i += 3) {
+         /* bin what we can on the binning threads, if any */
+         i = 2 + lp_setup_bin_triangles(setup, vertex_buffer, stride,
+                                        NULL, nr);
+         for (; i < nr; i += 3) {
             setup->triangle(setup,
                             get_vert(vertex_buffer, i-2, stride),
                             get_vert(vertex_buffer, i-1, stride),
@@ -605,7 +605,7 @@ fs_fb_fetch(const struct lp_build_fs_iface *iface,
    }
 
    /* fragment shader executes on 4x4 blocks. depending on vector width it can
-    * execute 2 or 4 iterations.  only move to the next row once the top row
+    * execute 1, 2 or 4 iterations.  only move to the next row once the top row
     * has completed 8 wide 1 iteration, 4 wide 2 iterations */
    LLVMValueRef x_offset = NULL, y_offset = NULL;
    if (!key->resource_1d) {
@@ -625,14 +625,14 @@ fs_fb_fetch(const struct lp_build_fs_iface *iface,
       unsigned x = i % block_width;
       unsigned y = i / block_width;
 
-      if (block_size == 8) {
+      if (block_size >= 8) {
          /* remap the raw slots into the fragment shader execution mode. */
          /* this math took me way too long to work out, I'm sure it's
-          * overkill.
+          * overkill.  16 wide adds the lower two quads below the upper two.
           */
-         x = (i & 1) + ((i >> 2) << 1);
+         x = (i & 1) + (((i >> 2) & 1) << 1);
          if (!key->resource_1d)
-            y = (i & 2) >> 1;
+            y = ((i & 2) >> 1) + ((i >> 3) << 1);
       }
 
       LLVMValueRef x_val;
@@ -2540,7 +2540,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
 
    row_type.length = fs_type.length;
    unsigned vector_width =
-      dst_type.floating ? lp_native_vector_width : lp_integer_vector_width;
+      dst_type.floating ? fs_type.width * fs_type.length : lp_integer_vector_width;
 
    /* Compute correct swizzle and count channels */
    memset(swizzle, LP_BLD_SWIZZLE_DONTCARE, TGSI_NUM_CHANNELS);
@@ -3331,9 +3331,22 @@ generate_fragment(struct llvmpipe_context *lp,
 
    unsigned num_fs = 16 / fs_type.length; /* number of loops per 4x4 stamp */
    /* for 1d resources only run "upper half" of stamp */
-   if (key->resource_1d)
+   if (key->resource_1d && num_fs > 1)
       num_fs /= 2;
 
+   /*
+    * Blending works on at most 8-wide vectors.  A 16-wide vector holds
+    * quads 0,1 in its lower half and quads 2,3 in its upper half, the
+    * same as two 8-wide vectors, so the outputs are simply blended in two
+    * halves.
+    */
+   struct lp_type blend_fs_type = fs_type;
+   blend_fs_type.length = MIN2(fs_type.length, 8);
+   const unsigned blend_split = fs_type.length / blend_fs_type.length;
+   unsigned num_blend_fs = 16 / blend_fs_type.length;
+   if (key->resource_1d)
+      num_blend_fs /= 2;
+
    {
       LLVMValueRef num_loop = lp_build_const_int32(gallivm, num_fs);
       LLVMTypeRef mask_type = lp_build_int_vec_type(gallivm, fs_type);
@@ -3469,20 +3482,24 @@ generate_fragment(struct llvmpipe_context *lp,
                        variant->jit_thread_data_type,
                        thread_data_ptr);
 
-      LLVMTypeRef fs_vec_type = lp_build_vec_type(gallivm, fs_type);
-      for (unsigned i = 0; i < num_fs; i++) {
+      LLVMTypeRef fs_vec_type = lp_build_vec_type(gallivm, blend_fs_type);
+      LLVMTypeRef blend_mask_type = lp_build_int_vec_type(gallivm, blend_fs_type);
+      for (unsigned i = 0; i < num_blend_fs; i++) {
          LLVMValueRef ptr;
          for (unsigned s = 0; s < key->coverage_samples; s++) {
-            int idx = (i + (s * num_fs));
-            LLVMValueRef sindexi = lp_build_const_int32(gallivm, idx);
-            ptr = LLVMBuildGEP2(builder, mask_type, mask_store, &sindexi, 1, "");
-
-            fs_mask[idx] = LLVMBuildLoad2(builder, mask_type, ptr, "smask");
+            int idx = (i + (s * num_blend_fs));
+            LLVMValueRef sindexi =
+               lp_build_const_int32(gallivm, i + s * num_fs * blend_split);
+            ptr = LLVMBuildGEP2(builder, blend_mask_type, mask_store,
+                                &sindexi, 1, "");
+
+            fs_mask[idx] = LLVMBuildLoad2(builder, blend_mask_type, ptr,
+                                          "smask");
          }
 
          for (unsigned s = 0; s < key->min_samples; s++) {
             /* This is fucked up need to reorganize things */
-            int idx = s * num_fs + i;
+            int idx = s * num_fs * blend_split + i;
             LLVMValueRef sindexi = lp_build_const_int32(gallivm, idx);
             for (unsigned cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
                for (unsigned chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
@@ -3543,7 +3560,7 @@ generate_fragment(struct llvmpipe_context *lp,
                                                          &index, 1, ""), "");
 
          for (unsigned s = 0; s < key->cbuf_nr_samples[cbuf]; s++) {
-            unsigned mask_idx = num_fs * (key->multisample ? s : 0);
+            unsigned mask_idx = num_blend_fs * (key->multisample ? s : 0);
             unsigned out_idx = key->min_samples == 1 ? 0 : s;
             LLVMValueRef out_ptr = color_ptr;
 
@@ -3560,7 +3577,8 @@ generate_fragment(struct llvmpipe_context *lp,
 
             generate_unswizzled_blend(gallivm, cbuf, variant,
                                       key->cbuf_format[cbuf],
-                                      num_fs, fs_type, &fs_mask[mask_idx],
+                                      num_blend_fs, blend_fs_type,
+                                      &fs_mask[mask_idx],
                                       fs_out_color[out_idx],
                                       variant->jit_context_type,
                                       context_ptr, blend_vec_type, out_ptr, stride,
@@ -3755,6 +3773,171 @@ lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
 }
 
 
+/**
+ * Background compilation of optimized fragment shader code.
+ *
+ * With LP_ASYNC_FS_COMPILE a variant that isn't in the disk cache is first
+ * compiled without optimizations, which is much faster, so the draw that
+ * needs it doesn't stall for long.  The same code is then compiled with
+ * optimizations on the screen's async_fs_queue and the variant's function
+ * pointers are swapped once it's done.  Both versions compute the same
+ * results so the rasterizer threads may pick up either of them at any time.
+ *
+ * The queue threads work on private copies of the shader, its NIR and the
+ * variant so that nothing the application thread uses gets touched.
+ */
+struct lp_fs_async_job
+{
+   struct lp_fragment_shader_variant *variant;
+
+   /** Copies of the shader (with cloned NIR) and variant to compile */
+   struct lp_fragment_shader shader;
+   struct lp_fragment_shader_variant *scratch;
+
+   unsigned char ir_sha1_cache_key[20];
+   bool edge_test, whole, linear;
+};
+
+
+static void
+async_fs_compile(void *data, void *gdata, int thread_index)
+{
+   struct lp_fs_async_job *job = data;
+   struct llvmpipe_screen *screen = gdata;
+   struct lp_fragment_shader_variant *variant = job->variant;
+   struct lp_fragment_shader_variant *scratch = job->scratch;
+   struct lp_cached_code cached = { 0 };
+
+   char module_name[64];
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+            job->shader.no, variant->no);
+   scratch->gallivm = gallivm_create(module_name,
+                                     &screen->async_fs_context[thread_index],
+                                     &cached);
+   if (!scratch->gallivm)
+      return;
+
+   lp_jit_init_types(scratch);
+
+   if (job->edge_test)
+      generate_fragment(NULL, &job->shader, scratch, RAST_EDGE_TEST);
+   if (job->whole)
+      generate_fragment(NULL, &job->shader, scratch, RAST_WHOLE);
+   if (job->linear)
+      llvmpipe_fs_variant_linear_llvm(NULL, &job->shader, scratch);
+
+   gallivm_compile_module(scratch->gallivm);
+
+   lp_jit_frag_func edge_test = variant->jit_function[RAST_EDGE_TEST];
+   if (job->edge_test) {
+      edge_test = (lp_jit_frag_func)
+         gallivm_jit_function(scratch->gallivm,
+                              scratch->function[RAST_EDGE_TEST],
+                              scratch->function_name[RAST_EDGE_TEST]);
+   }
+
+   lp_jit_frag_func whole = variant->jit_function[RAST_WHOLE];
+   if (job->whole) {
+      whole = (lp_jit_frag_func)
+         gallivm_jit_function(scratch->gallivm,
+                              scratch->function[RAST_WHOLE],
+                              scratch->function_name[RAST_WHOLE]);
+   } else if (whole == variant->jit_function[RAST_EDGE_TEST]) {
+      whole = edge_test;
+   }
+
+   if (job->linear && scratch->linear_function) {
+      lp_jit_linear_llvm_func linear = (lp_jit_linear_llvm_func)
+         gallivm_jit_function(scratch->gallivm, scratch->linear_function,
+                              scratch->linear_function_name);
+      p_atomic_set(&variant->jit_linear_llvm, linear);
+   }
+
+   p_atomic_set(&variant->jit_function[RAST_EDGE_TEST], edge_test);
+   p_atomic_set(&variant->jit_function[RAST_WHOLE], whole);
+
+   lp_disk_cache_insert_shader(screen, &cached, job->ir_sha1_cache_key);
+
+   gallivm_free_ir(scratch->gallivm);
+
+   /* Only looked at again once the fence has signalled */
+   variant->async_gallivm = scratch->gallivm;
+}
+
+
+static void
+async_fs_cleanup(void *data, void *gdata, int thread_index)
+{
+   struct lp_fs_async_job *job = data;
+   struct llvmpipe_screen *screen = gdata;
+   struct lp_fragment_shader_variant *scratch = job->scratch;
+
+   FREE(scratch->function_name[RAST_EDGE_TEST]);
+   FREE(scratch->function_name[RAST_WHOLE]);
+   FREE(scratch->linear_function_name);
+   FREE(scratch);
+   ralloc_free(job->shader.base.ir.nir);
+   FREE(job);
+
+   p_atomic_dec(&screen->async_fs_pending);
+}
+
+
+/**
+ * Queue the optimized compilation of a variant which was just compiled
+ * without optimizations.
+ */
+static void
+async_fs_queue_variant(struct llvmpipe_screen *screen,
+                       struct lp_fragment_shader *shader,
+                       struct lp_fragment_shader_variant *variant,
+                       const unsigned char ir_sha1_cache_key[20])
+{
+   const size_t variant_size =
+      sizeof *variant + shader->variant_key_size - sizeof variant->key;
+   struct lp_fs_async_job *job = CALLOC_STRUCT(lp_fs_async_job);
+   if (!job)
+      return;
+
+   job->scratch = MALLOC(variant_size);
+   if (!job->scratch) {
+      FREE(job);
+      return;
+   }
+
+   job->variant = variant;
+   job->edge_test = variant->function[RAST_EDGE_TEST] != NULL;
+   job->whole = variant->function[RAST_WHOLE] != NULL;
+   job->linear = variant->linear_function != NULL;
+   memcpy(job->ir_sha1_cache_key, ir_sha1_cache_key,
+          sizeof job->ir_sha1_cache_key);
+
+   /* lp_build_nir_soa() runs passes on the NIR, so it can't be shared */
+   memcpy(&job->shader, shader, sizeof job->shader);
+   job->shader.base.ir.nir = nir_shader_clone(NULL, shader->base.ir.nir);
+
+   memcpy(job->scratch, variant, variant_size);
+   job->scratch->shader = &job->shader;
+   job->scratch->gallivm = NULL;
+   job->scratch->jit_context_ptr_type = NULL;
+   job->scratch->function[RAST_EDGE_TEST] = NULL;
+   job->scratch->function[RAST_WHOLE] = NULL;
+   job->scratch->function_name[RAST_EDGE_TEST] = NULL;
+   job->scratch->function_name[RAST_WHOLE] = NULL;
+   job->scratch->linear_function = NULL;
+   job->scratch->linear_function_name = NULL;
+
+   const unsigned depth = p_atomic_inc_return(&screen->async_fs_pending);
+   if (depth > LP_COUNT_GET(max_async_fs_queue_depth))
+      LP_COUNT_ADD(max_async_fs_queue_depth,
+                   depth - LP_COUNT_GET(max_async_fs_queue_depth));
+   LP_COUNT(nr_async_fs_compiles);
+
+   util_queue_add_job(&screen->async_fs_queue, job, &variant->async_fence,
+                      async_fs_compile, async_fs_cleanup, 0);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -3776,6 +3959,7 @@ generate_variant(struct llvmpipe_context *lp,
    lp_fs_reference(lp, &variant->shader, shader);
 
    memcpy(&variant->key, key, shader->variant_key_size);
+   util_queue_fence_init(&variant->async_fence);
 
    struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_cached_code cached = { 0 };
@@ -3794,6 +3978,7 @@ generate_variant(struct llvmpipe_context *lp,
             shader->no, shader->variants_created);
    variant->gallivm = gallivm_create(module_name, &lp->context, &cached);
    if (!variant->gallivm) {
+      util_queue_fence_destroy(&variant->async_fence);
       FREE(variant);
       return NULL;
    }
@@ -3950,6 +4135,14 @@ generate_variant(struct llvmpipe_context *lp,
       }
    }
 
+   /* Anything missing from the disk cache gets compiled twice when asynchronous
+    * compilation is enabled, see async_fs_compile().
+    */
+   const bool async = needs_caching &&
+      variant->function[RAST_EDGE_TEST] &&
+      util_queue_is_initialized(&screen->async_fs_queue);
+   variant->gallivm->no_opt = async;
+
    /*
     * Compile everything
     */
@@ -3996,7 +4189,9 @@ generate_variant(struct llvmpipe_context *lp,
       lp_linear_check_variant(variant);
    }
 
-   if (needs_caching) {
+   if (async) {
+      async_fs_queue_variant(screen, shader, variant, ir_sha1_cache_key);
+   } else if (needs_caching) {
       lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
    }
 
@@ -4160,6 +4355,14 @@ void
 llvmpipe_destroy_shader_variant(struct llvmpipe_context *lp,
                                 struct lp_fragment_shader_variant *variant)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+
+   if (util_queue_is_initialized(&screen->async_fs_queue))
+      util_queue_drop_job(&screen->async_fs_queue, &variant->async_fence);
+   util_queue_fence_destroy(&variant->async_fence);
+   if (variant->async_gallivm)
+      gallivm_destroy(variant->async_gallivm);
+
    gallivm_destroy(variant->gallivm);
    lp_fs_reference(lp, &variant->shader, NULL);
    if (variant->function_name[RAST_EDGE_TEST])
@@ -31,6 +31,7 @@
 
 
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/compiler.h"
 #include "pipe/p_state.h"
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
@@ -155,6 +156,12 @@ struct lp_fragment_shader_variant
 
    struct gallivm_state *gallivm;
 
+   /* With LP_ASYNC_FS_COMPILE, 'gallivm' holds unoptimized code until the
+    * optimized jit_function[] built in 'async_gallivm' get swapped in.
+    */
+   struct gallivm_state *async_gallivm;
+   struct util_queue_fence async_fence;
+
    LLVMTypeRef jit_context_type;
    LLVMTypeRef jit_context_ptr_type;
    LLVMTypeRef jit_thread_data_type;
@@ -5,6 +5,7 @@
 
 #include "lvp_acceleration_structure.h"
 #include "lvp_entrypoints.h"
+#include "lp_screen.h"
 
 #include "util/format/format_utils.h"
 #include "util/half_float.h"
@@ -20,14 +21,18 @@ lvp_GetAccelerationStructureBuildSizesKHR(
    const VkAccelerationStructureBuildGeometryInfoKHR *pBuildInfo,
    const uint32_t *pMaxPrimitiveCounts, VkAccelerationStructureBuildSizesInfoKHR *pSizeInfo)
 {
-   pSizeInfo->buildScratchSize = 64;
-   pSizeInfo->updateScratchSize = 64;
-
    uint32_t leaf_count = 0;
    for (uint32_t i = 0; i < pBuildInfo->geometryCount; i++)
       leaf_count += pMaxPrimitiveCounts[i];
 
-   uint32_t internal_count = MAX2(leaf_count, 2) - 1;
+   /* The leaf bounds followed by the scratch memory of lvp_build_bvh().
+    * Updates are full rebuilds.
+    */
+   uint64_t scratch_size = leaf_count * sizeof(lvp_aabb) + lvp_bvh_build_scratch_size(leaf_count);
+   pSizeInfo->buildScratchSize = MAX2(scratch_size, 64);
+   pSizeInfo->updateScratchSize = MAX2(scratch_size, 64);
+
+   uint32_t internal_count = lvp_bvh_max_internal_nodes(leaf_count);
 
    VkGeometryTypeKHR geometry_type = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
    if (pBuildInfo->geometryCount) {
@@ -140,129 +145,62 @@ lvp_pack_sbt_offset_and_flags(uint32_t sbt_offset, VkGeometryInstanceFlagsKHR fl
    return ret;
 }
 
-struct lvp_build_internal_ctx {
-   uint8_t *dst;
-   uint32_t dst_offset;
-
-   void *leaf_nodes;
-   uint32_t leaf_nodes_offset;
-   uint32_t leaf_node_type;
-   uint32_t leaf_node_size;
-};
-
-static uint32_t
-lvp_build_internal_node(struct lvp_build_internal_ctx *ctx, uint32_t first_leaf, uint32_t last_leaf)
+static void
+lvp_leaf_node_bounds(uint32_t leaf_node_type, const void *leaf_node, lvp_aabb *aabb)
 {
-   uint32_t dst_offset = ctx->dst_offset;
-   ctx->dst_offset += sizeof(struct lvp_bvh_box_node);
-
-   uint32_t node_id = dst_offset | lvp_bvh_node_internal;
+   switch (leaf_node_type) {
+   case lvp_bvh_node_triangle: {
+      const struct lvp_bvh_triangle_node *triangle = leaf_node;
 
-   struct lvp_bvh_box_node *node = (void *)(ctx->dst + dst_offset);
+      aabb->min.x = MIN3(triangle->coords[0][0], triangle->coords[1][0], triangle->coords[2][0]);
+      aabb->min.y = MIN3(triangle->coords[0][1], triangle->coords[1][1], triangle->coords[2][1]);
+      aabb->min.z = MIN3(triangle->coords[0][2], triangle->coords[1][2], triangle->coords[2][2]);
 
-   uint32_t split = (first_leaf + last_leaf) / 2;
+      aabb->max.x = MAX3(triangle->coords[0][0], triangle->coords[1][0], triangle->coords[2][0]);
+      aabb->max.y = MAX3(triangle->coords[0][1], triangle->coords[1][1], triangle->coords[2][1]);
+      aabb->max.z = MAX3(triangle->coords[0][2], triangle->coords[1][2], triangle->coords[2][2]);
 
-   if (first_leaf < split)
-      node->children[0] = lvp_build_internal_node(ctx, first_leaf, split);
-   else
-      node->children[0] =
-         (ctx->leaf_nodes_offset + (first_leaf * ctx->leaf_node_size)) | ctx->leaf_node_type;
-
-   if (first_leaf < last_leaf) {
-      if (split + 1 < last_leaf)
-         node->children[1] = lvp_build_internal_node(ctx, split + 1, last_leaf);
-      else
-         node->children[1] =
-            (ctx->leaf_nodes_offset + (last_leaf * ctx->leaf_node_size)) | ctx->leaf_node_type;
-   } else {
-      node->children[1] = LVP_BVH_INVALID_NODE;
+      break;
    }
-
-   for (uint32_t i = 0; i < 2; i++) {
-      struct lvp_aabb *aabb = &node->bounds[i];
-
-      if (node->children[i] == LVP_BVH_INVALID_NODE) {
-         aabb->min.x = INFINITY;
-         aabb->min.y = INFINITY;
-         aabb->min.z = INFINITY;
-         aabb->max.x = -INFINITY;
-         aabb->max.y = -INFINITY;
-         aabb->max.z = -INFINITY;
-         continue;
-      }
-
-      uint32_t child_offset = node->children[i] & (~3u);
-      uint32_t child_type = node->children[i] & 3u;
-      void *child_node = (void *)(ctx->dst + child_offset);
-
-      switch (child_type) {
-      case lvp_bvh_node_triangle: {
-         struct lvp_bvh_triangle_node *triangle = child_node;
-
-         aabb->min.x = MIN3(triangle->coords[0][0], triangle->coords[1][0], triangle->coords[2][0]);
-         aabb->min.y = MIN3(triangle->coords[0][1], triangle->coords[1][1], triangle->coords[2][1]);
-         aabb->min.z = MIN3(triangle->coords[0][2], triangle->coords[1][2], triangle->coords[2][2]);
-
-         aabb->max.x = MAX3(triangle->coords[0][0], triangle->coords[1][0], triangle->coords[2][0]);
-         aabb->max.y = MAX3(triangle->coords[0][1], triangle->coords[1][1], triangle->coords[2][1]);
-         aabb->max.z = MAX3(triangle->coords[0][2], triangle->coords[1][2], triangle->coords[2][2]);
-
-         break;
-      }
-      case lvp_bvh_node_internal: {
-         struct lvp_bvh_box_node *box = child_node;
-
-         aabb->min.x = MIN2(box->bounds[0].min.x, box->bounds[1].min.x);
-         aabb->min.y = MIN2(box->bounds[0].min.y, box->bounds[1].min.y);
-         aabb->min.z = MIN2(box->bounds[0].min.z, box->bounds[1].min.z);
-
-         aabb->max.x = MAX2(box->bounds[0].max.x, box->bounds[1].max.x);
-         aabb->max.y = MAX2(box->bounds[0].max.y, box->bounds[1].max.y);
-         aabb->max.z = MAX2(box->bounds[0].max.z, box->bounds[1].max.z);
-
-         break;
-      }
-      case lvp_bvh_node_instance: {
-         struct lvp_bvh_instance_node *instance = child_node;
-         struct lvp_bvh_header *instance_header = (void *)(uintptr_t)instance->bvh_ptr;
-
-         float bounds[2][3];
-
-         float header_bounds[2][3];
-         memcpy(header_bounds, &instance_header->bounds, sizeof(struct lvp_aabb));
-
-         for (unsigned j = 0; j < 3; ++j) {
-            bounds[0][j] = instance->otw_matrix.values[j][3];
-            bounds[1][j] = instance->otw_matrix.values[j][3];
-            for (unsigned k = 0; k < 3; ++k) {
-               bounds[0][j] += MIN2(instance->otw_matrix.values[j][k] * header_bounds[0][k],
-                                    instance->otw_matrix.values[j][k] * header_bounds[1][k]);
-               bounds[1][j] += MAX2(instance->otw_matrix.values[j][k] * header_bounds[0][k],
-                                    instance->otw_matrix.values[j][k] * header_bounds[1][k]);
-            }
+   case lvp_bvh_node_instance: {
+      const struct lvp_bvh_instance_node *instance = leaf_node;
+      struct lvp_bvh_header *instance_header = (void *)(uintptr_t)instance->bvh_ptr;
+
+      float bounds[2][3];
+
+      float header_bounds[2][3];
+      memcpy(header_bounds, &instance_header->bounds, sizeof(struct lvp_aabb));
+
+      for (unsigned j = 0; j < 3; ++j) {
+         bounds[0][j] = instance->otw_matrix.values[j][3];
+         bounds[1][j] = instance->otw_matrix.values[j][3];
+         for (unsigned k = 0; k < 3; ++k) {
+            bounds[0][j] += MIN2(instance->otw_matrix.values[j][k] * header_bounds[0][k],
+                                 instance->otw_matrix.values[j][k] * header_bounds[1][k]);
+            bounds[1][j] += MAX2(instance->otw_matrix.values[j][k] * header_bounds[0][k],
+                                 instance->otw_matrix.values[j][k] * header_bounds[1][k]);
          }
-
-         memcpy(aabb, bounds, sizeof(struct lvp_aabb));
-
-         break;
       }
-      case lvp_bvh_node_aabb: {
-         struct lvp_bvh_aabb_node *aabb_node = child_node;
 
-         memcpy(aabb, &aabb_node->bounds, sizeof(struct lvp_aabb));
+      memcpy(aabb, bounds, sizeof(struct lvp_aabb));
 
-         break;
-      }
-      default:
-         unreachable("Invalid node type");
-      }
+      break;
    }
+   case lvp_bvh_node_aabb: {
+      const struct lvp_bvh_aabb_node *aabb_node = leaf_node;
+
+      memcpy(aabb, &aabb_node->bounds, sizeof(struct lvp_aabb));
 
-   return node_id;
+      break;
+   }
+   default:
+      unreachable("Invalid node type");
+   }
 }
 
 void
-lvp_build_acceleration_structure(VkAccelerationStructureBuildGeometryInfoKHR *info,
+lvp_build_acceleration_structure(struct lvp_device *device,
+                                 VkAccelerationStructureBuildGeometryInfoKHR *info,
                                  const VkAccelerationStructureBuildRangeInfoKHR *ranges)
 {
    VK_FROM_HANDLE(vk_acceleration_structure, accel_struct, info->dstAccelerationStructure);
@@ -273,25 +211,11 @@ lvp_build_acceleration_structure(VkAccelerationStructureBuildGeometryInfoKHR *in
    struct lvp_bvh_header *header = dst;
    header->instance_count = 0;
 
-   struct lvp_bvh_box_node *root = (void *)((uint8_t *)dst + sizeof(struct lvp_bvh_header));
-
    uint32_t leaf_count = 0;
    for (unsigned i = 0; i < info->geometryCount; i++)
       leaf_count += ranges[i].primitiveCount;
 
-   if (!leaf_count) {
-      for (uint32_t i = 0; i < 2; i++) {
-         root->bounds[i].min.x = INFINITY;
-         root->bounds[i].min.y = INFINITY;
-         root->bounds[i].min.z = INFINITY;
-         root->bounds[i].max.x = -INFINITY;
-         root->bounds[i].max.y = -INFINITY;
-         root->bounds[i].max.z = -INFINITY;
-      }
-      return;
-   }
-
-   uint32_t internal_count = MAX2(leaf_count, 2) - 1;
+   uint32_t internal_count = lvp_bvh_max_internal_nodes(leaf_count);
 
    uint32_t primitive_index = 0;
 
@@ -558,12 +482,11 @@ lvp_build_acceleration_structure(VkAccelerationStructureBuildGeometryInfoKHR *in
 
    leaf_count = primitive_index;
 
-   struct lvp_build_internal_ctx internal_ctx = {
+   struct lvp_bvh_build_args build_args = {
       .dst = dst,
-      .dst_offset = sizeof(struct lvp_bvh_header),
-
-      .leaf_nodes = leaf_nodes,
       .leaf_nodes_offset = header->leaf_nodes_offset,
+      .flags = info->flags,
+      .tpool = llvmpipe_screen(device->pscreen)->cs_tpool,
    };
 
    VkGeometryTypeKHR geometry_type = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
@@ -576,35 +499,32 @@ lvp_build_acceleration_structure(VkAccelerationStructureBuildGeometryInfoKHR *in
 
    switch (geometry_type) {
    case VK_GEOMETRY_TYPE_TRIANGLES_KHR:
-      internal_ctx.leaf_node_type = lvp_bvh_node_triangle;
-      internal_ctx.leaf_node_size = sizeof(struct lvp_bvh_triangle_node);
+      build_args.leaf_node_type = lvp_bvh_node_triangle;
+      build_args.leaf_node_size = sizeof(struct lvp_bvh_triangle_node);
       break;
    case VK_GEOMETRY_TYPE_AABBS_KHR:
-      internal_ctx.leaf_node_type = lvp_bvh_node_aabb;
-      internal_ctx.leaf_node_size = sizeof(struct lvp_bvh_aabb_node);
+      build_args.leaf_node_type = lvp_bvh_node_aabb;
+      build_args.leaf_node_size = sizeof(struct lvp_bvh_aabb_node);
       break;
    case VK_GEOMETRY_TYPE_INSTANCES_KHR:
-      internal_ctx.leaf_node_type = lvp_bvh_node_instance;
-      internal_ctx.leaf_node_size = sizeof(struct lvp_bvh_instance_node);
+      build_args.leaf_node_type = lvp_bvh_node_instance;
+      build_args.leaf_node_size = sizeof(struct lvp_bvh_instance_node);
       break;
    default:
       unreachable("Unknown VkGeometryTypeKHR");
    }
 
-   if (leaf_count) {
-      lvp_build_internal_node(&internal_ctx, 0, leaf_count - 1);
-   } else {
-      root->children[0] = LVP_BVH_INVALID_NODE;
-      root->children[1] = LVP_BVH_INVALID_NODE;
+   lvp_aabb *leaf_bounds = (void *)(uintptr_t)info->scratchData.deviceAddress;
+   for (uint32_t i = 0; i < leaf_count; i++) {
+      lvp_leaf_node_bounds(build_args.leaf_node_type,
+                           (uint8_t *)leaf_nodes + i * build_args.leaf_node_size,
+                           &leaf_bounds[i]);
    }
 
-   header->bounds.min.x = MIN2(root->bounds[0].min.x, root->bounds[1].min.x);
-   header->bounds.min.y = MIN2(root->bounds[0].min.y, root->bounds[1].min.y);
-   header->bounds.min.z = MIN2(root->bounds[0].min.z, root->bounds[1].min.z);
-
-   header->bounds.max.x = MAX2(root->bounds[0].max.x, root->bounds[1].max.x);
-   header->bounds.max.y = MAX2(root->bounds[0].max.y, root->bounds[1].max.y);
-   header->bounds.max.z = MAX2(root->bounds[0].max.z, root->bounds[1].max.z);
+   build_args.leaf_bounds = leaf_bounds;
+   build_args.leaf_count = leaf_count;
+   build_args.scratch = leaf_bounds + leaf_count;
+   lvp_build_bvh(&build_args);
 
    header->serialization_size = sizeof(struct lvp_accel_struct_serialization_header) +
                                 sizeof(uint64_t) * header->instance_count + accel_struct->size;
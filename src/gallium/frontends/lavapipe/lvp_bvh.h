@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2021 Google
+ * Copyright © 2023 Valve Corporation
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LVP_BVH_H
+#define LVP_BVH_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vulkan/vulkan_core.h>
+
+#define LVP_GEOMETRY_OPAQUE (1u << 31)
+
+#define LVP_INSTANCE_FORCE_OPAQUE                 (1u << 31)
+#define LVP_INSTANCE_NO_FORCE_NOT_OPAQUE          (1u << 30)
+#define LVP_INSTANCE_TRIANGLE_FACING_CULL_DISABLE (1u << 29)
+#define LVP_INSTANCE_TRIANGLE_FLIP_FACING         (1u << 28)
+
+#define lvp_bvh_node_triangle 0
+#define lvp_bvh_node_internal 1
+#define lvp_bvh_node_instance 2
+#define lvp_bvh_node_aabb     3
+
+typedef struct {
+   float values[3][4];
+} lvp_mat3x4;
+
+typedef struct {
+   float x;
+   float y;
+   float z;
+} lvp_vec3;
+
+typedef struct lvp_aabb {
+   lvp_vec3 min;
+   lvp_vec3 max;
+} lvp_aabb;
+
+struct lvp_bvh_triangle_node {
+   float coords[3][3];
+
+   uint32_t padding;
+
+   uint32_t primitive_id;
+   /* flags in upper 4 bits */
+   uint32_t geometry_id_and_flags;
+};
+
+struct lvp_bvh_aabb_node {
+   lvp_aabb bounds;
+
+   uint32_t primitive_id;
+   /* flags in upper 4 bits */
+   uint32_t geometry_id_and_flags;
+};
+
+struct lvp_bvh_instance_node {
+   uint64_t bvh_ptr;
+
+   /* lower 24 bits are the custom instance index, upper 8 bits are the visibility mask */
+   uint32_t custom_instance_and_mask;
+   /* lower 24 bits are the sbt offset, upper 8 bits are VkGeometryInstanceFlagsKHR */
+   uint32_t sbt_offset_and_flags;
+
+   lvp_mat3x4 wto_matrix;
+   uint32_t padding;
+
+   uint32_t instance_id;
+
+   /* Object to world matrix transposed from the initial transform. */
+   lvp_mat3x4 otw_matrix;
+};
+
+#define LVP_BVH_NODE_WIDTH 4
+
+/* Internal node with up to LVP_BVH_NODE_WIDTH children.  The child bounds
+ * are quantized to 8 bits per axis: a stored value q stands for
+ * origin + q * 2^exponent.  Minimums are rounded down and maximums up, so
+ * the quantized bounds always contain the child.  Unused children are
+ * LVP_BVH_INVALID_NODE.
+ */
+struct lvp_bvh_box_node {
+   lvp_vec3 origin;
+   int8_t exponent[3];
+   uint8_t padding;
+
+   /* Indexed by axis and then by child, so that all children can be
+    * tested with vector operations.
+    */
+   uint8_t min[3][LVP_BVH_NODE_WIDTH];
+   uint8_t max[3][LVP_BVH_NODE_WIDTH];
+
+   uint32_t children[LVP_BVH_NODE_WIDTH];
+};
+
+struct lvp_bvh_header {
+   lvp_aabb bounds;
+
+   uint32_t serialization_size;
+   uint32_t instance_count;
+   uint32_t leaf_nodes_offset;
+
+   uint32_t padding;
+};
+
+/* The root node is the first node after the header. */
+#define LVP_BVH_ROOT_NODE_OFFSET (sizeof(struct lvp_bvh_header))
+#define LVP_BVH_ROOT_NODE        (LVP_BVH_ROOT_NODE_OFFSET | lvp_bvh_node_internal)
+#define LVP_BVH_INVALID_NODE     0xFFFFFFFF
+
+/* Maximum depth of the binary tree that is collapsed into the BVH. */
+#define LVP_BVH_MAX_DEPTH 24
+
+/* Each internal node collapses at least two levels of the binary tree, and
+ * traversal pushes at most LVP_BVH_NODE_WIDTH - 1 children per node.
+ */
+#define LVP_BVH_STACK_SIZE ((LVP_BVH_NODE_WIDTH - 1) * ((LVP_BVH_MAX_DEPTH + 1) / 2))
+
+/* Only nodes with nothing but leaf children have fewer than
+ * LVP_BVH_NODE_WIDTH children, which bounds the number of internal nodes
+ * to 2/3 of the number of leaves.
+ */
+static inline uint32_t
+lvp_bvh_max_internal_nodes(uint32_t leaf_count)
+{
+   return leaf_count > 1 ? (uint32_t)(((uint64_t)leaf_count * 2 + 2) / 3) : 1;
+}
+
+static inline void
+lvp_bvh_box_node_child_bounds(const struct lvp_bvh_box_node *node, unsigned child,
+                              lvp_aabb *bounds)
+{
+   float *min = &bounds->min.x, *max = &bounds->max.x;
+
+   for (unsigned axis = 0; axis < 3; axis++) {
+      float scale = ldexpf(1.0f, node->exponent[axis]);
+      min[axis] = (&node->origin.x)[axis] + node->min[axis][child] * scale;
+      max[axis] = (&node->origin.x)[axis] + node->max[axis][child] * scale;
+   }
+}
+
+struct lp_cs_tpool;
+
+struct lvp_bvh_build_args {
+   /* Start of the BVH, the internal nodes are written after the header. */
+   void *dst;
+
+   /* Bounds of the leaf nodes, which are stored at leaf_nodes_offset. */
+   const lvp_aabb *leaf_bounds;
+   uint32_t leaf_count;
+   uint32_t leaf_nodes_offset;
+   uint32_t leaf_node_type;
+   uint32_t leaf_node_size;
+
+   /* VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE/BUILD_BIT_KHR */
+   VkBuildAccelerationStructureFlagsKHR flags;
+
+   /* Used to build subtrees in parallel, may be NULL. */
+   struct lp_cs_tpool *tpool;
+
+   /* At least lvp_bvh_build_scratch_size(leaf_count) bytes, 4 byte aligned */
+   void *scratch;
+};
+
+uint64_t
+lvp_bvh_build_scratch_size(uint32_t leaf_count);
+
+void
+lvp_build_bvh(const struct lvp_bvh_build_args *args);
+
+#endif
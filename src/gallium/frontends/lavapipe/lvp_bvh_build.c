@@ -0,0 +1,586 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Binned SAH BVH builder.
+ *
+ * A binary tree is built first.  The leaves are sorted top-down: each range
+ * of leaves is split where the surface area heuristic, evaluated at the
+ * boundaries of a fixed number of centroid bins, is lowest.  Every binary
+ * node has exactly two children and every leaf node is referenced by
+ * exactly one binary node, so a range of n leaves always needs n - 1 binary
+ * nodes.  This makes the position of every node known up front: the left
+ * child of a node directly follows it and the right child follows the left
+ * subtree.  Subtrees can therefore be built on different threads without
+ * any synchronization.
+ *
+ * The binary tree is then collapsed into LVP_BVH_NODE_WIDTH wide nodes with
+ * quantized bounds.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "lvp_bvh.h"
+#include "lp_cs_tpool.h"
+
+#include "util/macros.h"
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+
+#define LVP_BVH_MAX_BINS 32
+
+/* Subtrees with fewer leaves are not split off into separate tasks. */
+#define LVP_BVH_MIN_TASK_LEAVES 4096
+
+/* Set in the children of binary nodes which are leaves */
+#define LVP_BVH_BUILD_LEAF (1u << 31)
+
+struct lvp_bvh_binary_node {
+   lvp_aabb bounds[2];
+   uint32_t children[2];
+};
+
+struct lvp_bvh_build_ref {
+   lvp_aabb bounds;
+   uint32_t leaf;
+};
+
+struct lvp_bvh_build_job {
+   /* Range of refs */
+   uint32_t begin, end;
+
+   /* Index of the binary node */
+   uint32_t node;
+   uint32_t depth;
+};
+
+struct lvp_bvh_bin {
+   lvp_aabb bounds;
+   uint32_t count;
+};
+
+struct lvp_bvh_builder {
+   const struct lvp_bvh_build_args *args;
+
+   /* Only the active leaves have a ref. */
+   struct lvp_bvh_build_ref *refs;
+   uint32_t num_refs;
+
+   struct lvp_bvh_binary_node *nodes;
+
+   unsigned num_bins;
+   bool all_axes;
+
+   /* Subtrees with at most task_leaves leaves are appended to jobs instead
+    * of being built right away.
+    */
+   bool defer_jobs;
+   uint32_t task_leaves;
+   struct util_dynarray jobs;
+};
+
+static inline void
+aabb_init_empty(lvp_aabb *aabb)
+{
+   aabb->min.x = INFINITY;
+   aabb->min.y = INFINITY;
+   aabb->min.z = INFINITY;
+   aabb->max.x = -INFINITY;
+   aabb->max.y = -INFINITY;
+   aabb->max.z = -INFINITY;
+}
+
+/* NaNs in other are ignored, the comparisons are false for them. */
+static inline void
+aabb_extend(lvp_aabb *aabb, const lvp_aabb *other)
+{
+   aabb->min.x = MIN2(other->min.x, aabb->min.x);
+   aabb->min.y = MIN2(other->min.y, aabb->min.y);
+   aabb->min.z = MIN2(other->min.z, aabb->min.z);
+   aabb->max.x = MAX2(other->max.x, aabb->max.x);
+   aabb->max.y = MAX2(other->max.y, aabb->max.y);
+   aabb->max.z = MAX2(other->max.z, aabb->max.z);
+}
+
+/* If x of the aabb min is NaN, then this is an inactive aabb which can never
+ * be hit.
+ */
+static inline bool
+aabb_is_inactive(const lvp_aabb *aabb)
+{
+   return isnan(aabb->min.x);
+}
+
+static inline float
+aabb_half_area(const lvp_aabb *aabb)
+{
+   float x = aabb->max.x - aabb->min.x;
+   float y = aabb->max.y - aabb->min.y;
+   float z = aabb->max.z - aabb->min.z;
+
+   if (!(x >= 0.0f && y >= 0.0f && z >= 0.0f))
+      return 0.0f;
+
+   return x * y + y * z + z * x;
+}
+
+static inline float
+vec3_get(const lvp_vec3 *v, unsigned axis)
+{
+   return (&v->x)[axis];
+}
+
+/* Twice the centroid, which avoids a multiplication and bins the same. */
+static inline float
+ref_centroid(const struct lvp_bvh_build_ref *ref, unsigned axis)
+{
+   return vec3_get(&ref->bounds.min, axis) + vec3_get(&ref->bounds.max, axis);
+}
+
+static inline unsigned
+ref_bin(const struct lvp_bvh_build_ref *ref, unsigned axis, float offset, float scale,
+        unsigned num_bins)
+{
+   float bin = (ref_centroid(ref, axis) - offset) * scale;
+
+   /* This also takes care of NaNs */
+   if (!(bin > 0.0f))
+      return 0;
+
+   return MIN2((unsigned)bin, num_bins - 1);
+}
+
+static uint32_t
+median_split(struct lvp_bvh_builder *b, uint32_t begin, uint32_t end, lvp_aabb child_bounds[2])
+{
+   uint32_t mid = begin + (end - begin) / 2;
+
+   aabb_init_empty(&child_bounds[0]);
+   aabb_init_empty(&child_bounds[1]);
+   for (uint32_t i = begin; i < end; i++)
+      aabb_extend(&child_bounds[i >= mid], &b->refs[i].bounds);
+
+   return mid;
+}
+
+/**
+ * Split the refs [begin, end) into two non-empty ranges.
+ *
+ * \return the first ref of the second range
+ */
+static uint32_t
+find_split(struct lvp_bvh_builder *b, uint32_t begin, uint32_t end, uint32_t depth,
+           lvp_aabb child_bounds[2])
+{
+   const uint32_t count = end - begin;
+   const unsigned num_bins = b->num_bins;
+
+   /* Median splits are balanced and are used when an unbalanced split could
+    * push the depth of the subtree past LVP_BVH_MAX_DEPTH.
+    */
+   if (depth + 1 + util_logbase2_ceil(count - 1) >= LVP_BVH_MAX_DEPTH)
+      return median_split(b, begin, end, child_bounds);
+
+   lvp_aabb centroid_bounds;
+   aabb_init_empty(&centroid_bounds);
+   for (uint32_t i = begin; i < end; i++) {
+      const struct lvp_bvh_build_ref *ref = &b->refs[i];
+      lvp_aabb centroid = {
+         .min = {ref_centroid(ref, 0), ref_centroid(ref, 1), ref_centroid(ref, 2)},
+         .max = {ref_centroid(ref, 0), ref_centroid(ref, 1), ref_centroid(ref, 2)},
+      };
+      aabb_extend(&centroid_bounds, &centroid);
+   }
+
+   float offset[3], scale[3];
+   bool active[3];
+   unsigned widest = 0;
+   for (unsigned axis = 0; axis < 3; axis++) {
+      float extent = vec3_get(&centroid_bounds.max, axis) - vec3_get(&centroid_bounds.min, axis);
+
+      offset[axis] = vec3_get(&centroid_bounds.min, axis);
+      scale[axis] = extent > 0.0f ? num_bins / extent : 0.0f;
+      active[axis] = extent > 0.0f && isfinite(scale[axis]);
+
+      if (extent > vec3_get(&centroid_bounds.max, widest) - vec3_get(&centroid_bounds.min, widest))
+         widest = axis;
+   }
+
+   if (!b->all_axes) {
+      for (unsigned axis = 0; axis < 3; axis++)
+         active[axis] &= axis == widest;
+   }
+
+   if (!active[0] && !active[1] && !active[2])
+      return median_split(b, begin, end, child_bounds);
+
+   struct lvp_bvh_bin bins[3][LVP_BVH_MAX_BINS];
+   for (unsigned axis = 0; axis < 3; axis++) {
+      for (unsigned i = 0; i < num_bins; i++) {
+         aabb_init_empty(&bins[axis][i].bounds);
+         bins[axis][i].count = 0;
+      }
+   }
+
+   for (uint32_t i = begin; i < end; i++) {
+      const struct lvp_bvh_build_ref *ref = &b->refs[i];
+      for (unsigned axis = 0; axis < 3; axis++) {
+         if (!active[axis])
+            continue;
+
+         struct lvp_bvh_bin *bin =
+            &bins[axis][ref_bin(ref, axis, offset[axis], scale[axis], num_bins)];
+         aabb_extend(&bin->bounds, &ref->bounds);
+         bin->count++;
+      }
+   }
+
+   /* Cost of splitting after bin i is area(left) * count(left) +
+    * area(right) * count(right).
+    */
+   float best_cost = INFINITY;
+   unsigned best_axis = 0, best_bin = 0;
+   for (unsigned axis = 0; axis < 3; axis++) {
+      if (!active[axis])
+         continue;
+
+      float right_cost[LVP_BVH_MAX_BINS];
+      lvp_aabb bounds;
+      uint32_t n = 0;
+
+      aabb_init_empty(&bounds);
+      for (unsigned i = num_bins - 1; i > 0; i--) {
+         aabb_extend(&bounds, &bins[axis][i].bounds);
+         n += bins[axis][i].count;
+         right_cost[i - 1] = n ? aabb_half_area(&bounds) * n : INFINITY;
+      }
+
+      aabb_init_empty(&bounds);
+      n = 0;
+      for (unsigned i = 0; i < num_bins - 1; i++) {
+         aabb_extend(&bounds, &bins[axis][i].bounds);
+         n += bins[axis][i].count;
+         if (!n)
+            continue;
+
+         float cost = aabb_half_area(&bounds) * n + right_cost[i];
+         if (cost < best_cost) {
+            best_cost = cost;
+            best_axis = axis;
+            best_bin = i;
+         }
+      }
+   }
+
+   if (!(best_cost < INFINITY))
+      return median_split(b, begin, end, child_bounds);
+
+   aabb_init_empty(&child_bounds[0]);
+   aabb_init_empty(&child_bounds[1]);
+   for (unsigned i = 0; i < num_bins; i++)
+      aabb_extend(&child_bounds[i > best_bin], &bins[best_axis][i].bounds);
+
+   uint32_t left = begin, right = end;
+   while (left < right) {
+      if (ref_bin(&b->refs[left], best_axis, offset[best_axis], scale[best_axis], num_bins) <=
+          best_bin) {
+         left++;
+      } else {
+         right--;
+         struct lvp_bvh_build_ref tmp = b->refs[left];
+         b->refs[left] = b->refs[right];
+         b->refs[right] = tmp;
+      }
+   }
+
+   assert(left > begin && left < end);
+   return left;
+}
+
+static void
+build_node(struct lvp_bvh_builder *b, const struct lvp_bvh_build_job *job)
+{
+   lvp_aabb child_bounds[2];
+   uint32_t mid = find_split(b, job->begin, job->end, job->depth, child_bounds);
+
+   /* A subtree with n leaves has n - 1 internal nodes. */
+   struct lvp_bvh_build_job children[2] = {
+      {job->begin, mid, job->node + 1, job->depth + 1},
+      {mid, job->end, job->node + (mid - job->begin), job->depth + 1},
+   };
+
+   struct lvp_bvh_binary_node *node = &b->nodes[job->node];
+   for (unsigned i = 0; i < 2; i++) {
+      const struct lvp_bvh_build_job *child = &children[i];
+
+      node->bounds[i] = child_bounds[i];
+
+      if (child->end - child->begin == 1) {
+         node->children[i] = b->refs[child->begin].leaf | LVP_BVH_BUILD_LEAF;
+         continue;
+      }
+
+      node->children[i] = child->node;
+
+      struct lvp_bvh_build_job *deferred = NULL;
+      if (b->defer_jobs && child->end - child->begin <= b->task_leaves)
+         deferred = util_dynarray_grow(&b->jobs, struct lvp_bvh_build_job, 1);
+
+      /* Subtrees which can't be deferred are built right away. */
+      if (deferred)
+         *deferred = *child;
+      else
+         build_node(b, child);
+   }
+}
+
+static void
+build_job_task(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   struct lvp_bvh_builder *b = data;
+   build_node(b, util_dynarray_element(&b->jobs, struct lvp_bvh_build_job, iter_idx));
+}
+
+static void
+build_tree(struct lvp_bvh_builder *b)
+{
+   const struct lvp_bvh_build_args *args = b->args;
+   unsigned num_threads = args->tpool ? args->tpool->num_threads : 0;
+
+   util_dynarray_init(&b->jobs, NULL);
+
+   /* Build the top of the tree on this thread and defer the subtrees below
+    * it to the thread pool.  Splitting into more subtrees than there are
+    * threads helps balancing since the subtrees are of uneven size.
+    */
+   if (num_threads > 1 && b->num_refs >= 2 * LVP_BVH_MIN_TASK_LEAVES) {
+      b->defer_jobs = true;
+      b->task_leaves = MAX2(b->num_refs / (num_threads * 4), LVP_BVH_MIN_TASK_LEAVES);
+   }
+
+   struct lvp_bvh_build_job root = {0, b->num_refs, 0, 0};
+   build_node(b, &root);
+
+   b->defer_jobs = false;
+
+   unsigned num_jobs = util_dynarray_num_elements(&b->jobs, struct lvp_bvh_build_job);
+   if (num_jobs) {
+      struct lp_cs_tpool_task *task =
+         lp_cs_tpool_queue_task(args->tpool, build_job_task, b, num_jobs);
+
+      if (task) {
+         lp_cs_tpool_wait_for_task(args->tpool, &task);
+      } else {
+         util_dynarray_foreach (&b->jobs, struct lvp_bvh_build_job, job)
+            build_node(b, job);
+      }
+   }
+
+   util_dynarray_fini(&b->jobs);
+}
+
+static void
+quantize_axis(struct lvp_bvh_box_node *node, unsigned axis, const lvp_aabb *bounds,
+              const lvp_aabb *child_bounds, unsigned num_children)
+{
+   float lo = vec3_get(&bounds->min, axis);
+   float hi = vec3_get(&bounds->max, axis);
+
+   if (!(lo >= -FLT_MAX && hi <= FLT_MAX && lo <= hi)) {
+      lo = -FLT_MAX;
+      hi = FLT_MAX;
+   }
+
+   /* Find the smallest scale at which 255 steps from lo reach hi. */
+   int exponent = -126;
+   float extent = (hi - lo) / 255.0f;
+   if (extent > 0.0f) {
+      frexpf(extent, &exponent);
+      exponent = CLAMP(exponent - 1, -126, 127);
+   }
+   while (exponent < 127 && lo + 255.0f * ldexpf(1.0f, exponent) < hi)
+      exponent++;
+
+   float scale = ldexpf(1.0f, exponent);
+
+   (&node->origin.x)[axis] = lo;
+   node->exponent[axis] = exponent;
+
+   for (unsigned i = 0; i < num_children; i++) {
+      float min = vec3_get(&child_bounds[i].min, axis);
+      float max = vec3_get(&child_bounds[i].max, axis);
+      float qmin = floorf((min - lo) / scale);
+      float qmax = ceilf((max - lo) / scale);
+
+      /* Round outwards, the arithmetic here is inexact. */
+      unsigned q0 = qmin > 0.0f ? MIN2(qmin, 255.0f) : 0;
+      unsigned q1 = qmax < 255.0f ? MAX2(qmax, 0.0f) : 255;
+      while (q0 > 0 && !(lo + q0 * scale <= min))
+         q0--;
+      while (q1 < 255 && !(lo + q1 * scale >= max))
+         q1++;
+
+      node->min[axis][i] = q0;
+      node->max[axis][i] = q1;
+   }
+}
+
+/**
+ * Write the subtree of binary node bin_index as wide node wide_index.
+ */
+static void
+collapse_node(struct lvp_bvh_builder *b, uint32_t bin_index, uint32_t wide_index,
+              uint32_t *num_wide_nodes)
+{
+   const struct lvp_bvh_build_args *args = b->args;
+   const struct lvp_bvh_binary_node *bin = &b->nodes[bin_index];
+
+   uint32_t children[LVP_BVH_NODE_WIDTH];
+   lvp_aabb child_bounds[LVP_BVH_NODE_WIDTH];
+   unsigned child_depth[LVP_BVH_NODE_WIDTH];
+   unsigned num_children = 2;
+
+   for (unsigned i = 0; i < 2; i++) {
+      children[i] = bin->children[i];
+      child_bounds[i] = bin->bounds[i];
+      child_depth[i] = 0;
+   }
+
+   /* Pull up the children of the shallowest binary node, preferring larger
+    * ones.  Taking the shallowest first makes every wide node span at least
+    * two binary levels, which bounds the depth.
+    */
+   while (num_children < LVP_BVH_NODE_WIDTH) {
+      int best = -1;
+      float best_area = 0.0f;
+      for (unsigned i = 0; i < num_children; i++) {
+         if (children[i] & LVP_BVH_BUILD_LEAF)
+            continue;
+
+         float area = aabb_half_area(&child_bounds[i]);
+         if (best < 0 || child_depth[i] < child_depth[best] ||
+             (child_depth[i] == child_depth[best] && area > best_area)) {
+            best = i;
+            best_area = area;
+         }
+      }
+
+      if (best < 0)
+         break;
+
+      const struct lvp_bvh_binary_node *expand = &b->nodes[children[best]];
+      unsigned depth = child_depth[best] + 1;
+
+      children[best] = expand->children[0];
+      child_bounds[best] = expand->bounds[0];
+      child_depth[best] = depth;
+
+      children[num_children] = expand->children[1];
+      child_bounds[num_children] = expand->bounds[1];
+      child_depth[num_children] = depth;
+      num_children++;
+   }
+
+   struct lvp_bvh_box_node *node = (void *)((uint8_t *)args->dst + sizeof(struct lvp_bvh_header) +
+                                            wide_index * sizeof(struct lvp_bvh_box_node));
+
+   lvp_aabb bounds = bin->bounds[0];
+   aabb_extend(&bounds, &bin->bounds[1]);
+
+   for (unsigned axis = 0; axis < 3; axis++)
+      quantize_axis(node, axis, &bounds, child_bounds, num_children);
+
+   for (unsigned i = 0; i < LVP_BVH_NODE_WIDTH; i++) {
+      if (i >= num_children) {
+         node->children[i] = LVP_BVH_INVALID_NODE;
+      } else if (children[i] & LVP_BVH_BUILD_LEAF) {
+         uint32_t leaf = children[i] & ~LVP_BVH_BUILD_LEAF;
+         node->children[i] = (args->leaf_nodes_offset + leaf * args->leaf_node_size) |
+                             args->leaf_node_type;
+      } else {
+         uint32_t child_index = (*num_wide_nodes)++;
+
+         node->children[i] = (sizeof(struct lvp_bvh_header) +
+                              child_index * sizeof(struct lvp_bvh_box_node)) |
+                             lvp_bvh_node_internal;
+         collapse_node(b, children[i], child_index, num_wide_nodes);
+      }
+   }
+}
+
+uint64_t
+lvp_bvh_build_scratch_size(uint32_t leaf_count)
+{
+   return (uint64_t)leaf_count *
+          (sizeof(struct lvp_bvh_build_ref) + sizeof(struct lvp_bvh_binary_node));
+}
+
+void
+lvp_build_bvh(const struct lvp_bvh_build_args *args)
+{
+   struct lvp_bvh_header *header = args->dst;
+   struct lvp_bvh_box_node *root =
+      (void *)((uint8_t *)args->dst + sizeof(struct lvp_bvh_header));
+
+   aabb_init_empty(&header->bounds);
+
+   memset(root, 0, sizeof(*root));
+   for (uint32_t i = 0; i < LVP_BVH_NODE_WIDTH; i++)
+      root->children[i] = LVP_BVH_INVALID_NODE;
+
+   if (!args->leaf_count)
+      return;
+
+   struct lvp_bvh_builder b = {
+      .args = args,
+   };
+
+   /* The refs are followed by the binary nodes in the scratch memory. */
+   b.refs = args->scratch;
+
+   /* Inactive leaves are left out of the tree, their NaN bounds would
+    * otherwise end up in the bins and in the bounds of the nodes.
+    */
+   for (uint32_t i = 0; i < args->leaf_count; i++) {
+      if (aabb_is_inactive(&args->leaf_bounds[i]))
+         continue;
+
+      b.refs[b.num_refs].bounds = args->leaf_bounds[i];
+      b.refs[b.num_refs].leaf = i;
+      b.num_refs++;
+   }
+
+   if (b.num_refs == 1) {
+      header->bounds = b.refs[0].bounds;
+      for (unsigned axis = 0; axis < 3; axis++)
+         quantize_axis(root, axis, &header->bounds, &header->bounds, 1);
+      root->children[0] = (args->leaf_nodes_offset + b.refs[0].leaf * args->leaf_node_size) |
+                          args->leaf_node_type;
+   } else if (b.num_refs > 1) {
+      if (args->flags & VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR) {
+         b.num_bins = 32;
+         b.all_axes = true;
+      } else if (args->flags & VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR) {
+         b.num_bins = 8;
+         b.all_axes = false;
+      } else {
+         b.num_bins = 16;
+         b.all_axes = true;
+      }
+      assert(b.num_bins <= LVP_BVH_MAX_BINS);
+
+      b.nodes = (void *)(b.refs + args->leaf_count);
+
+      build_tree(&b);
+
+      uint32_t num_wide_nodes = 1;
+      collapse_node(&b, 0, 0, &num_wide_nodes);
+      assert(num_wide_nodes <= lvp_bvh_max_internal_nodes(b.num_refs));
+
+      header->bounds = b.nodes[0].bounds[0];
+      aabb_extend(&header->bounds, &b.nodes[0].bounds[1]);
+   }
+}
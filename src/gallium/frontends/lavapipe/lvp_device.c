@@ -40,6 +40,7 @@
 #include "util/os_time.h"
 #include "util/u_thread.h"
 #include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/timespec.h"
 #include "util/ptralloc.h"
 #include "nir.h"
@@ -1723,6 +1724,13 @@ lvp_queue_init(struct lvp_device *device, struct lvp_queue *queue,
    simple_mtx_init(&queue->lock, mtx_plain);
    util_dynarray_init(&queue->pipeline_destroys, NULL);
 
+   unsigned num_cpus = util_get_cpu_caps()->nr_cpus;
+   if (num_cpus > 1 && debug_get_bool_option("LVP_THREADED_TRANSFERS", false)) {
+      queue->threaded_transfers =
+         util_queue_init(&queue->transfer_queue, "lvp_xfer", 64,
+                         MIN2(num_cpus, 8), UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL);
+   }
+
    return VK_SUCCESS;
 }
 
@@ -1733,6 +1741,8 @@ lvp_queue_finish(struct lvp_queue *queue)
 
    destroy_pipelines(queue);
    simple_mtx_destroy(&queue->lock);
+   if (queue->threaded_transfers)
+      util_queue_destroy(&queue->transfer_queue);
    util_dynarray_fini(&queue->pipeline_destroys);
 
    u_upload_destroy(queue->uploader);
@@ -1802,6 +1812,7 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDevice(
    device->noop_fs = device->queue.ctx->create_fs_state(device->queue.ctx, &shstate);
    _mesa_hash_table_init(&device->bda, NULL, _mesa_hash_pointer, _mesa_key_pointer_equal);
    simple_mtx_init(&device->bda_lock, mtx_plain);
+   lvp_link_cache_init(device);
 
    uint32_t zero = 0;
    device->zero_buffer = pipe_buffer_create_with_data(device->queue.ctx, 0, PIPE_USAGE_IMMUTABLE, sizeof(uint32_t), &zero);
@@ -1850,6 +1861,8 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyDevice(
    pipe_resource_reference(&device->zero_buffer, NULL);
 
    lvp_queue_finish(&device->queue);
+   /* every linked pipeline, and with it every entry, is gone by now */
+   ralloc_free(device->link_cache.table);
    vk_device_finish(&device->vk);
    vk_free(&device->vk.alloc, device);
 }
@@ -254,6 +254,26 @@ get_token_info_size(VkIndirectCommandsTokenTypeEXT type)
    unreachable("unknown token type");
 }
 
+static uint32_t
+get_token_state_size(const VkIndirectCommandsLayoutTokenEXT *token)
+{
+   switch (token->type) {
+   case VK_INDIRECT_COMMANDS_TOKEN_TYPE_VERTEX_BUFFER_EXT:
+      return sizeof(VkBindVertexBufferIndirectCommandEXT);
+   case VK_INDIRECT_COMMANDS_TOKEN_TYPE_PUSH_CONSTANT_EXT:
+      return token->data.pPushConstant->updateRange.size;
+   case VK_INDIRECT_COMMANDS_TOKEN_TYPE_INDEX_BUFFER_EXT:
+      return sizeof(VkBindIndexBufferIndirectCommandEXT);
+   case VK_INDIRECT_COMMANDS_TOKEN_TYPE_EXECUTION_SET_EXT:
+      if (token->data.pExecutionSet->type == VK_INDIRECT_EXECUTION_SET_INFO_TYPE_PIPELINES_EXT)
+         return sizeof(uint32_t);
+      return sizeof(uint32_t) * util_bitcount(token->data.pExecutionSet->shaderStages);
+   default:
+      /* the sequence index differs every time, and actions always run */
+      return 0;
+   }
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateIndirectCommandsLayoutEXT(
     VkDevice                                     _device,
     const VkIndirectCommandsLayoutCreateInfoEXT* pCreateInfo,
@@ -269,7 +289,9 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateIndirectCommandsLayoutEXT(
       token_size += get_token_info_size(token->type);
    }
 
-   elayout = vk_indirect_command_layout_create(&device->vk, pCreateInfo, pAllocator, sizeof(struct lvp_indirect_command_layout_ext) + token_size);
+   size_t plan_size = pCreateInfo->tokenCount * sizeof(struct lvp_indirect_token_plan);
+
+   elayout = vk_indirect_command_layout_create(&device->vk, pCreateInfo, pAllocator, sizeof(struct lvp_indirect_command_layout_ext) + token_size + plan_size);
    if (!elayout)
       return vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
 
@@ -315,6 +337,14 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateIndirectCommandsLayoutEXT(
       }
       ptr += tsize;
    }
+   /* and the replay plan goes last */
+   elayout->plan = (void*)ptr;
+   for (unsigned i = 0; i < pCreateInfo->tokenCount; i++) {
+      const VkIndirectCommandsLayoutTokenEXT *token = &elayout->tokens[i];
+      elayout->plan[i].cmd_type = lvp_ext_dgc_token_to_cmd_type(elayout, token);
+      elayout->plan[i].cmd_size = lvp_ext_dgc_token_size(elayout, token);
+      elayout->plan[i].state_size = get_token_state_size(token);
+   }
 
    *pIndirectCommandsLayout = lvp_indirect_command_layout_ext_to_handle(elayout);
    return VK_SUCCESS;
@@ -40,6 +40,7 @@
 #include "util/u_inlines.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_memset.h"
 #include "util/u_prim.h"
 #include "util/u_prim_restart.h"
 #include "util/format/u_format_zs.h"
@@ -105,6 +106,7 @@ struct rendering_state {
    bool sample_mask_dirty;
    bool min_samples_dirty;
    bool poison_mem;
+   struct util_queue *transfer_queue;
    bool noop_fs_bound;
    struct pipe_draw_indirect_info indirect_info;
    struct pipe_draw_info info;
@@ -1999,6 +2001,10 @@ static void handle_draw(struct vk_cmd_queue_entry *cmd,
    state->pctx->draw_vbo(state->pctx, &state->info, 0, NULL, &draw, 1);
 }
 
+/* driver_data of the multi-draws built by dgc_extend_draw() */
+static const char dgc_merged_draw;
+#define LVP_DGC_MERGED_DRAW ((void *)&dgc_merged_draw)
+
 static void handle_draw_multi(struct vk_cmd_queue_entry *cmd,
                               struct rendering_state *state)
 {
@@ -2009,8 +2015,9 @@ static void handle_draw_multi(struct vk_cmd_queue_entry *cmd,
    state->info.index.resource = NULL;
    state->info.start_instance = cmd->u.draw_multi_ext.first_instance;
    state->info.instance_count = cmd->u.draw_multi_ext.instance_count;
-   if (cmd->u.draw_multi_ext.draw_count > 1)
-      state->info.increment_draw_id = true;
+   /* merged generated-command draws each keep DrawIndex 0 */
+   state->info.increment_draw_id = cmd->u.draw_multi_ext.draw_count > 1 &&
+                                   cmd->driver_data != LVP_DGC_MERGED_DRAW;
 
    for (unsigned i = 0; i < cmd->u.draw_multi_ext.draw_count; i++) {
       draws[i].start = cmd->u.draw_multi_ext.vertex_info[i].firstVertex;
@@ -2620,6 +2627,280 @@ static void handle_update_buffer(struct vk_cmd_queue_entry *cmd,
    state->pctx->buffer_unmap(state->pctx, dst_t);
 }
 
+/* LVP_THREADED_TRANSFERS
+ *
+ * A run of buffer copies/fills/updates with no other command in between is
+ * mapped once on the queue thread, which waits for any rendering that still
+ * references the buffers, and the memcpy/memset work is spread over the
+ * queue's transfer workers in chunks.  The ranges touched by the outstanding
+ * wave of jobs are tracked, and an operation that overlaps a pending write
+ * (or writes over a pending read) waits for the wave first, so the result
+ * matches serial replay even when the app leaves out barriers.
+ */
+#define LVP_XFER_CHUNK_SIZE (256 * 1024)
+#define LVP_XFER_MAX_JOBS 64
+#define LVP_XFER_MAX_RANGES 128
+#define LVP_XFER_MAX_MAPS 16
+
+struct lvp_xfer_job {
+   struct util_queue_fence fence;
+   uint8_t *dst;
+   const uint8_t *src; /* NULL for fills */
+   uint64_t size;
+   uint32_t data;
+};
+
+struct lvp_xfer_range {
+   struct pipe_resource *bo;
+   uint64_t start, end;
+   bool write;
+};
+
+struct lvp_xfer_map {
+   struct pipe_resource *bo;
+   struct pipe_transfer *transfer;
+   uint8_t *ptr;
+};
+
+struct lvp_xfer_run {
+   struct rendering_state *state;
+   struct lvp_xfer_job jobs[LVP_XFER_MAX_JOBS];
+   unsigned num_jobs;
+   struct lvp_xfer_range ranges[LVP_XFER_MAX_RANGES];
+   unsigned num_ranges;
+   struct lvp_xfer_map maps[LVP_XFER_MAX_MAPS];
+   unsigned num_maps;
+};
+
+static void
+xfer_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct lvp_xfer_job *job = data;
+
+   if (job->src)
+      memcpy(job->dst, job->src, job->size);
+   else
+      util_memset32(job->dst, job->data, job->size / 4);
+}
+
+static void
+xfer_wait(struct lvp_xfer_run *run)
+{
+   for (unsigned i = 0; i < run->num_jobs; i++) {
+      util_queue_fence_wait(&run->jobs[i].fence);
+      util_queue_fence_destroy(&run->jobs[i].fence);
+   }
+   run->num_jobs = 0;
+}
+
+static void
+xfer_finish(struct lvp_xfer_run *run)
+{
+   struct pipe_context *pctx = run->state->pctx;
+
+   xfer_wait(run);
+   run->num_ranges = 0;
+
+   for (unsigned i = 0; i < run->num_maps; i++)
+      pctx->buffer_unmap(pctx, run->maps[i].transfer);
+   run->num_maps = 0;
+}
+
+static uint8_t *
+xfer_map(struct lvp_xfer_run *run, struct pipe_resource *bo)
+{
+   struct pipe_context *pctx = run->state->pctx;
+
+   for (unsigned i = 0; i < run->num_maps; i++) {
+      if (run->maps[i].bo == bo)
+         return run->maps[i].ptr;
+   }
+
+   assert(run->num_maps < LVP_XFER_MAX_MAPS);
+   struct lvp_xfer_map *map = &run->maps[run->num_maps++];
+   struct pipe_box box;
+   u_box_1d(0, bo->width0, &box);
+   map->bo = bo;
+   map->ptr = pctx->buffer_map(pctx, bo, 0, PIPE_MAP_READ | PIPE_MAP_WRITE,
+                               &box, &map->transfer);
+   return map->ptr;
+}
+
+static bool
+xfer_ranges_conflict(const struct lvp_xfer_range *a, const struct lvp_xfer_range *b)
+{
+   return a->bo == b->bo && (a->write || b->write) &&
+          a->start < b->end && b->start < a->end;
+}
+
+/* adds the ranges of one operation to the wave, draining the wave first if
+ * the operation depends on anything still in flight
+ */
+static void
+xfer_reserve(struct lvp_xfer_run *run, const struct lvp_xfer_range *ranges, unsigned count)
+{
+   bool conflict = run->num_ranges + count > LVP_XFER_MAX_RANGES;
+
+   for (unsigned i = 0; i < run->num_ranges && !conflict; i++) {
+      for (unsigned j = 0; j < count && !conflict; j++)
+         conflict = xfer_ranges_conflict(&run->ranges[i], &ranges[j]);
+   }
+
+   if (conflict) {
+      xfer_wait(run);
+      run->num_ranges = 0;
+   }
+
+   memcpy(&run->ranges[run->num_ranges], ranges, count * sizeof(*ranges));
+   run->num_ranges += count;
+}
+
+static void
+xfer_submit(struct lvp_xfer_run *run, uint8_t *dst, const uint8_t *src,
+            uint64_t size, uint32_t data)
+{
+   if (size < LVP_XFER_CHUNK_SIZE) {
+      /* not worth the handoff, and nothing in flight overlaps it */
+      struct lvp_xfer_job job = { .dst = dst, .src = src, .size = size, .data = data };
+      xfer_job_execute(&job, NULL, 0);
+      return;
+   }
+
+   for (uint64_t offset = 0; offset < size; offset += LVP_XFER_CHUNK_SIZE) {
+      /* only the job slots are recycled here, the ranges stay reserved */
+      if (run->num_jobs == LVP_XFER_MAX_JOBS)
+         xfer_wait(run);
+
+      struct lvp_xfer_job *job = &run->jobs[run->num_jobs++];
+      job->dst = dst + offset;
+      job->src = src ? src + offset : NULL;
+      job->size = MIN2(size - offset, LVP_XFER_CHUNK_SIZE);
+      job->data = data;
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(run->state->transfer_queue, job, &job->fence,
+                         xfer_job_execute, NULL, 0);
+   }
+}
+
+static bool
+xfer_buffer_mappable(VkBuffer buffer)
+{
+   return !(lvp_buffer_from_handle(buffer)->bo->flags & PIPE_RESOURCE_FLAG_SPARSE);
+}
+
+static bool
+xfer_cmd_supported(const struct vk_cmd_queue_entry *cmd)
+{
+   switch (cmd->type) {
+   case VK_CMD_COPY_BUFFER2: {
+      const VkCopyBufferInfo2 *copycmd = cmd->u.copy_buffer2.copy_buffer_info;
+      return xfer_buffer_mappable(copycmd->srcBuffer) &&
+             xfer_buffer_mappable(copycmd->dstBuffer);
+   }
+   case VK_CMD_FILL_BUFFER:
+      return xfer_buffer_mappable(cmd->u.fill_buffer.dst_buffer);
+   case VK_CMD_UPDATE_BUFFER:
+      return xfer_buffer_mappable(cmd->u.update_buffer.dst_buffer);
+   default:
+      return false;
+   }
+}
+
+static void
+xfer_copy_buffer(struct lvp_xfer_run *run, struct vk_cmd_queue_entry *cmd)
+{
+   const VkCopyBufferInfo2 *copycmd = cmd->u.copy_buffer2.copy_buffer_info;
+   struct pipe_resource *src = lvp_buffer_from_handle(copycmd->srcBuffer)->bo;
+   struct pipe_resource *dst = lvp_buffer_from_handle(copycmd->dstBuffer)->bo;
+   uint8_t *src_map = xfer_map(run, src);
+   uint8_t *dst_map = xfer_map(run, dst);
+
+   for (uint32_t i = 0; i < copycmd->regionCount; i++) {
+      const VkBufferCopy2 *region = &copycmd->pRegions[i];
+      struct lvp_xfer_range ranges[2] = {
+         { src, region->srcOffset, region->srcOffset + region->size, false },
+         { dst, region->dstOffset, region->dstOffset + region->size, true },
+      };
+      xfer_reserve(run, ranges, ARRAY_SIZE(ranges));
+      xfer_submit(run, dst_map + region->dstOffset, src_map + region->srcOffset,
+                  region->size, 0);
+   }
+}
+
+static void
+xfer_fill_buffer(struct lvp_xfer_run *run, struct vk_cmd_queue_entry *cmd)
+{
+   struct vk_cmd_fill_buffer *fillcmd = &cmd->u.fill_buffer;
+   struct lvp_buffer *dst = lvp_buffer_from_handle(fillcmd->dst_buffer);
+
+   uint64_t size = vk_buffer_range(&dst->vk, fillcmd->dst_offset, fillcmd->size);
+   if (fillcmd->size == VK_WHOLE_SIZE)
+      size = ROUND_DOWN_TO(size, 4);
+
+   struct lvp_xfer_range range = {
+      dst->bo, fillcmd->dst_offset, fillcmd->dst_offset + size, true
+   };
+   xfer_reserve(run, &range, 1);
+   xfer_submit(run, xfer_map(run, dst->bo) + fillcmd->dst_offset, NULL,
+               size, fillcmd->data);
+}
+
+static void
+xfer_update_buffer(struct lvp_xfer_run *run, struct vk_cmd_queue_entry *cmd)
+{
+   struct vk_cmd_update_buffer *updcmd = &cmd->u.update_buffer;
+   struct pipe_resource *dst = lvp_buffer_from_handle(updcmd->dst_buffer)->bo;
+
+   struct lvp_xfer_range range = {
+      dst, updcmd->dst_offset, updcmd->dst_offset + updcmd->data_size, true
+   };
+   xfer_reserve(run, &range, 1);
+   xfer_submit(run, xfer_map(run, dst) + updcmd->dst_offset, updcmd->data,
+               updcmd->data_size, 0);
+}
+
+/* replays the run of transfers starting at cmd, returns the last one consumed */
+static struct vk_cmd_queue_entry *
+handle_transfer_run(struct vk_cmd_queue_entry *cmd, struct list_head *cmds,
+                    struct rendering_state *state, bool print_cmds)
+{
+   struct lvp_xfer_run run;
+   struct vk_cmd_queue_entry *last = cmd;
+
+   run.state = state;
+   run.num_jobs = 0;
+   run.num_ranges = 0;
+   run.num_maps = 0;
+
+   for (; &cmd->cmd_link != cmds && xfer_cmd_supported(cmd);
+        cmd = list_entry(cmd->cmd_link.next, struct vk_cmd_queue_entry, cmd_link)) {
+      if (print_cmds && cmd != last)
+         fprintf(stderr, "%s\n", vk_cmd_queue_type_names[cmd->type]);
+
+      /* a copy maps at most two new buffers */
+      if (run.num_maps + 2 > LVP_XFER_MAX_MAPS)
+         xfer_finish(&run);
+
+      switch (cmd->type) {
+      case VK_CMD_COPY_BUFFER2:
+         xfer_copy_buffer(&run, cmd);
+         break;
+      case VK_CMD_FILL_BUFFER:
+         xfer_fill_buffer(&run, cmd);
+         break;
+      case VK_CMD_UPDATE_BUFFER:
+         xfer_update_buffer(&run, cmd);
+         break;
+      default:
+         unreachable("not a transfer");
+      }
+      last = cmd;
+   }
+
+   xfer_finish(&run);
+   return last;
+}
+
 static void handle_draw_indexed(struct vk_cmd_queue_entry *cmd,
                                 struct rendering_state *state)
 {
@@ -2659,8 +2940,8 @@ static void handle_draw_multi_indexed(struct vk_cmd_queue_entry *cmd,
    state->info.index.resource = state->index_buffer;
    state->info.start_instance = cmd->u.draw_multi_indexed_ext.first_instance;
    state->info.instance_count = cmd->u.draw_multi_indexed_ext.instance_count;
-   if (cmd->u.draw_multi_indexed_ext.draw_count > 1)
-      state->info.increment_draw_id = true;
+   state->info.increment_draw_id = cmd->u.draw_multi_indexed_ext.draw_count > 1 &&
+                                   cmd->driver_data != LVP_DGC_MERGED_DRAW;
 
    if (state->info.primitive_restart)
       state->info.restart_index = util_prim_restart_index_from_size(state->info.index_size);
@@ -4161,30 +4442,145 @@ handle_execute_generated_commands(struct vk_cmd_queue_entry *cmd, struct renderi
    state->pctx->buffer_unmap(state->pctx, pmap);
 }
 
+/* state carried from one sequence to the next within a preprocess */
+struct dgc_replay {
+   /* input of the previous sequence, NULL before the first one */
+   const uint8_t *prev_input;
+   /* last emitted command if it is a direct draw that may still grow */
+   struct vk_cmd_queue_entry *draw;
+};
+
+/* Appends a direct draw to the draw that ended the previous sequence,
+ * turning it into a multi-draw.  Batches are marked with
+ * LVP_DGC_MERGED_DRAW so that every draw keeps DrawIndex 0, as it would
+ * when replayed on its own.
+ */
+static bool
+dgc_extend_draw(struct dgc_replay *replay, const VkIndirectCommandsLayoutTokenEXT *token,
+                const void *input, uint8_t *pbuf, size_t max_size, size_t *size)
+{
+   struct vk_cmd_queue_entry *cmd = replay->draw;
+   uint8_t *end;
+
+   if (token->type == VK_INDIRECT_COMMANDS_TOKEN_TYPE_DRAW_EXT) {
+      const VkDrawIndirectCommand *data = input;
+      if (cmd->type == VK_CMD_DRAW) {
+         struct vk_cmd_draw draw = cmd->u.draw;
+         if (draw.instance_count != data->instanceCount ||
+             draw.first_instance != data->firstInstance)
+            return false;
+         end = (uint8_t*)cmd + vk_cmd_queue_type_sizes[VK_CMD_DRAW_MULTI_EXT] +
+               2 * sizeof(VkMultiDrawInfoEXT);
+         if (end > pbuf + max_size)
+            return false;
+         cmd->type = VK_CMD_DRAW_MULTI_EXT;
+         cmd->u.draw_multi_ext.draw_count = 1;
+         cmd->u.draw_multi_ext.vertex_info =
+            (void*)((uint8_t*)cmd + vk_cmd_queue_type_sizes[VK_CMD_DRAW_MULTI_EXT]);
+         cmd->u.draw_multi_ext.vertex_info[0].firstVertex = draw.first_vertex;
+         cmd->u.draw_multi_ext.vertex_info[0].vertexCount = draw.vertex_count;
+         cmd->u.draw_multi_ext.instance_count = draw.instance_count;
+         cmd->u.draw_multi_ext.first_instance = draw.first_instance;
+         cmd->u.draw_multi_ext.stride = sizeof(VkMultiDrawInfoEXT);
+         cmd->driver_data = LVP_DGC_MERGED_DRAW;
+      } else {
+         if (cmd->u.draw_multi_ext.instance_count != data->instanceCount ||
+             cmd->u.draw_multi_ext.first_instance != data->firstInstance)
+            return false;
+         end = pbuf + sizeof(VkMultiDrawInfoEXT);
+         if (end > pbuf + max_size)
+            return false;
+      }
+      VkMultiDrawInfoEXT *info = &cmd->u.draw_multi_ext.vertex_info[cmd->u.draw_multi_ext.draw_count++];
+      info->firstVertex = data->firstVertex;
+      info->vertexCount = data->vertexCount;
+   } else {
+      const VkDrawIndexedIndirectCommand *data = input;
+      if (cmd->type == VK_CMD_DRAW_INDEXED) {
+         struct vk_cmd_draw_indexed draw = cmd->u.draw_indexed;
+         if (draw.instance_count != data->instanceCount ||
+             draw.first_instance != data->firstInstance)
+            return false;
+         end = (uint8_t*)cmd + vk_cmd_queue_type_sizes[VK_CMD_DRAW_MULTI_INDEXED_EXT] +
+               2 * sizeof(VkMultiDrawIndexedInfoEXT);
+         if (end > pbuf + max_size)
+            return false;
+         cmd->type = VK_CMD_DRAW_MULTI_INDEXED_EXT;
+         cmd->u.draw_multi_indexed_ext.draw_count = 1;
+         cmd->u.draw_multi_indexed_ext.index_info =
+            (void*)((uint8_t*)cmd + vk_cmd_queue_type_sizes[VK_CMD_DRAW_MULTI_INDEXED_EXT]);
+         cmd->u.draw_multi_indexed_ext.index_info[0].firstIndex = draw.first_index;
+         cmd->u.draw_multi_indexed_ext.index_info[0].indexCount = draw.index_count;
+         cmd->u.draw_multi_indexed_ext.index_info[0].vertexOffset = draw.vertex_offset;
+         cmd->u.draw_multi_indexed_ext.instance_count = draw.instance_count;
+         cmd->u.draw_multi_indexed_ext.first_instance = draw.first_instance;
+         cmd->u.draw_multi_indexed_ext.stride = sizeof(VkMultiDrawIndexedInfoEXT);
+         cmd->u.draw_multi_indexed_ext.vertex_offset = NULL;
+         cmd->driver_data = LVP_DGC_MERGED_DRAW;
+      } else {
+         if (cmd->u.draw_multi_indexed_ext.instance_count != data->instanceCount ||
+             cmd->u.draw_multi_indexed_ext.first_instance != data->firstInstance)
+            return false;
+         end = pbuf + sizeof(VkMultiDrawIndexedInfoEXT);
+         if (end > pbuf + max_size)
+            return false;
+      }
+      VkMultiDrawIndexedInfoEXT *info =
+         &cmd->u.draw_multi_indexed_ext.index_info[cmd->u.draw_multi_indexed_ext.draw_count++];
+      info->firstIndex = data->firstIndex;
+      info->indexCount = data->indexCount;
+      info->vertexOffset = data->vertexOffset;
+   }
+
+   *size = end - pbuf;
+   return true;
+}
+
 static size_t
 process_sequence_ext(struct rendering_state *state,
                      struct lvp_indirect_execution_set *iset, struct lvp_indirect_command_layout_ext *elayout,
                      struct list_head *list, uint8_t *pbuf, size_t max_size,
                      uint8_t *stream, uint32_t seq, uint32_t maxDrawCount,
-                     bool print_cmds)
+                     struct dgc_replay *replay, bool print_cmds)
 {
+   const uint8_t *seq_input = stream + elayout->vk.stride * seq;
    size_t size = 0;
+   bool emitted = false;
+
    assert(elayout->vk.token_count);
    for (uint32_t t = 0; t < elayout->vk.token_count; t++){
       const VkIndirectCommandsLayoutTokenEXT *token = &elayout->tokens[t];
-      uint32_t offset = elayout->vk.stride * seq + token->offset;
-      void *input = stream + offset;
+      const struct lvp_indirect_token_plan *plan = &elayout->plan[t];
+      void *input = (uint8_t*)seq_input + token->offset;
+
+      if (print_cmds)
+         fprintf(stderr, "DGC %s\n", vk_IndirectCommandsTokenTypeEXT_to_str(token->type));
+
+      /* the state this token would set is already bound */
+      if (plan->state_size && replay->prev_input &&
+          !memcmp(input, replay->prev_input + token->offset, plan->state_size))
+         continue;
+
+      if (!emitted && replay->draw &&
+          (token->type == VK_INDIRECT_COMMANDS_TOKEN_TYPE_DRAW_EXT ||
+           token->type == VK_INDIRECT_COMMANDS_TOKEN_TYPE_DRAW_INDEXED_EXT) &&
+          dgc_extend_draw(replay, token, input, pbuf, max_size, &size))
+         continue;
+
+      /* the array of a multi-draw may have left the tail unaligned */
+      if (replay->draw && replay->draw->type == VK_CMD_DRAW_MULTI_INDEXED_EXT)
+         size = (uint8_t*)align_uintptr((uintptr_t)pbuf, 8) - pbuf;
+      replay->draw = NULL;
+      emitted = true;
 
       struct vk_cmd_queue_entry *cmd = (struct vk_cmd_queue_entry*)(pbuf + size);
-      cmd->type = lvp_ext_dgc_token_to_cmd_type(elayout, token);
+      cmd->type = plan->cmd_type;
       size_t cmd_size = vk_cmd_queue_type_sizes[cmd->type];
       uint8_t *cmdptr = (void*)(pbuf + size + cmd_size);
 
-      if (max_size < size + lvp_ext_dgc_token_size(elayout, token))
+      if (max_size < size + plan->cmd_size)
          abort();
 
-      if (print_cmds)
-         fprintf(stderr, "DGC %s\n", vk_IndirectCommandsTokenTypeEXT_to_str(token->type));
       switch (token->type) {
       case VK_INDIRECT_COMMANDS_TOKEN_TYPE_EXECUTION_SET_EXT: {
          uint32_t *data = input;
@@ -4367,9 +4763,12 @@ process_sequence_ext(struct rendering_state *state,
          unreachable("unknown token type");
          break;
       }
-      size += lvp_ext_dgc_token_size(elayout, token);
+      size += plan->cmd_size;
       list_addtail(&cmd->cmd_link, list);
+      if (cmd->type == VK_CMD_DRAW || cmd->type == VK_CMD_DRAW_INDEXED)
+         replay->draw = cmd;
    }
+   replay->prev_input = seq_input;
    return size;
 }
 
@@ -4395,8 +4794,11 @@ handle_preprocess_generated_commands_ext(struct vk_cmd_queue_entry *cmd, struct
 
    size_t offset = size;
    uint8_t *p = (void*)(uintptr_t)pre->preprocessAddress;
+   struct dgc_replay replay = {0};
    for (unsigned i = 0; i < seq_count; i++) {
-      offset += process_sequence_ext(state, iset, elayout, list, p + offset, max_size, (void*)(uintptr_t)pre->indirectAddress, i, pre->maxDrawCount, print_cmds);
+      offset += process_sequence_ext(state, iset, elayout, list, p + offset, max_size - offset,
+                                     (void*)(uintptr_t)pre->indirectAddress, i, pre->maxDrawCount,
+                                     &replay, print_cmds);
       assert(offset);
    }
 
@@ -4756,7 +5158,7 @@ handle_build_acceleration_structures(struct vk_cmd_queue_entry *cmd, struct rend
    struct vk_cmd_build_acceleration_structures_khr *build = &cmd->u.build_acceleration_structures_khr;
 
    for (uint32_t i = 0; i < build->info_count; i++)
-      lvp_build_acceleration_structure(&build->infos[i], build->pp_build_range_infos[i]);
+      lvp_build_acceleration_structure(state->device, &build->infos[i], build->pp_build_range_infos[i]);
 }
 
 static void
@@ -5092,6 +5494,11 @@ static void lvp_execute_cmd_buffer(struct list_head *cmds,
    LIST_FOR_EACH_ENTRY(cmd, cmds, cmd_link) {
       if (print_cmds)
          fprintf(stderr, "%s\n", vk_cmd_queue_type_names[cmd->type]);
+      if (state->transfer_queue && xfer_cmd_supported(cmd)) {
+         cmd = handle_transfer_run(cmd, cmds, state, print_cmds);
+         did_flush = false;
+         continue;
+      }
       switch ((unsigned)cmd->type) {
       case VK_CMD_BIND_PIPELINE:
          handle_pipeline(cmd, state);
@@ -5511,6 +5918,7 @@ VkResult lvp_execute_cmds(struct lvp_device *device,
    state->min_samples_dirty = true;
    state->sample_mask = UINT32_MAX;
    state->poison_mem = device->poison_mem;
+   state->transfer_queue = queue->threaded_transfers ? &queue->transfer_queue : NULL;
    util_dynarray_init(&state->push_desc_sets, NULL);
    util_dynarray_init(&state->internal_buffers, NULL);
 
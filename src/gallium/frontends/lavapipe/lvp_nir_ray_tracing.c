@@ -57,86 +57,95 @@ lvp_load_vertex_position(nir_builder *b, nir_def *instance_addr, nir_def *primit
    return nir_build_load_global(b, 3, 32, nir_iadd(b, bvh_addr, nir_u2u64(b, offset)));
 }
 
+static void
+lvp_sort_children(nir_builder *b, nir_def **distances, nir_def **indices, unsigned i, unsigned j)
+{
+   nir_def *swap = nir_flt(b, distances[j], distances[i]);
+
+   nir_def *distance_i = nir_bcsel(b, swap, distances[j], distances[i]);
+   nir_def *index_i = nir_bcsel(b, swap, indices[j], indices[i]);
+   distances[j] = nir_bcsel(b, swap, distances[i], distances[j]);
+   indices[j] = nir_bcsel(b, swap, indices[i], indices[j]);
+   distances[i] = distance_i;
+   indices[i] = index_i;
+}
+
+/**
+ * Intersect the ray with all children of a box node at once.
+ *
+ * \return the hit children ordered by distance, followed by
+ *         LVP_BVH_INVALID_NODE
+ */
 static nir_def *
 lvp_build_intersect_ray_box(nir_builder *b, nir_def *node_addr, nir_def *ray_tmax,
                             nir_def *origin, nir_def *dir, nir_def *inv_dir)
 {
-   const struct glsl_type *vec2_type = glsl_vector_type(GLSL_TYPE_FLOAT, 2);
-   const struct glsl_type *uvec2_type = glsl_vector_type(GLSL_TYPE_UINT, 2);
-
-   nir_variable *distances =
-      nir_variable_create(b->shader, nir_var_shader_temp, vec2_type, "distances");
-   nir_store_var(b, distances, nir_imm_vec2(b, INFINITY, INFINITY), 0xf);
-
-   nir_variable *child_indices =
-      nir_variable_create(b->shader, nir_var_shader_temp, uvec2_type, "child_indices");
-   nir_store_var(b, child_indices, nir_imm_ivec2(b, 0xffffffffu, 0xffffffffu), 0xf);
+   const unsigned width = LVP_BVH_NODE_WIDTH;
 
    inv_dir = nir_bcsel(b, nir_feq_imm(b, dir, 0), nir_imm_float(b, FLT_MAX), inv_dir);
 
-   for (int i = 0; i < 2; i++) {
-      const uint32_t child_offset = offsetof(struct lvp_bvh_box_node, children[i]);
-      const uint32_t coord_offsets[2] = {
-         offsetof(struct lvp_bvh_box_node, bounds[i].min.x),
-         offsetof(struct lvp_bvh_box_node, bounds[i].max.x),
+   nir_def *node_origin = nir_build_load_global(
+      b, 3, 32, nir_iadd_imm(b, node_addr, offsetof(struct lvp_bvh_box_node, origin)));
+   nir_def *exponents = nir_build_load_global(
+      b, 1, 32, nir_iadd_imm(b, node_addr, offsetof(struct lvp_bvh_box_node, exponent)));
+   nir_def *children = nir_build_load_global(
+      b, width, 32, nir_iadd_imm(b, node_addr, offsetof(struct lvp_bvh_box_node, children)));
+
+   nir_def *tmin = NULL, *tmax = NULL;
+   for (unsigned axis = 0; axis < 3; axis++) {
+      nir_def *quantized[2] = {
+         nir_build_load_global(
+            b, 1, 32, nir_iadd_imm(b, node_addr, offsetof(struct lvp_bvh_box_node, min[axis]))),
+         nir_build_load_global(
+            b, 1, 32, nir_iadd_imm(b, node_addr, offsetof(struct lvp_bvh_box_node, max[axis]))),
       };
 
-      nir_def *child_index =
-         nir_build_load_global(b, 1, 32, nir_iadd_imm(b, node_addr, child_offset));
+      /* 2^exponent, built from the float bits */
+      nir_def *exponent = nir_extract_i8_imm(b, exponents, axis);
+      nir_def *scale = nir_ishl_imm(b, nir_iadd_imm(b, exponent, 127), 23);
+      scale = nir_replicate(b, scale, width);
 
-      nir_def *node_coords[2] = {
-         nir_build_load_global(b, 3, 32, nir_iadd_imm(b, node_addr, coord_offsets[0])),
-         nir_build_load_global(b, 3, 32, nir_iadd_imm(b, node_addr, coord_offsets[1])),
-      };
+      nir_def *axis_origin = nir_replicate(b, nir_channel(b, node_origin, axis), width);
+      nir_def *ray_origin = nir_replicate(b, nir_channel(b, origin, axis), width);
+      nir_def *ray_inv_dir = nir_replicate(b, nir_channel(b, inv_dir, axis), width);
 
-      /* If x of the aabb min is NaN, then this is an inactive aabb.
-       * We don't need to care about any other components being NaN as that is UB.
-       * https://www.khronos.org/registry/vulkan/specs/1.2-extensions/html/chap36.html#VkAabbPositionsKHR
-       */
-      nir_def *min_x = nir_channel(b, node_coords[0], 0);
-      nir_def *min_x_is_not_nan =
-         nir_inot(b, nir_fneu(b, min_x, min_x)); /* NaN != NaN -> true */
-
-      nir_def *bound0 = nir_fmul(b, nir_fsub(b, node_coords[0], origin), inv_dir);
-      nir_def *bound1 = nir_fmul(b, nir_fsub(b, node_coords[1], origin), inv_dir);
-
-      nir_def *tmin =
-         nir_fmax(b,
-                  nir_fmax(b, nir_fmin(b, nir_channel(b, bound0, 0), nir_channel(b, bound1, 0)),
-                           nir_fmin(b, nir_channel(b, bound0, 1), nir_channel(b, bound1, 1))),
-                  nir_fmin(b, nir_channel(b, bound0, 2), nir_channel(b, bound1, 2)));
-
-      nir_def *tmax =
-         nir_fmin(b,
-                  nir_fmin(b, nir_fmax(b, nir_channel(b, bound0, 0), nir_channel(b, bound1, 0)),
-                           nir_fmax(b, nir_channel(b, bound0, 1), nir_channel(b, bound1, 1))),
-                  nir_fmax(b, nir_channel(b, bound0, 2), nir_channel(b, bound1, 2)));
-
-      nir_push_if(b,
-                  nir_iand(b, min_x_is_not_nan,
-                           nir_iand(b, nir_fge(b, tmax, nir_fmax(b, nir_imm_float(b, 0.0f), tmin)),
-                                    nir_flt(b, tmin, ray_tmax))));
-      {
-         nir_def *new_child_indices[2] = {child_index, child_index};
-         nir_store_var(b, child_indices, nir_vec(b, new_child_indices, 2), 1u << i);
+      nir_def *bounds[2];
+      for (unsigned i = 0; i < 2; i++) {
+         nir_def *q[LVP_BVH_NODE_WIDTH];
+         for (unsigned c = 0; c < width; c++)
+            q[c] = nir_extract_u8_imm(b, quantized[i], c);
 
-         nir_def *new_distances[2] = {tmin, tmin};
-         nir_store_var(b, distances, nir_vec(b, new_distances, 2), 1u << i);
+         nir_def *coord = nir_ffma(b, nir_u2f32(b, nir_vec(b, q, width)), scale, axis_origin);
+         bounds[i] = nir_fmul(b, nir_fsub(b, coord, ray_origin), ray_inv_dir);
       }
-      nir_pop_if(b, NULL);
+
+      nir_def *near = nir_fmin(b, bounds[0], bounds[1]);
+      nir_def *far = nir_fmax(b, bounds[0], bounds[1]);
+      tmin = tmin ? nir_fmax(b, tmin, near) : near;
+      tmax = tmax ? nir_fmin(b, tmax, far) : far;
    }
 
-   nir_def *ssa_distances = nir_load_var(b, distances);
-   nir_def *ssa_indices = nir_load_var(b, child_indices);
-   nir_push_if(b, nir_flt(b, nir_channel(b, ssa_distances, 1), nir_channel(b, ssa_distances, 0)));
-   {
-      nir_store_var(b, child_indices,
-                    nir_vec2(b, nir_channel(b, ssa_indices, 1), nir_channel(b, ssa_indices, 0)),
-                    0b11);
+   nir_def *hit = nir_iand(b, nir_fge(b, tmax, nir_fmax(b, nir_imm_zero(b, width, 32), tmin)),
+                           nir_flt(b, tmin, nir_replicate(b, ray_tmax, width)));
+   hit = nir_iand(b, hit, nir_ine_imm(b, children, LVP_BVH_INVALID_NODE));
+
+   nir_def *distances[LVP_BVH_NODE_WIDTH], *indices[LVP_BVH_NODE_WIDTH];
+   for (unsigned c = 0; c < width; c++) {
+      nir_def *child_hit = nir_channel(b, hit, c);
+      distances[c] = nir_bcsel(b, child_hit, nir_channel(b, tmin, c), nir_imm_float(b, INFINITY));
+      indices[c] = nir_bcsel(b, child_hit, nir_channel(b, children, c),
+                             nir_imm_int(b, LVP_BVH_INVALID_NODE));
    }
-   nir_pop_if(b, NULL);
 
-   return nir_load_var(b, child_indices);
+   /* Sorting network for 4 elements */
+   STATIC_ASSERT(LVP_BVH_NODE_WIDTH == 4);
+   lvp_sort_children(b, distances, indices, 0, 1);
+   lvp_sort_children(b, distances, indices, 2, 3);
+   lvp_sort_children(b, distances, indices, 0, 2);
+   lvp_sort_children(b, distances, indices, 1, 3);
+   lvp_sort_children(b, distances, indices, 1, 2);
+
+   return nir_vec(b, indices, width);
 }
 
 static nir_def *
@@ -497,11 +506,14 @@ lvp_build_ray_traversal(nir_builder *b, const struct lvp_ray_traversal_args *arg
 
             nir_store_deref(b, args->vars.current_node, nir_channel(b, result, 0), 0x1);
 
-            nir_push_if(b, nir_ine_imm(b, nir_channel(b, result, 1), LVP_BVH_INVALID_NODE));
-            {
-               lvp_build_push_stack(b, args, nir_channel(b, result, 1));
+            /* Push the farthest child first so that the nearest one is popped first. */
+            for (unsigned i = LVP_BVH_NODE_WIDTH - 1; i > 0; i--) {
+               nir_push_if(b, nir_ine_imm(b, nir_channel(b, result, i), LVP_BVH_INVALID_NODE));
+               {
+                  lvp_build_push_stack(b, args, nir_channel(b, result, i));
+               }
+               nir_pop_if(b, NULL);
             }
-            nir_pop_if(b, NULL);
          }
          nir_pop_if(b, NULL);
       }
@@ -42,6 +42,38 @@
 
 typedef void (*cso_destroy_func)(struct pipe_context*, void*);
 
+static uint32_t
+link_cache_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct lvp_link_cache_key));
+}
+
+static bool
+link_cache_equal(const void *a, const void *b)
+{
+   return !memcmp(a, b, sizeof(struct lvp_link_cache_key));
+}
+
+void
+lvp_link_cache_init(struct lvp_device *device)
+{
+   _mesa_hash_table_init(&device->link_cache, NULL, link_cache_hash, link_cache_equal);
+}
+
+/* queue.lock must be held */
+static void
+link_cache_unref(struct lvp_device *device, struct lvp_linked_cso *linked,
+                 cso_destroy_func destroy)
+{
+   if (--linked->ref_cnt)
+      return;
+
+   _mesa_hash_table_remove_key(&device->link_cache, &linked->key);
+   destroy(device->queue.ctx, linked->cso);
+   lvp_pipeline_nir_ref(&linked->key.pipeline_nir, NULL);
+   free(linked);
+}
+
 static void
 shader_destroy(struct lvp_device *device, struct lvp_shader *shader, bool locked)
 {
@@ -69,9 +101,13 @@ shader_destroy(struct lvp_device *device, struct lvp_shader *shader, bool locked
    }
    ralloc_free(shader->inlines.variants.table);
 
-   if (shader->shader_cso)
+   if (shader->linked_cso)
+      link_cache_unref(device, shader->linked_cso, destroy[stage]);
+   else if (shader->shader_cso)
       destroy[stage](device->queue.ctx, shader->shader_cso);
-   if (shader->tess_ccw_cso)
+   if (shader->linked_tess_ccw_cso)
+      link_cache_unref(device, shader->linked_tess_ccw_cso, destroy[stage]);
+   else if (shader->tess_ccw_cso)
       destroy[stage](device->queue.ctx, shader->tess_ccw_cso);
 
    if (!locked)
@@ -758,6 +794,7 @@ copy_shader_sanitized(struct lvp_shader *dst, const struct lvp_shader *src)
    *dst = *src;
    dst->pipeline_nir = NULL; //this gets handled later
    dst->tess_ccw = NULL; //this gets handled later
+   dst->from_library = true;
    assert(!dst->shader_cso);
    assert(!dst->tess_ccw_cso);
    if (src->inlines.can_inline)
@@ -929,24 +966,82 @@ fail:
    return result;
 }
 
+/* Compile a stage of a pipeline linked from libraries, or reuse the CSO
+ * that another pipeline linked from the same library stage already built.
+ * Nothing else that goes into the CSO can differ between such pipelines:
+ * dynamic state is handled at draw time and the tessellation domain origin
+ * has its own tess_ccw NIR.
+ */
+static void *
+link_cache_compile(struct lvp_device *device, struct lvp_shader *shader,
+                   struct lvp_pipeline_nir *pipeline_nir,
+                   struct lvp_linked_cso **out, bool locked)
+{
+   struct lvp_link_cache_key key;
+   memset(&key, 0, sizeof(key));
+   key.pipeline_nir = pipeline_nir;
+   memcpy(&key.stream_output, &shader->stream_output, sizeof(key.stream_output));
+
+   if (!locked)
+      simple_mtx_lock(&device->queue.lock);
+
+   struct lvp_linked_cso *linked;
+   struct hash_entry *entry = _mesa_hash_table_search(&device->link_cache, &key);
+   if (entry) {
+      linked = entry->data;
+      linked->ref_cnt++;
+   } else {
+      linked = calloc(1, sizeof(*linked));
+      if (!linked) {
+         void *cso = lvp_shader_compile(device, shader, nir_shader_clone(NULL, pipeline_nir->nir), true);
+         if (!locked)
+            simple_mtx_unlock(&device->queue.lock);
+         *out = NULL;
+         return cso;
+      }
+      linked->key = key;
+      linked->key.pipeline_nir = NULL;
+      lvp_pipeline_nir_ref(&linked->key.pipeline_nir, pipeline_nir);
+      linked->cso = lvp_shader_compile(device, shader, nir_shader_clone(NULL, pipeline_nir->nir), true);
+      linked->ref_cnt = 1;
+      _mesa_hash_table_insert(&device->link_cache, &linked->key, linked);
+   }
+
+   if (!locked)
+      simple_mtx_unlock(&device->queue.lock);
+
+   *out = linked;
+   return linked->cso;
+}
+
 void
 lvp_pipeline_shaders_compile(struct lvp_pipeline *pipeline, bool locked)
 {
    if (pipeline->compiled)
       return;
    for (uint32_t i = 0; i < ARRAY_SIZE(pipeline->shaders); i++) {
-      if (!pipeline->shaders[i].pipeline_nir)
+      struct lvp_shader *shader = &pipeline->shaders[i];
+      if (!shader->pipeline_nir)
          continue;
 
       gl_shader_stage stage = i;
-      assert(stage == pipeline->shaders[i].pipeline_nir->nir->info.stage);
-
-      if (!pipeline->shaders[stage].inlines.can_inline) {
-         pipeline->shaders[stage].shader_cso = lvp_shader_compile(pipeline->device, &pipeline->shaders[stage],
-            nir_shader_clone(NULL, pipeline->shaders[stage].pipeline_nir->nir), locked);
-         if (pipeline->shaders[MESA_SHADER_TESS_EVAL].tess_ccw)
-            pipeline->shaders[MESA_SHADER_TESS_EVAL].tess_ccw_cso = lvp_shader_compile(pipeline->device, &pipeline->shaders[stage],
-               nir_shader_clone(NULL, pipeline->shaders[MESA_SHADER_TESS_EVAL].tess_ccw->nir), locked);
+      assert(stage == shader->pipeline_nir->nir->info.stage);
+
+      if (shader->inlines.can_inline)
+         continue;
+
+      if (shader->from_library) {
+         shader->shader_cso = link_cache_compile(pipeline->device, shader, shader->pipeline_nir,
+                                                 &shader->linked_cso, locked);
+         if (shader->tess_ccw)
+            shader->tess_ccw_cso = link_cache_compile(pipeline->device, shader, shader->tess_ccw,
+                                                      &shader->linked_tess_ccw_cso, locked);
+      } else {
+         shader->shader_cso = lvp_shader_compile(pipeline->device, shader,
+            nir_shader_clone(NULL, shader->pipeline_nir->nir), locked);
+         if (shader->tess_ccw)
+            shader->tess_ccw_cso = lvp_shader_compile(pipeline->device, shader,
+               nir_shader_clone(NULL, shader->tess_ccw->nir), locked);
       }
    }
    pipeline->compiled = true;
@@ -195,6 +195,10 @@ struct lvp_queue {
    void *state;
    struct util_dynarray pipeline_destroys;
    simple_mtx_t lock;
+
+   /* LVP_THREADED_TRANSFERS: workers for barrier-free runs of buffer copies */
+   struct util_queue transfer_queue;
+   bool threaded_transfers;
 };
 
 struct lvp_pipeline_cache {
@@ -222,6 +226,9 @@ struct lvp_device {
    struct util_dynarray bda_texture_handles;
    struct util_dynarray bda_image_handles;
 
+   /* lvp_linked_cso entries, protected by queue.lock */
+   struct hash_table link_cache;
+
    uint32_t group_handle_alloc;
 };
 
@@ -437,6 +444,21 @@ lvp_pipeline_nir_ref(struct lvp_pipeline_nir **dst, struct lvp_pipeline_nir *src
    *dst = src;
 }
 
+/* A shader CSO compiled for pipelines linked from graphics pipeline
+ * libraries. Linking only references the library NIR, so every pipeline
+ * linked from the same library stage can share one compiled CSO.
+ */
+struct lvp_link_cache_key {
+   struct lvp_pipeline_nir *pipeline_nir;
+   struct pipe_stream_output_info stream_output;
+};
+
+struct lvp_linked_cso {
+   struct lvp_link_cache_key key; /* holds a pipeline_nir reference */
+   void *cso;
+   unsigned ref_cnt;
+};
+
 struct lvp_inline_variant {
    uint32_t mask;
    uint32_t vals[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS];
@@ -450,6 +472,10 @@ struct lvp_shader {
    struct lvp_pipeline_nir *tess_ccw;
    void *shader_cso;
    void *tess_ccw_cso;
+   /* if set, shader_cso/tess_ccw_cso are owned by the device link cache */
+   struct lvp_linked_cso *linked_cso;
+   struct lvp_linked_cso *linked_tess_ccw_cso;
+   bool from_library;
    struct {
       uint32_t uniform_offsets[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS];
       uint8_t count[PIPE_MAX_CONSTANT_BUFFERS];
@@ -580,6 +606,9 @@ lvp_lower_exec_graph(struct lvp_pipeline *pipeline, nir_shader *nir);
 void
 lvp_pipeline_shaders_compile(struct lvp_pipeline *pipeline, bool locked);
 
+void
+lvp_link_cache_init(struct lvp_device *device);
+
 struct lvp_event {
    struct vk_object_base base;
    volatile uint64_t event_storage;
@@ -656,9 +685,20 @@ enum lvp_indirect_layout_type {
    LVP_INDIRECT_COMMAND_LAYOUT_RAYS,
 };
 
+/* per-token replay info, decoded once when the layout is created */
+struct lvp_indirect_token_plan {
+   enum vk_cmd_type cmd_type;
+   uint32_t cmd_size;
+   /* input bytes of a state token, which is skipped when they match the
+    * previous sequence; 0 for tokens that must always be emitted
+    */
+   uint32_t state_size;
+};
+
 struct lvp_indirect_command_layout_ext {
    struct vk_indirect_command_layout vk;
    enum lvp_indirect_layout_type type;
+   struct lvp_indirect_token_plan *plan;
    VkIndirectCommandsLayoutTokenEXT tokens[0];
 };
 
@@ -0,0 +1,534 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Checks the BVHs built by lvp_build_bvh() and reports the build time and
+ * the average number of nodes a closest hit ray visits for every build
+ * preference.
+ *
+ * The scene is a ground plane with spheres of random size scattered over
+ * it, with the triangles in random order.  It is also built with some of the
+ * triangles made inactive.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lvp_bvh.h"
+#include "lp_cs_tpool.h"
+
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+
+#define NUM_SPHERES     256
+#define SPHERE_SEGMENTS 24
+#define GROUND_SEGMENTS 128
+#define NUM_RAYS        (64 * 1024)
+#define NUM_CHECK_RAYS  256
+#define NUM_BUILDS      2
+
+struct ray {
+   float origin[3];
+   float dir[3];
+   float inv_dir[3];
+};
+
+struct bvh {
+   uint8_t *data;
+   const lvp_aabb *leaf_bounds;
+   uint32_t leaf_count;
+   uint32_t leaf_nodes_offset;
+};
+
+static uint32_t rand_state = 0x12345678;
+
+static float
+rand_float(void)
+{
+   /* xorshift32 */
+   rand_state ^= rand_state << 13;
+   rand_state ^= rand_state >> 17;
+   rand_state ^= rand_state << 5;
+   return (rand_state >> 8) * (1.0f / (1 << 24));
+}
+
+static void
+sphere_point(const float center[3], float radius, unsigned u, unsigned v, float out[3])
+{
+   float theta = 2.0f * M_PI * u / SPHERE_SEGMENTS;
+   float phi = M_PI * v / SPHERE_SEGMENTS;
+
+   out[0] = center[0] + radius * sinf(phi) * cosf(theta);
+   out[1] = center[1] + radius * cosf(phi);
+   out[2] = center[2] + radius * sinf(phi) * sinf(theta);
+}
+
+static uint32_t
+create_scene(struct lvp_bvh_triangle_node **triangles)
+{
+   uint32_t count = NUM_SPHERES * SPHERE_SEGMENTS * SPHERE_SEGMENTS * 2 +
+                    GROUND_SEGMENTS * GROUND_SEGMENTS * 2;
+   struct lvp_bvh_triangle_node *tris = calloc(count, sizeof(*tris));
+   uint32_t n = 0;
+
+   for (unsigned s = 0; s < NUM_SPHERES; s++) {
+      float radius = 0.2f + 2.0f * rand_float() * rand_float();
+      float center[3] = {rand_float() * 100.0f, radius, rand_float() * 100.0f};
+
+      for (unsigned u = 0; u < SPHERE_SEGMENTS; u++) {
+         for (unsigned v = 0; v < SPHERE_SEGMENTS; v++) {
+            float p[4][3];
+            sphere_point(center, radius, u, v, p[0]);
+            sphere_point(center, radius, u + 1, v, p[1]);
+            sphere_point(center, radius, u, v + 1, p[2]);
+            sphere_point(center, radius, u + 1, v + 1, p[3]);
+
+            memcpy(tris[n].coords[0], p[0], sizeof(p[0]));
+            memcpy(tris[n].coords[1], p[1], sizeof(p[1]));
+            memcpy(tris[n].coords[2], p[2], sizeof(p[2]));
+            n++;
+            memcpy(tris[n].coords[0], p[1], sizeof(p[1]));
+            memcpy(tris[n].coords[1], p[3], sizeof(p[3]));
+            memcpy(tris[n].coords[2], p[2], sizeof(p[2]));
+            n++;
+         }
+      }
+   }
+
+   const float step = 100.0f / GROUND_SEGMENTS;
+   for (unsigned x = 0; x < GROUND_SEGMENTS; x++) {
+      for (unsigned z = 0; z < GROUND_SEGMENTS; z++) {
+         float x0 = x * step, x1 = (x + 1) * step;
+         float z0 = z * step, z1 = (z + 1) * step;
+         float quad[2][3][3] = {
+            {{x0, 0, z0}, {x1, 0, z0}, {x0, 0, z1}},
+            {{x1, 0, z0}, {x1, 0, z1}, {x0, 0, z1}},
+         };
+
+         memcpy(tris[n++].coords, quad[0], sizeof(quad[0]));
+         memcpy(tris[n++].coords, quad[1], sizeof(quad[1]));
+      }
+   }
+
+   assert(n == count);
+
+   for (uint32_t i = count - 1; i > 0; i--) {
+      uint32_t j = MIN2((uint32_t)(rand_float() * (i + 1)), i);
+      struct lvp_bvh_triangle_node tmp = tris[i];
+      tris[i] = tris[j];
+      tris[j] = tmp;
+   }
+
+   for (uint32_t i = 0; i < count; i++)
+      tris[i].primitive_id = i;
+
+   *triangles = tris;
+   return count;
+}
+
+static void
+triangle_bounds(const struct lvp_bvh_triangle_node *tri, lvp_aabb *aabb)
+{
+   aabb->min.x = MIN3(tri->coords[0][0], tri->coords[1][0], tri->coords[2][0]);
+   aabb->min.y = MIN3(tri->coords[0][1], tri->coords[1][1], tri->coords[2][1]);
+   aabb->min.z = MIN3(tri->coords[0][2], tri->coords[1][2], tri->coords[2][2]);
+   aabb->max.x = MAX3(tri->coords[0][0], tri->coords[1][0], tri->coords[2][0]);
+   aabb->max.y = MAX3(tri->coords[0][1], tri->coords[1][1], tri->coords[2][1]);
+   aabb->max.z = MAX3(tri->coords[0][2], tri->coords[1][2], tri->coords[2][2]);
+}
+
+static bool
+aabb_contains(const lvp_aabb *outer, const lvp_aabb *inner)
+{
+   return outer->min.x <= inner->min.x && outer->min.y <= inner->min.y &&
+          outer->min.z <= inner->min.z && outer->max.x >= inner->max.x &&
+          outer->max.y >= inner->max.y && outer->max.z >= inner->max.z;
+}
+
+static void
+create_rays(struct ray *rays, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++) {
+      struct ray *ray = &rays[i];
+      float len;
+
+      ray->origin[0] = rand_float() * 100.0f;
+      ray->origin[1] = 0.5f + rand_float() * 4.0f;
+      ray->origin[2] = rand_float() * 100.0f;
+
+      do {
+         for (unsigned c = 0; c < 3; c++)
+            ray->dir[c] = rand_float() * 2.0f - 1.0f;
+         len = sqrtf(ray->dir[0] * ray->dir[0] + ray->dir[1] * ray->dir[1] +
+                     ray->dir[2] * ray->dir[2]);
+      } while (len < 0.01f || len > 1.0f);
+
+      for (unsigned c = 0; c < 3; c++) {
+         ray->dir[c] /= len;
+         ray->inv_dir[c] = 1.0f / ray->dir[c];
+      }
+   }
+}
+
+static float
+intersect_box(const struct ray *ray, const lvp_aabb *aabb, float t_max)
+{
+   const float *min = &aabb->min.x, *max = &aabb->max.x;
+   float t0 = 0.0f, t1 = t_max;
+
+   for (unsigned c = 0; c < 3; c++) {
+      float a = (min[c] - ray->origin[c]) * ray->inv_dir[c];
+      float b = (max[c] - ray->origin[c]) * ray->inv_dir[c];
+      t0 = MAX2(t0, MIN2(a, b));
+      t1 = MIN2(t1, MAX2(a, b));
+   }
+
+   return t0 <= t1 ? t0 : INFINITY;
+}
+
+static float
+intersect_triangle(const struct ray *ray, const struct lvp_bvh_triangle_node *tri)
+{
+   float e1[3], e2[3], s[3], p[3], q[3];
+
+   for (unsigned c = 0; c < 3; c++) {
+      e1[c] = tri->coords[1][c] - tri->coords[0][c];
+      e2[c] = tri->coords[2][c] - tri->coords[0][c];
+      s[c] = ray->origin[c] - tri->coords[0][c];
+   }
+
+   p[0] = ray->dir[1] * e2[2] - ray->dir[2] * e2[1];
+   p[1] = ray->dir[2] * e2[0] - ray->dir[0] * e2[2];
+   p[2] = ray->dir[0] * e2[1] - ray->dir[1] * e2[0];
+
+   float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+   if (fabsf(det) < 1e-12f)
+      return INFINITY;
+
+   float inv_det = 1.0f / det;
+   float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+   if (u < 0.0f || u > 1.0f)
+      return INFINITY;
+
+   q[0] = s[1] * e1[2] - s[2] * e1[1];
+   q[1] = s[2] * e1[0] - s[0] * e1[2];
+   q[2] = s[0] * e1[1] - s[1] * e1[0];
+
+   float v = (ray->dir[0] * q[0] + ray->dir[1] * q[1] + ray->dir[2] * q[2]) * inv_det;
+   if (v < 0.0f || u + v > 1.0f)
+      return INFINITY;
+
+   float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+   return t >= 0.0f ? t : INFINITY;
+}
+
+/**
+ * Closest hit traversal visiting the nearest child first, like the ray
+ * traversal shader code.
+ */
+static float
+trace(const struct bvh *bvh, const struct ray *ray, unsigned *visited)
+{
+   uint32_t stack[LVP_BVH_STACK_SIZE];
+   unsigned stack_size = 0;
+   uint32_t node = LVP_BVH_ROOT_NODE;
+   float t_max = INFINITY;
+
+   while (true) {
+      if (node == LVP_BVH_INVALID_NODE) {
+         if (!stack_size)
+            break;
+         node = stack[--stack_size];
+      }
+
+      (*visited)++;
+
+      const void *ptr = bvh->data + (node & ~3u);
+      if ((node & 3u) == lvp_bvh_node_triangle) {
+         t_max = MIN2(t_max, intersect_triangle(ray, ptr));
+         node = LVP_BVH_INVALID_NODE;
+         continue;
+      }
+
+      const struct lvp_bvh_box_node *box = ptr;
+      uint32_t children[LVP_BVH_NODE_WIDTH];
+      float dist[LVP_BVH_NODE_WIDTH];
+      unsigned num_hits = 0;
+
+      for (unsigned i = 0; i < LVP_BVH_NODE_WIDTH; i++) {
+         if (box->children[i] == LVP_BVH_INVALID_NODE)
+            continue;
+
+         lvp_aabb bounds;
+         lvp_bvh_box_node_child_bounds(box, i, &bounds);
+
+         float t = intersect_box(ray, &bounds, t_max);
+         if (t == INFINITY)
+            continue;
+
+         /* Insertion sort by distance */
+         unsigned j = num_hits++;
+         for (; j > 0 && dist[j - 1] > t; j--) {
+            dist[j] = dist[j - 1];
+            children[j] = children[j - 1];
+         }
+         dist[j] = t;
+         children[j] = box->children[i];
+      }
+
+      for (unsigned i = num_hits; i > 1; i--) {
+         assert(stack_size < ARRAY_SIZE(stack));
+         stack[stack_size++] = children[i - 1];
+      }
+
+      node = num_hits ? children[0] : LVP_BVH_INVALID_NODE;
+   }
+
+   return t_max;
+}
+
+/**
+ * \param bounds  intersection of the bounds of all parent nodes
+ */
+static bool
+validate_node(const struct bvh *bvh, uint32_t node, const lvp_aabb *bounds, unsigned depth,
+              uint8_t *leaf_seen, uint32_t *num_internal)
+{
+   const void *ptr = bvh->data + (node & ~3u);
+
+   if ((node & 3u) == lvp_bvh_node_triangle) {
+      uint32_t leaf = ((node & ~3u) - bvh->leaf_nodes_offset) /
+                      sizeof(struct lvp_bvh_triangle_node);
+      lvp_aabb leaf_bounds;
+
+      triangle_bounds(ptr, &leaf_bounds);
+      if (leaf >= bvh->leaf_count || leaf_seen[leaf]++ || !aabb_contains(bounds, &leaf_bounds)) {
+         fprintf(stderr, "bad leaf reference 0x%x\n", node);
+         return false;
+      }
+
+      return true;
+   }
+
+   if (depth >= (LVP_BVH_MAX_DEPTH + 1) / 2) {
+      fprintf(stderr, "BVH deeper than %u levels\n", (LVP_BVH_MAX_DEPTH + 1) / 2);
+      return false;
+   }
+
+   const struct lvp_bvh_box_node *box = ptr;
+
+   (*num_internal)++;
+   for (unsigned i = 0; i < LVP_BVH_NODE_WIDTH; i++) {
+      if (box->children[i] == LVP_BVH_INVALID_NODE)
+         continue;
+
+      lvp_aabb child_bounds;
+      lvp_bvh_box_node_child_bounds(box, i, &child_bounds);
+
+      child_bounds.min.x = MAX2(child_bounds.min.x, bounds->min.x);
+      child_bounds.min.y = MAX2(child_bounds.min.y, bounds->min.y);
+      child_bounds.min.z = MAX2(child_bounds.min.z, bounds->min.z);
+      child_bounds.max.x = MIN2(child_bounds.max.x, bounds->max.x);
+      child_bounds.max.y = MIN2(child_bounds.max.y, bounds->max.y);
+      child_bounds.max.z = MIN2(child_bounds.max.z, bounds->max.z);
+
+      if (!validate_node(bvh, box->children[i], &child_bounds, depth + 1, leaf_seen,
+                         num_internal))
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * The root bounds have to be exactly the bounds of the active leaves.
+ */
+static bool
+validate_root_bounds(const struct bvh *bvh)
+{
+   const struct lvp_bvh_header *header = (const void *)bvh->data;
+   lvp_aabb expected = {
+      .min = {INFINITY, INFINITY, INFINITY},
+      .max = {-INFINITY, -INFINITY, -INFINITY},
+   };
+
+   for (uint32_t i = 0; i < bvh->leaf_count; i++) {
+      const lvp_aabb *leaf = &bvh->leaf_bounds[i];
+      if (isnan(leaf->min.x))
+         continue;
+
+      expected.min.x = MIN2(expected.min.x, leaf->min.x);
+      expected.min.y = MIN2(expected.min.y, leaf->min.y);
+      expected.min.z = MIN2(expected.min.z, leaf->min.z);
+      expected.max.x = MAX2(expected.max.x, leaf->max.x);
+      expected.max.y = MAX2(expected.max.y, leaf->max.y);
+      expected.max.z = MAX2(expected.max.z, leaf->max.z);
+   }
+
+   const float *a = &header->bounds.min.x, *b = &expected.min.x;
+   for (unsigned c = 0; c < 6; c++) {
+      if (!(a[c] == b[c])) {
+         fprintf(stderr, "root bounds (%f %f %f) (%f %f %f), expected (%f %f %f) (%f %f %f)\n",
+                 a[0], a[1], a[2], a[3], a[4], a[5], b[0], b[1], b[2], b[3], b[4], b[5]);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool
+validate_bvh(const struct bvh *bvh, uint32_t *num_internal_out)
+{
+   uint8_t *leaf_seen = calloc(bvh->leaf_count, 1);
+   uint32_t num_internal = 0;
+   const lvp_aabb everything = {
+      .min = {-INFINITY, -INFINITY, -INFINITY},
+      .max = {INFINITY, INFINITY, INFINITY},
+   };
+   bool ok = validate_node(bvh, LVP_BVH_ROOT_NODE, &everything, 0, leaf_seen, &num_internal);
+
+   for (uint32_t i = 0; ok && i < bvh->leaf_count; i++) {
+      if (!leaf_seen[i] && !isnan(bvh->leaf_bounds[i].min.x)) {
+         fprintf(stderr, "leaf %u not referenced\n", i);
+         ok = false;
+      }
+   }
+
+   if (ok && num_internal > lvp_bvh_max_internal_nodes(bvh->leaf_count)) {
+      fprintf(stderr, "%u internal nodes for %u leaves\n", num_internal, bvh->leaf_count);
+      ok = false;
+   }
+
+   free(leaf_seen);
+   *num_internal_out = num_internal;
+   return ok;
+}
+
+static bool
+test_build(struct lp_cs_tpool *tpool, const char *name, VkBuildAccelerationStructureFlagsKHR flags,
+           const struct lvp_bvh_triangle_node *tris, const lvp_aabb *leaf_bounds, uint32_t count,
+           const struct ray *rays)
+{
+   struct bvh bvh = {
+      .leaf_bounds = leaf_bounds,
+      .leaf_count = count,
+      .leaf_nodes_offset = sizeof(struct lvp_bvh_header) +
+                           lvp_bvh_max_internal_nodes(count) * sizeof(struct lvp_bvh_box_node),
+   };
+   bvh.data = malloc(bvh.leaf_nodes_offset + count * sizeof(struct lvp_bvh_triangle_node));
+   memcpy(bvh.data + bvh.leaf_nodes_offset, tris, count * sizeof(struct lvp_bvh_triangle_node));
+
+   struct lvp_bvh_build_args args = {
+      .dst = bvh.data,
+      .leaf_bounds = leaf_bounds,
+      .leaf_count = count,
+      .leaf_nodes_offset = bvh.leaf_nodes_offset,
+      .leaf_node_type = lvp_bvh_node_triangle,
+      .leaf_node_size = sizeof(struct lvp_bvh_triangle_node),
+      .flags = flags,
+      .scratch = malloc(lvp_bvh_build_scratch_size(count)),
+   };
+
+   double build_time[2];
+   for (unsigned threaded = 0; threaded < 2; threaded++) {
+      args.tpool = threaded ? tpool : NULL;
+
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < NUM_BUILDS; i++)
+         lvp_build_bvh(&args);
+      build_time[threaded] = (os_time_get_nano() - start) / (NUM_BUILDS * 1000000.0);
+   }
+
+   uint32_t num_internal;
+   bool ok = validate_bvh(&bvh, &num_internal) && validate_root_bounds(&bvh);
+
+   uint64_t visited = 0;
+   for (unsigned i = 0; ok && i < NUM_RAYS; i++) {
+      unsigned ray_visited = 0;
+      float t = trace(&bvh, &rays[i], &ray_visited);
+      visited += ray_visited;
+
+      if (i < NUM_CHECK_RAYS) {
+         float expected = INFINITY;
+         for (uint32_t j = 0; j < count; j++)
+            expected = MIN2(expected, intersect_triangle(&rays[i], &tris[j]));
+
+         if (t != expected) {
+            fprintf(stderr, "ray %u: hit at %f, expected %f\n", i, t, expected);
+            ok = false;
+         }
+      }
+   }
+
+   printf("%-16s build %8.2f ms (%8.2f ms single threaded), %u internal nodes, "
+          "%6.1f nodes visited per ray%s\n",
+          name, build_time[1], build_time[0], num_internal, (double)visited / NUM_RAYS,
+          ok ? "" : ", FAIL");
+
+   free(args.scratch);
+   free(bvh.data);
+   return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct lvp_bvh_triangle_node *tris;
+   uint32_t count = create_scene(&tris);
+
+   lvp_aabb *leaf_bounds = malloc(count * sizeof(lvp_aabb));
+   for (uint32_t i = 0; i < count; i++)
+      triangle_bounds(&tris[i], &leaf_bounds[i]);
+
+   struct ray *rays = malloc(NUM_RAYS * sizeof(struct ray));
+   create_rays(rays, NUM_RAYS);
+
+   struct lp_cs_tpool *tpool =
+      lp_cs_tpool_create(MIN2(util_get_cpu_caps()->nr_cpus, LP_MAX_THREADS));
+
+   printf("%u triangles, %u rays, %u threads\n", count, NUM_RAYS, tpool->num_threads);
+
+   bool ok = true;
+   ok &= test_build(tpool, "fast build", VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR,
+                    tris, leaf_bounds, count, rays);
+   ok &= test_build(tpool, "default", 0, tris, leaf_bounds, count, rays);
+   ok &= test_build(tpool, "fast trace", VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+                    tris, leaf_bounds, count, rays);
+
+   /* Inactive triangles have a NaN x coordinate.  They must neither be
+    * referenced by the BVH nor widen its bounds.
+    */
+   for (uint32_t i = 0; i < count; i++) {
+      if (i % 3 == 0) {
+         for (unsigned v = 0; v < 3; v++)
+            tris[i].coords[v][0] = NAN;
+         triangle_bounds(&tris[i], &leaf_bounds[i]);
+      }
+   }
+   ok &= test_build(tpool, "some inactive", 0, tris, leaf_bounds, count, rays);
+
+   for (uint32_t i = 1; i < count; i++) {
+      for (unsigned v = 0; v < 3; v++)
+         tris[i].coords[v][0] = NAN;
+      triangle_bounds(&tris[i], &leaf_bounds[i]);
+   }
+   ok &= test_build(tpool, "one active", 0, tris, leaf_bounds, count, rays);
+
+   for (unsigned v = 0; v < 3; v++)
+      tris[0].coords[v][0] = NAN;
+   triangle_bounds(&tris[0], &leaf_bounds[0]);
+   ok &= test_build(tpool, "none active", 0, tris, leaf_bounds, count, rays);
+
+   lp_cs_tpool_destroy(tpool);
+   free(rays);
+   free(leaf_bounds);
+   free(tris);
+
+   return ok ? 0 : 1;
+}
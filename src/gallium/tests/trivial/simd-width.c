@@ -0,0 +1,384 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Compares shader throughput of llvmpipe with 256 and 512 bit vectors.
+ *
+ * For each width a child process is forked with LP_NATIVE_VECTOR_WIDTH
+ * set, which draws a number of full-screen quads with a texturing and
+ * ALU heavy fragment shader, and dispatches a compute shader running the
+ * same ALU code over an image of the same size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "pipe/p_state.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_inlines.h"
+#include "cso_cache/cso_context.h"
+#include "util/u_draw_quad.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "util/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "pipe-loader/pipe_loader.h"
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define ITERATIONS 20
+#define ALU_BLOCKS 8
+
+struct program
+{
+   struct pipe_loader_device *dev;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+
+   struct pipe_resource *vbuf;
+   struct pipe_resource *target;
+   struct pipe_resource *tex;
+   struct pipe_resource *image;
+   struct pipe_sampler_view *view;
+   struct pipe_surface *surf;
+
+   void *vs;
+   void *fs;
+   void *cs;
+};
+
+/* ALU code shared by the fragment and compute shaders, working on TEMP[1] */
+static void
+append_alu(char *text, size_t size, unsigned imm)
+{
+   for (unsigned i = 0; i < ALU_BLOCKS; i++) {
+      size_t len = strlen(text);
+      snprintf(text + len, size - len,
+               "MAD TEMP[1], TEMP[1], IMM[%u].xxxx, IMM[%u].yyyy\n"
+               "SIN TEMP[2].x, TEMP[1].xxxx\n"
+               "COS TEMP[2].y, TEMP[1].yyyy\n"
+               "MAD TEMP[1], TEMP[2].xyxy, IMM[%u].zzzz, TEMP[1]\n",
+               imm, imm, imm);
+   }
+}
+
+static void *
+create_shader(struct program *p, const char *text, bool compute)
+{
+   struct tgsi_token tokens[4096];
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate shader:\n%s", text);
+      exit(1);
+   }
+
+   if (compute) {
+      struct pipe_compute_state state = {0};
+      state.ir_type = PIPE_SHADER_IR_TGSI;
+      state.prog = tokens;
+      return p->pipe->create_compute_state(p->pipe, &state);
+   } else {
+      struct pipe_shader_state state;
+      pipe_shader_state_from_tgsi(&state, tokens);
+      return p->pipe->create_fs_state(p->pipe, &state);
+   }
+}
+
+static void
+init_prog(struct program *p)
+{
+   char text[8192];
+
+   if (!pipe_loader_probe(&p->dev, 1, false)) {
+      fprintf(stderr, "no device found\n");
+      exit(1);
+   }
+
+   p->screen = pipe_loader_create_screen(p->dev, false);
+   p->pipe = p->screen->context_create(p->screen, NULL, 0);
+   p->cso = cso_create_context(p->pipe, 0);
+
+   /* full-screen quad: position, texcoord */
+   static const float vertices[4][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } },
+      { {  1.0f, -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } },
+      { {  1.0f,  1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f, 1.0f } },
+      { { -1.0f,  1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+   };
+   p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+                                PIPE_USAGE_DEFAULT, sizeof(vertices));
+   pipe_buffer_write(p->pipe, p->vbuf, 0, sizeof(vertices), vertices);
+
+   struct pipe_resource tmpl;
+   memset(&tmpl, 0, sizeof(tmpl));
+   tmpl.target = PIPE_TEXTURE_2D;
+   tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmpl.width0 = WIDTH;
+   tmpl.height0 = HEIGHT;
+   tmpl.depth0 = 1;
+   tmpl.array_size = 1;
+   tmpl.bind = PIPE_BIND_RENDER_TARGET;
+   p->target = p->screen->resource_create(p->screen, &tmpl);
+
+   tmpl.width0 = 256;
+   tmpl.height0 = 256;
+   tmpl.bind = PIPE_BIND_SAMPLER_VIEW;
+   p->tex = p->screen->resource_create(p->screen, &tmpl);
+
+   tmpl.format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   tmpl.width0 = WIDTH;
+   tmpl.height0 = HEIGHT;
+   tmpl.bind = PIPE_BIND_SHADER_IMAGE;
+   p->image = p->screen->resource_create(p->screen, &tmpl);
+
+   struct pipe_sampler_view view_tmpl;
+   u_sampler_view_default_template(&view_tmpl, p->tex, p->tex->format);
+   p->view = p->pipe->create_sampler_view(p->pipe, p->tex, &view_tmpl);
+
+   struct pipe_surface surf_tmpl;
+   memset(&surf_tmpl, 0, sizeof(surf_tmpl));
+   surf_tmpl.format = p->target->format;
+   p->surf = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+   const enum tgsi_semantic semantic_names[] =
+      { TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_GENERIC };
+   const unsigned semantic_indexes[] = { 0, 0 };
+   p->vs = util_make_vertex_passthrough_shader(p->pipe, 2, semantic_names,
+                                               semantic_indexes, false);
+
+   snprintf(text, sizeof(text),
+            "FRAG\n"
+            "DCL IN[0], GENERIC[0], LINEAR\n"
+            "DCL OUT[0], COLOR\n"
+            "DCL SAMP[0]\n"
+            "DCL SVIEW[0], 2D, FLOAT\n"
+            "DCL TEMP[0..2]\n"
+            "IMM[0] FLT32 { 1.001, 0.5, 0.25, 0.0 }\n"
+            "TEX TEMP[0], IN[0], SAMP[0], 2D\n"
+            "ADD TEMP[1], TEMP[0], IN[0]\n");
+   append_alu(text, sizeof(text), 0);
+   strncat(text, "MOV OUT[0], TEMP[1]\nEND\n", sizeof(text) - strlen(text) - 1);
+   p->fs = create_shader(p, text, false);
+
+   snprintf(text, sizeof(text),
+            "COMP\n"
+            "PROPERTY CS_FIXED_BLOCK_WIDTH 8\n"
+            "PROPERTY CS_FIXED_BLOCK_HEIGHT 8\n"
+            "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+            "DCL SV[0], THREAD_ID\n"
+            "DCL SV[1], BLOCK_ID\n"
+            "DCL IMAGE[0], 2D, PIPE_FORMAT_R32G32B32A32_FLOAT, WR\n"
+            "DCL TEMP[0..2]\n"
+            "IMM[0] UINT32 { 8, 8, 0, 0 }\n"
+            "IMM[1] FLT32 { 1.001, 0.5, 0.25, 0.0009765625 }\n"
+            "UMAD TEMP[0].xy, SV[1], IMM[0], SV[0]\n"
+            "U2F TEMP[1], TEMP[0].xyxy\n"
+            "MUL TEMP[1], TEMP[1], IMM[1].wwww\n");
+   append_alu(text, sizeof(text), 1);
+   strncat(text,
+           "STORE IMAGE[0], TEMP[0], TEMP[1], 2D, PIPE_FORMAT_R32G32B32A32_FLOAT\n"
+           "END\n", sizeof(text) - strlen(text) - 1);
+   p->cs = create_shader(p, text, true);
+}
+
+static void
+close_prog(struct program *p)
+{
+   cso_destroy_context(p->cso);
+
+   p->pipe->delete_vs_state(p->pipe, p->vs);
+   p->pipe->delete_fs_state(p->pipe, p->fs);
+   p->pipe->delete_compute_state(p->pipe, p->cs);
+
+   pipe_surface_reference(&p->surf, NULL);
+   pipe_sampler_view_reference(&p->view, NULL);
+   pipe_resource_reference(&p->image, NULL);
+   pipe_resource_reference(&p->target, NULL);
+   pipe_resource_reference(&p->tex, NULL);
+   pipe_resource_reference(&p->vbuf, NULL);
+
+   p->pipe->destroy(p->pipe);
+   p->screen->destroy(p->screen);
+   pipe_loader_release(&p->dev, 1);
+}
+
+static void
+finish(struct program *p)
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   p->pipe->flush(p->pipe, &fence, 0);
+   p->screen->fence_finish(p->screen, NULL, fence, OS_TIMEOUT_INFINITE);
+   p->screen->fence_reference(p->screen, &fence, NULL);
+}
+
+static void
+setup_draw(struct program *p)
+{
+   struct pipe_framebuffer_state fb;
+   memset(&fb, 0, sizeof(fb));
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = p->surf;
+   cso_set_framebuffer(p->cso, &fb);
+
+   struct pipe_blend_state blend;
+   memset(&blend, 0, sizeof(blend));
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(p->cso, &blend);
+
+   struct pipe_depth_stencil_alpha_state dsa;
+   memset(&dsa, 0, sizeof(dsa));
+   cso_set_depth_stencil_alpha(p->cso, &dsa);
+
+   struct pipe_rasterizer_state rast;
+   memset(&rast, 0, sizeof(rast));
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   cso_set_rasterizer(p->cso, &rast);
+
+   struct pipe_viewport_state vp;
+   memset(&vp, 0, sizeof(vp));
+   vp.scale[0] = WIDTH / 2.0f;
+   vp.scale[1] = HEIGHT / 2.0f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = WIDTH / 2.0f;
+   vp.translate[1] = HEIGHT / 2.0f;
+   vp.translate[2] = 0.5f;
+   vp.swizzle_x = PIPE_VIEWPORT_SWIZZLE_POSITIVE_X;
+   vp.swizzle_y = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Y;
+   vp.swizzle_z = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Z;
+   vp.swizzle_w = PIPE_VIEWPORT_SWIZZLE_POSITIVE_W;
+   cso_set_viewport(p->cso, &vp);
+
+   struct pipe_sampler_state sampler;
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   const struct pipe_sampler_state *samplers[] = { &sampler };
+   cso_set_samplers(p->cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   p->pipe->set_sampler_views(p->pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0,
+                              false, &p->view);
+
+   struct cso_velems_state velem;
+   memset(&velem, 0, sizeof(velem));
+   velem.count = 2;
+   for (unsigned i = 0; i < 2; i++) {
+      velem.velems[i].src_offset = i * 4 * sizeof(float);
+      velem.velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+      velem.velems[i].src_stride = 2 * 4 * sizeof(float);
+   }
+   cso_set_vertex_elements(p->cso, &velem);
+
+   cso_set_fragment_shader_handle(p->cso, p->fs);
+   cso_set_vertex_shader_handle(p->cso, p->vs);
+}
+
+static void
+draw(struct program *p)
+{
+   util_draw_vertex_buffer(p->pipe, p->cso, p->vbuf, 0, false,
+                           MESA_PRIM_QUADS, 4, 2);
+}
+
+static void
+dispatch(struct program *p)
+{
+   struct pipe_grid_info info = {0};
+   info.block[0] = 8;
+   info.block[1] = 8;
+   info.block[2] = 1;
+   info.grid[0] = WIDTH / 8;
+   info.grid[1] = HEIGHT / 8;
+   info.grid[2] = 1;
+
+   p->pipe->launch_grid(p->pipe, &info);
+}
+
+/* Returns millions of pixels or invocations per second */
+static double
+measure(struct program *p, void (*func)(struct program *p))
+{
+   /* Compile the shader variants first */
+   func(p);
+   finish(p);
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < ITERATIONS; i++)
+      func(p);
+   finish(p);
+   int64_t end = os_time_get_nano();
+
+   return (double)WIDTH * HEIGHT * ITERATIONS * 1000.0 / (end - start);
+}
+
+static void
+run(unsigned width)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   char value[16];
+
+   snprintf(value, sizeof(value), "%u", width);
+   setenv("LP_NATIVE_VECTOR_WIDTH", value, 1);
+
+   init_prog(p);
+
+   setup_draw(p);
+   double fs_rate = measure(p, draw);
+
+   struct pipe_image_view image = {0};
+   image.resource = p->image;
+   image.format = p->image->format;
+   image.shader_access = image.access = PIPE_IMAGE_ACCESS_WRITE;
+   p->pipe->bind_compute_state(p->pipe, p->cs);
+   p->pipe->set_shader_images(p->pipe, PIPE_SHADER_COMPUTE, 0, 1, 0, &image);
+   double cs_rate = measure(p, dispatch);
+
+   printf("%u bit: fragment %8.1f Mpixel/s, compute %8.1f Minvocation/s\n",
+          width, fs_rate, cs_rate);
+
+   p->pipe->set_shader_images(p->pipe, PIPE_SHADER_COMPUTE, 0, 0, 1, NULL);
+   close_prog(p);
+   FREE(p);
+}
+
+int main(int argc, char **argv)
+{
+   static const unsigned widths[] = { 256, 512 };
+
+   /* gallivm picks the vector width once per process */
+   for (unsigned i = 0; i < ARRAY_SIZE(widths); i++) {
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+         run(widths[i]);
+         exit(0);
+      }
+
+      int status;
+      if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+          !WIFEXITED(status) || WEXITSTATUS(status)) {
+         fprintf(stderr, "%u bit run failed\n", widths[i]);
+         return 1;
+      }
+   }
+
+   return 0;
+}
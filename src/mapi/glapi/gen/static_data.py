@@ -1711,6 +1711,8 @@ offsets = {
     "FramebufferTextureMultiviewOVR": 1675,
     "NamedFramebufferTextureMultiviewOVR": 1676,
     "FramebufferTextureMultisampleMultiviewOVR": 1677,
+    "DrawArraysMerged": 1678,
+    "DrawElementsMerged": 1679,
 }
 
 functions = [
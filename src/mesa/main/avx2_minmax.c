@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2024 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* AVX2 min/max scan for 8, 16 and 32-bit index buffers.
+ *
+ * Restart indices are skipped by forcing the matching lanes to the identity
+ * value of each reduction (all ones for min, zero for max), so the inner
+ * loop stays branchless. If every index is a restart index, the result is
+ * min = ~0 and max = 0, which matches the scalar code in vbo.
+ */
+
+#include "main/sse_minmax.h"
+#include "util/macros.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+static ALWAYS_INLINE __m256i
+set1(unsigned value, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return _mm256_set1_epi8((char)value);
+   case 2:  return _mm256_set1_epi16((short)value);
+   default: return _mm256_set1_epi32((int)value);
+   }
+}
+
+static ALWAYS_INLINE __m256i
+cmpeq(__m256i a, __m256i b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return _mm256_cmpeq_epi8(a, b);
+   case 2:  return _mm256_cmpeq_epi16(a, b);
+   default: return _mm256_cmpeq_epi32(a, b);
+   }
+}
+
+static ALWAYS_INLINE __m256i
+min_epu(__m256i a, __m256i b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return _mm256_min_epu8(a, b);
+   case 2:  return _mm256_min_epu16(a, b);
+   default: return _mm256_min_epu32(a, b);
+   }
+}
+
+static ALWAYS_INLINE __m256i
+max_epu(__m256i a, __m256i b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return _mm256_max_epu8(a, b);
+   case 2:  return _mm256_max_epu16(a, b);
+   default: return _mm256_max_epu32(a, b);
+   }
+}
+
+static ALWAYS_INLINE unsigned
+load_index(const uint8_t *p, unsigned i, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return p[i];
+   case 2:  return ((const uint16_t *)p)[i];
+   default: return ((const uint32_t *)p)[i];
+   }
+}
+
+static ALWAYS_INLINE void
+index_array_min_max(const uint8_t *indices, unsigned index_size,
+                    unsigned count, bool restart, unsigned restart_index,
+                    unsigned *min_index, unsigned *max_index)
+{
+   const unsigned lanes = 32 / index_size;
+   const unsigned type_max = index_size == 4 ? ~0u : (1u << (index_size * 8)) - 1;
+   unsigned min = type_max;
+   unsigned max = 0;
+   unsigned i = 0;
+
+   if (count >= 2 * lanes) {
+      const __m256i restart_vec = set1(restart_index, index_size);
+      __m256i min0 = _mm256_set1_epi32(-1), min1 = min0;
+      __m256i max0 = _mm256_setzero_si256(), max1 = max0;
+      const unsigned vec_count = count & ~(2 * lanes - 1);
+
+      /* Two independent accumulator pairs hide the min/max latency. */
+      for (; i < vec_count; i += 2 * lanes) {
+         __m256i v0 = _mm256_loadu_si256((const __m256i *)(indices + i * index_size));
+         __m256i v1 = _mm256_loadu_si256((const __m256i *)(indices + (i + lanes) * index_size));
+         __m256i vmin0 = v0, vmin1 = v1;
+
+         if (restart) {
+            __m256i eq0 = cmpeq(v0, restart_vec, index_size);
+            __m256i eq1 = cmpeq(v1, restart_vec, index_size);
+            vmin0 = _mm256_or_si256(v0, eq0);
+            vmin1 = _mm256_or_si256(v1, eq1);
+            v0 = _mm256_andnot_si256(eq0, v0);
+            v1 = _mm256_andnot_si256(eq1, v1);
+         }
+
+         min0 = min_epu(min0, vmin0, index_size);
+         min1 = min_epu(min1, vmin1, index_size);
+         max0 = max_epu(max0, v0, index_size);
+         max1 = max_epu(max1, v1, index_size);
+      }
+
+      alignas(32) uint8_t min_arr[32];
+      alignas(32) uint8_t max_arr[32];
+      _mm256_store_si256((__m256i *)min_arr, min_epu(min0, min1, index_size));
+      _mm256_store_si256((__m256i *)max_arr, max_epu(max0, max1, index_size));
+
+      for (unsigned l = 0; l < lanes; l++) {
+         min = MIN2(min, load_index(min_arr, l, index_size));
+         max = MAX2(max, load_index(max_arr, l, index_size));
+      }
+   }
+
+   for (; i < count; i++) {
+      unsigned v = load_index(indices, i, index_size);
+
+      if (restart && v == restart_index)
+         continue;
+      min = MIN2(min, v);
+      max = MAX2(max, v);
+   }
+
+   /* Only restart indices: report an empty range like the scalar code. */
+   if (min > max)
+      min = ~0u;
+
+   *min_index = min;
+   *max_index = max;
+}
+
+void
+_mesa_index_array_min_max_avx2(const void *indices, unsigned index_size,
+                               unsigned count, bool restart,
+                               unsigned restart_index,
+                               unsigned *min_index, unsigned *max_index)
+{
+   /* A restart index that doesn't fit the index type never matches. */
+   if (index_size < 4 && restart_index >> (index_size * 8))
+      restart = false;
+
+   switch (index_size) {
+   case 1:
+      if (restart)
+         index_array_min_max(indices, 1, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 1, count, false, 0, min_index, max_index);
+      break;
+   case 2:
+      if (restart)
+         index_array_min_max(indices, 2, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 2, count, false, 0, min_index, max_index);
+      break;
+   default:
+      if (restart)
+         index_array_min_max(indices, 4, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 4, count, false, 0, min_index, max_index);
+      break;
+   }
+}
@@ -2004,6 +2004,159 @@ _mesa_DrawElementsUserBufPacked(const GLvoid *ptr)
                                      count, type, indices, 0, 1, 0);
 }
 
+/**
+ * Consecutive glDrawArrays calls merged by glthread. The draws are validated
+ * one by one like separate calls, but they are executed as one multi-draw
+ * with gl_DrawID equal to 0 for all of them.
+ */
+void GLAPIENTRY
+_mesa_DrawArraysMerged(const GLvoid *ptr)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   FLUSH_FOR_DRAW(ctx);
+
+   _mesa_set_varying_vp_inputs(ctx, ctx->VertexProgram._VPModeInputFilter &
+                               ctx->Array._DrawVAO->_EnabledWithMapMode);
+   if (ctx->NewState)
+      _mesa_update_state(ctx);
+
+   const struct marshal_cmd_DrawArraysMerged *cmd =
+      (const struct marshal_cmd_DrawArraysMerged *)ptr;
+   const GLenum mode = cmd->mode;
+
+   struct pipe_draw_start_count_bias *draw =
+      get_temp_draws(ctx, cmd->num_draws);
+   if (!draw)
+      return;
+
+   unsigned num_draws = 0;
+   for (unsigned i = 0; i < cmd->num_draws; i++) {
+      const GLint first = cmd->draws[i].first;
+      const GLsizei count = cmd->draws[i].count;
+
+      if (!_mesa_is_no_error_enabled(ctx) &&
+          !_mesa_validate_DrawArrays(ctx, mode, count))
+         continue;
+
+      draw[num_draws].start = first;
+      draw[num_draws].count = count;
+      num_draws++;
+   }
+
+   if (!num_draws)
+      return;
+
+   struct pipe_draw_info info;
+
+   info.mode = mode;
+   info.index_size = 0;
+   /* Packed section begin. */
+   info.primitive_restart = false;
+   info.has_user_indices = false;
+   info.index_bounds_valid = false;
+   info.increment_draw_id = false;
+   info.was_line_loop = false;
+   info.take_index_buffer_ownership = false;
+   info.index_bias_varies = false;
+   /* Packed section end. */
+   info.start_instance = 0;
+   info.instance_count = 1;
+
+   st_prepare_draw(ctx, ST_PIPELINE_RENDER_STATE_MASK);
+
+   ctx->Driver.DrawGallium(ctx, &info, ctx->DrawID, NULL, draw, num_draws);
+
+   if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH)
+      _mesa_flush(ctx);
+}
+
+/**
+ * Consecutive glDrawElements calls merged by glthread, which always use the
+ * bound index buffer. Like _mesa_DrawArraysMerged.
+ */
+void GLAPIENTRY
+_mesa_DrawElementsMerged(const GLvoid *ptr)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   FLUSH_FOR_DRAW(ctx);
+
+   _mesa_set_varying_vp_inputs(ctx, ctx->VertexProgram._VPModeInputFilter &
+                               ctx->Array._DrawVAO->_EnabledWithMapMode);
+   if (ctx->NewState)
+      _mesa_update_state(ctx);
+
+   const struct marshal_cmd_DrawElementsMerged *cmd =
+      (const struct marshal_cmd_DrawElementsMerged *)ptr;
+   const GLenum mode = cmd->mode;
+   const GLenum type = _mesa_decode_index_type(cmd->type);
+   struct gl_buffer_object *index_bo = ctx->Array.VAO->IndexBufferObj;
+
+   struct pipe_draw_start_count_bias *draw =
+      get_temp_draws(ctx, cmd->num_draws);
+   if (!draw)
+      return;
+
+   unsigned index_size_shift = _mesa_get_index_size_shift(type);
+   unsigned num_draws = 0;
+
+   for (unsigned i = 0; i < cmd->num_draws; i++) {
+      const GLsizei count = cmd->draws[i].count;
+      const GLuint offset = cmd->draws[i].offset;
+
+      if (!_mesa_is_no_error_enabled(ctx) &&
+          !_mesa_validate_DrawElements(ctx, mode, count, type))
+         continue;
+
+      /* Skip the same draws as _mesa_validated_drawrangeelements. */
+      if (!index_bo ||
+          !indices_aligned(index_size_shift, (void*)(uintptr_t)offset) ||
+          index_bo->Size < offset || !index_bo->buffer)
+         continue;
+
+      draw[num_draws].start = offset >> index_size_shift;
+      draw[num_draws].count = count;
+      draw[num_draws].index_bias = 0;
+      num_draws++;
+   }
+
+   if (!num_draws)
+      return;
+
+   struct pipe_draw_info info;
+
+   info.mode = mode;
+   info.index_size = 1 << index_size_shift;
+   /* Packed section begin. */
+   info.primitive_restart = ctx->Array._PrimitiveRestart[index_size_shift];
+   info.has_user_indices = false;
+   info.index_bounds_valid = false;
+   info.increment_draw_id = false;
+   info.was_line_loop = false;
+   info.take_index_buffer_ownership = false;
+   info.index_bias_varies = false;
+   /* Packed section end. */
+   info.start_instance = 0;
+   info.instance_count = 1;
+   info.restart_index = ctx->Array._RestartIndex[index_size_shift];
+
+   if (ctx->pipe->draw_vbo == tc_draw_vbo) {
+      /* Fast path for u_threaded_context to eliminate atomics. */
+      info.index.resource = _mesa_get_bufferobj_reference(ctx, index_bo);
+      info.take_index_buffer_ownership = true;
+   } else {
+      info.index.resource = index_bo->buffer;
+   }
+
+   st_prepare_draw(ctx, ST_PIPELINE_RENDER_STATE_MASK);
+   if (!validate_index_bounds(ctx, &info, draw, num_draws))
+      return;
+
+   ctx->Driver.DrawGallium(ctx, &info, ctx->DrawID, NULL, draw, num_draws);
+
+   if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH)
+      _mesa_flush(ctx);
+}
+
 /**
  * Inner support for both _mesa_MultiDrawElements() and
  * _mesa_MultiDrawRangeElements().
@@ -38,12 +38,30 @@
 #include "main/hash.h"
 #include "main/pixelstore.h"
 #include "util/u_atomic.h"
+#include "util/u_debug.h"
 #include "util/u_thread.h"
 #include "util/u_cpu_detect.h"
 #include "util/thread_sched.h"
+#include "util/timespec.h"
+
+#if DETECT_ARCH_SSE
+#include <xmmintrin.h>
+#endif
 
 #include "state_tracker/st_context.h"
 
+/* How many times the threads poll the ring before they go to sleep. */
+#define GLTHREAD_RING_SPIN_COUNT 4096
+
+/* How long the sleeping worker thread waits before it checks whether its
+ * queue is being killed at exit.
+ */
+#define GLTHREAD_RING_SLEEP_NS (100 * 1000 * 1000)
+
+DEBUG_GET_ONCE_BOOL_OPTION(glthread_ring, "MESA_GLTHREAD_RING", false)
+DEBUG_GET_ONCE_NUM_OPTION(glthread_batch_size, "MESA_GLTHREAD_BATCH_SIZE",
+                          MARSHAL_MAX_CMD_BUFFER_SIZE)
+
 static void
 glthread_update_global_locking(struct gl_context *ctx)
 {
@@ -158,6 +176,106 @@ glthread_unmarshal_batch(void *job, void *gdata, int thread_index)
    p_atomic_inc(&ctx->GLThread.stats.num_batches);
 }
 
+static inline void
+glthread_ring_pause(void)
+{
+#if DETECT_ARCH_SSE
+   _mm_pause();
+#endif
+}
+
+/**
+ * Wait until the batch has been executed by the worker thread, spinning
+ * first because it's usually very close to done in ring mode.
+ */
+static void
+glthread_ring_wait_batch(struct glthread_state *glthread,
+                         struct glthread_batch *batch)
+{
+   for (unsigned i = 0; i < glthread->ring.spin_count; i++) {
+      if (util_queue_fence_is_signalled(&batch->fence))
+         return;
+      glthread_ring_pause();
+   }
+
+   util_queue_fence_wait(&batch->fence);
+}
+
+/**
+ * Wait until the application thread submits the batch following "tail".
+ * Return false if there is no more work because the ring is being torn down.
+ */
+static bool
+glthread_ring_wait_work(struct glthread_state *glthread, unsigned tail)
+{
+   struct glthread_ring *ring = &glthread->ring;
+   const unsigned idle = tail * 2;
+
+   for (unsigned i = 0; i < ring->spin_count; i++) {
+      if (p_atomic_read(&ring->head) != idle)
+         return true;
+      glthread_ring_pause();
+   }
+
+   /* Announce that we are going to sleep. This fails if a batch has been
+    * submitted in the meantime.
+    */
+   if (p_atomic_cmpxchg(&ring->head, idle, idle | 1) != idle)
+      return true;
+
+   mtx_lock(&ring->mutex);
+   while (p_atomic_read(&ring->head) == (idle | 1) && !ring->exit) {
+      /* util_queue joins its threads at exit without knowing about the
+       * ring, so don't sleep forever when that happens.
+       */
+      if (p_atomic_read(&glthread->queue.num_threads) == 0)
+         break;
+
+      struct timespec ts;
+      timespec_from_nsec(&ts, os_time_get_nano() + GLTHREAD_RING_SLEEP_NS);
+      u_cnd_monotonic_timedwait(&ring->cond, &ring->mutex, &ts);
+   }
+   mtx_unlock(&ring->mutex);
+
+   /* Only this thread sets and clears the bit. */
+   const unsigned head = p_atomic_dec_return(&ring->head);
+   return head != idle;
+}
+
+/**
+ * The only job of the queue in ring mode, which executes the batches in the
+ * order of submission until the ring is destroyed.
+ */
+static void
+glthread_ring_execute(void *job, void *gdata, int thread_index)
+{
+   struct gl_context *ctx = (struct gl_context*)job;
+   struct glthread_state *glthread = &ctx->GLThread;
+
+   for (unsigned tail = 0; glthread_ring_wait_work(glthread, tail); tail++) {
+      struct glthread_batch *batch =
+         &glthread->batches[tail % MARSHAL_MAX_BATCHES];
+
+      glthread_unmarshal_batch(batch, NULL, thread_index);
+      util_queue_fence_signal(&batch->fence);
+   }
+}
+
+static void
+glthread_ring_submit(struct glthread_state *glthread,
+                     struct glthread_batch *batch)
+{
+   struct glthread_ring *ring = &glthread->ring;
+
+   util_queue_fence_reset(&batch->fence);
+
+   if (p_atomic_add_return(&ring->head, 2) & 1) {
+      mtx_lock(&ring->mutex);
+      u_cnd_monotonic_signal(&ring->cond);
+      mtx_unlock(&ring->mutex);
+   }
+}
+
 static void
 glthread_apply_thread_sched_policy(struct gl_context *ctx, bool initialization)
 {
@@ -218,8 +336,20 @@ _mesa_glthread_init(struct gl_context *ctx)
        !screen->get_param(screen, PIPE_CAP_ALLOW_MAPPED_BUFFERS_DURING_EXECUTION))
       return;
 
+   /* The batch size is in bytes and it must be able to hold the biggest
+    * call.
+    */
+   unsigned batch_size =
+      CLAMP(debug_get_option_glthread_batch_size(),
+            MARSHAL_MAX_CMD_BUFFER_SIZE, MARSHAL_MAX_BATCH_BUFFER_SIZE) / 8;
+
+   uint64_t *buffers = malloc(MARSHAL_MAX_BATCHES * batch_size * 8);
+   if (!buffers)
+      return;
+
    if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 2,
                         1, 0, NULL)) {
+      free(buffers);
       return;
    }
 
@@ -231,6 +361,7 @@ _mesa_glthread_init(struct gl_context *ctx)
    if (!ctx->MarshalExec) {
       _mesa_DeinitHashTable(&glthread->VAOs, NULL, NULL);
       util_queue_destroy(&glthread->queue);
+      free(buffers);
       return;
    }
 
@@ -239,8 +370,11 @@ _mesa_glthread_init(struct gl_context *ctx)
 
    for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++) {
       glthread->batches[i].ctx = ctx;
+      glthread->batches[i].buffer = buffers + i * batch_size;
       util_queue_fence_init(&glthread->batches[i].fence);
    }
+   /* Leave 1 slot for the END marker. */
+   glthread->max_used = batch_size - 1;
    glthread->next_batch = &glthread->batches[glthread->next];
    glthread->used = 0;
    glthread->stats.queue = &glthread->queue;
@@ -258,6 +392,17 @@ _mesa_glthread_init(struct gl_context *ctx)
    util_queue_fence_wait(&fence);
    util_queue_fence_destroy(&fence);
 
+   glthread->use_ring = debug_get_option_glthread_ring();
+   if (glthread->use_ring) {
+      /* Spinning only delays the other thread if they share the CPU. */
+      glthread->ring.spin_count =
+         util_get_cpu_caps()->nr_cpus > 1 ? GLTHREAD_RING_SPIN_COUNT : 0;
+      mtx_init(&glthread->ring.mutex, mtx_plain);
+      u_cnd_monotonic_init(&glthread->ring.cond);
+      util_queue_add_job(&glthread->queue, ctx, NULL,
+                         glthread_ring_execute, NULL, 0);
+   }
+
    glthread->thread_sched_enabled = ctx->pipe->set_context_param &&
                                     util_thread_scheduler_enabled();
    util_thread_scheduler_init_state(&glthread->thread_sched_state);
@@ -278,10 +423,23 @@ _mesa_glthread_destroy(struct gl_context *ctx)
    _mesa_glthread_disable(ctx);
 
    if (util_queue_is_initialized(&glthread->queue)) {
+      if (glthread->use_ring) {
+         mtx_lock(&glthread->ring.mutex);
+         glthread->ring.exit = true;
+         u_cnd_monotonic_signal(&glthread->ring.cond);
+         mtx_unlock(&glthread->ring.mutex);
+      }
+
       util_queue_destroy(&glthread->queue);
 
+      if (glthread->use_ring) {
+         u_cnd_monotonic_destroy(&glthread->ring.cond);
+         mtx_destroy(&glthread->ring.mutex);
+      }
+
       for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++)
          util_queue_fence_destroy(&glthread->batches[i].fence);
+      free(glthread->batches[0].buffer);
 
       _mesa_DeinitHashTable(&glthread->VAOs, free_vao, NULL);
       _mesa_glthread_release_upload_buffer(ctx);
@@ -351,6 +509,7 @@ glthread_finalize_batch(struct glthread_state *glthread,
    glthread->LastCallList = NULL;
    glthread->LastBindBuffer1 = NULL;
    glthread->LastBindBuffer2 = NULL;
+   glthread->LastDraw = NULL;
 }
 
 void
@@ -373,11 +532,21 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
 
    struct glthread_batch *next = glthread->next_batch;
 
-   util_queue_add_job(&glthread->queue, next, &next->fence,
-                      glthread_unmarshal_batch, NULL, 0);
+   if (glthread->use_ring) {
+      glthread_ring_submit(glthread, next);
+   } else {
+      util_queue_add_job(&glthread->queue, next, &next->fence,
+                         glthread_unmarshal_batch, NULL, 0);
+   }
    glthread->last = glthread->next;
    glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
    glthread->next_batch = &glthread->batches[glthread->next];
+
+   /* util_queue_add_job blocks when the queue is full, which guarantees
+    * that the next batch is idle. The ring has to wait for it explicitly.
+    */
+   if (glthread->use_ring)
+      glthread_ring_wait_batch(glthread, glthread->next_batch);
 }
 
 /**
@@ -406,7 +575,10 @@ _mesa_glthread_finish(struct gl_context *ctx)
    bool synced = false;
 
    if (!util_queue_fence_is_signalled(&last->fence)) {
-      util_queue_fence_wait(&last->fence);
+      if (glthread->use_ring)
+         glthread_ring_wait_batch(glthread, last);
+      else
+         util_queue_fence_wait(&last->fence);
       synced = true;
    }
 
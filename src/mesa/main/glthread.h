@@ -40,6 +40,13 @@
  */
 #define MARSHAL_MAX_CMD_SIZE (MARSHAL_MAX_CMD_BUFFER_SIZE - 8)
 
+/* The maximum size of one batch that can be selected with
+ * MESA_GLTHREAD_BATCH_SIZE. Bigger batches amortize the cost of handing them
+ * over to the worker thread, while the size of one call is still limited by
+ * MARSHAL_MAX_CMD_SIZE.
+ */
+#define MARSHAL_MAX_BATCH_BUFFER_SIZE (64 * 1024)
+
 /* The number of batch slots in memory.
  *
  * One batch is being executed, one batch is being filled, the rest are
@@ -157,7 +164,33 @@ struct glthread_batch
    unsigned used;
 
    /** Data contained in the command buffer. */
-   uint64_t buffer[MARSHAL_MAX_CMD_BUFFER_SIZE / 8];
+   uint64_t *buffer;
+};
+
+/**
+ * Single-producer single-consumer ring of batches (MESA_GLTHREAD_RING).
+ *
+ * Instead of adding every batch to the util_queue, the worker thread runs
+ * one long-lived job that executes the batches in ring order, and the
+ * application thread only publishes the number of submitted batches. Both
+ * threads spin for a while before they go to sleep, so the mutex and the
+ * wake-up are only needed when one of them runs out of work.
+ */
+struct glthread_ring
+{
+   /**
+    * Twice the number of submitted batches. Bit 0 is set by the worker
+    * thread when it goes to sleep, so that the application thread learns
+    * about it from the same atomic operation that submits a batch.
+    */
+   unsigned head;
+
+   /** How many times to poll before sleeping, 0 if there is a single CPU. */
+   unsigned spin_count;
+
+   bool exit;
+   mtx_t mutex;
+   struct u_cnd_monotonic cond;
 };
 
 struct glthread_client_attrib {
@@ -220,6 +253,13 @@ struct glthread_state
    /** The ring of batches in memory. */
    struct glthread_batch batches[MARSHAL_MAX_BATCHES];
 
+   /** Number of uint64_t elements usable for calls in each batch. */
+   unsigned max_used;
+
+   /** Whether batches are handed over through "ring". */
+   bool use_ring;
+   struct glthread_ring ring;
+
    /** Pointer to the batch currently being filled. */
    struct glthread_batch *next_batch;
 
@@ -298,6 +338,9 @@ struct glthread_state
    struct marshal_cmd_BindBuffer *LastBindBuffer1;
    struct marshal_cmd_BindBuffer *LastBindBuffer2;
 
+   /** The last draw that the next draw can be merged with. */
+   struct marshal_cmd_base *LastDraw;
+
    /** Global mutex update info. */
    unsigned GlobalLockUpdateBatchCounter;
    bool LockGlobalMutexes;
@@ -382,6 +382,83 @@ get_user_buffer_mask(struct gl_context *ctx)
    return vao->BufferEnabled & vao->UserPointerMask & vao->NonNullPointerMask;
 }
 
+/* Whether a draw that doesn't need any uploads can be merged with adjacent
+ * draws. Draws that would generate errors in glthread are never merged.
+ */
+static ALWAYS_INLINE bool
+is_draw_mergeable(struct gl_context *ctx, GLenum mode, GLsizei count,
+                  GLsizei instance_count)
+{
+   return count > 0 && instance_count == 1 &&
+          !ctx->GLThread.inside_begin_end &&
+          !ctx->GLThread.ListMode &&
+          ctx->Dispatch.Current != ctx->Dispatch.ContextLost &&
+          mode < 32 && (1u << mode) & ctx->SupportedPrimMask;
+}
+
+/* Append the draw to the last call if it's a DrawArrays with the same mode.
+ * The first such call is converted to DrawArraysMerged in place.
+ */
+static bool
+merge_draw_arrays(struct gl_context *ctx, GLenum mode, GLint first,
+                  GLsizei count)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+   struct marshal_cmd_base *last = glthread->LastDraw;
+
+   STATIC_ASSERT(sizeof(struct marshal_cmd_DrawArraysMerged) == 8);
+   STATIC_ASSERT(sizeof(struct glthread_merged_draw_arrays) == 8);
+
+   if (!last)
+      return false;
+
+   if (last->cmd_id == DISPATCH_CMD_DrawArraysMerged) {
+      struct marshal_cmd_DrawArraysMerged *cmd =
+         (struct marshal_cmd_DrawArraysMerged *)last;
+
+      if (cmd->mode != mode ||
+          !_mesa_glthread_call_is_last(glthread, last, cmd->num_slots) ||
+          glthread->used + 1 > glthread->max_used)
+         return false;
+
+      cmd->draws[cmd->num_draws].first = first;
+      cmd->draws[cmd->num_draws].count = count;
+      cmd->num_draws++;
+      cmd->num_slots++;
+      glthread->used++;
+      return true;
+   }
+
+   if (last->cmd_id != DISPATCH_CMD_DrawArraysInstanced)
+      return false;
+
+   struct marshal_cmd_DrawArraysInstanced *single =
+      (struct marshal_cmd_DrawArraysInstanced *)last;
+   const unsigned single_slots = align(sizeof(*single), 8) / 8;
+   const unsigned num_slots = 3;
+
+   if (single->mode != mode ||
+       !_mesa_glthread_call_is_last(glthread, last, single_slots) ||
+       glthread->used - single_slots + num_slots > glthread->max_used)
+      return false;
+
+   const GLint first0 = single->first;
+   const GLsizei count0 = single->count;
+   struct marshal_cmd_DrawArraysMerged *cmd =
+      (struct marshal_cmd_DrawArraysMerged *)last;
+
+   cmd->cmd_base.cmd_id = DISPATCH_CMD_DrawArraysMerged;
+   cmd->mode = mode;
+   cmd->num_slots = num_slots;
+   cmd->num_draws = 2;
+   cmd->draws[0].first = first0;
+   cmd->draws[0].count = count0;
+   cmd->draws[1].first = first;
+   cmd->draws[1].count = count;
+   glthread->used += num_slots - single_slots;
+   return true;
+}
+
 static ALWAYS_INLINE void
 draw_arrays(GLuint drawid, GLenum mode, GLint first, GLsizei count,
             GLsizei instance_count, GLuint baseinstance,
@@ -417,6 +494,12 @@ draw_arrays(GLuint drawid, GLenum mode, GLint first, GLsizei count,
          ctx->Dispatch.Current == ctx->Dispatch.ContextLost || /* GL_INVALID_OPERATION */
          ctx->GLThread.ListMode))) {            /* GL_INVALID_OPERATION */
       if (baseinstance == 0 && drawid == 0) {
+         const bool mergeable = !user_buffer_mask &&
+            is_draw_mergeable(ctx, mode, count, instance_count);
+
+         if (mergeable && merge_draw_arrays(ctx, mode, first, count))
+            return;
+
          int cmd_size = sizeof(struct marshal_cmd_DrawArraysInstanced);
          struct marshal_cmd_DrawArraysInstanced *cmd =
             _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_DrawArraysInstanced, cmd_size);
@@ -425,6 +508,7 @@ draw_arrays(GLuint drawid, GLenum mode, GLint first, GLsizei count,
          cmd->first = first;
          cmd->count = count;
          cmd->primcount = instance_count;
+         ctx->GLThread.LastDraw = mergeable ? &cmd->cmd_base : NULL;
       } else {
          int cmd_size = sizeof(struct marshal_cmd_DrawArraysInstancedBaseInstanceDrawID);
          struct marshal_cmd_DrawArraysInstancedBaseInstanceDrawID *cmd =
@@ -724,6 +808,22 @@ _mesa_unmarshal_DrawElementsUserBuf(struct gl_context *ctx,
    return cmd->num_slots;
 }
 
+uint32_t
+_mesa_unmarshal_DrawArraysMerged(struct gl_context *ctx,
+                                 const struct marshal_cmd_DrawArraysMerged *restrict cmd)
+{
+   CALL_DrawArraysMerged(ctx->Dispatch.Current, (cmd));
+   return cmd->num_slots;
+}
+
+uint32_t
+_mesa_unmarshal_DrawElementsMerged(struct gl_context *ctx,
+                                   const struct marshal_cmd_DrawElementsMerged *restrict cmd)
+{
+   CALL_DrawElementsMerged(ctx->Dispatch.Current, (cmd));
+   return cmd->num_slots;
+}
+
 uint32_t
 _mesa_unmarshal_DrawElementsUserBufPacked(struct gl_context *ctx,
                                     const struct marshal_cmd_DrawElementsUserBufPacked *restrict cmd)
@@ -764,6 +864,91 @@ should_convert_to_begin_end(struct gl_context *ctx, unsigned count,
           !(vao->NonZeroDivisorMask & vao->BufferEnabled); /* no instanced attribs */
 }
 
+/* Append the draw to the last call if it's a DrawElements with the same mode
+ * and index type. The first such call is converted to DrawElementsMerged in
+ * place.
+ */
+static bool
+merge_draw_elements(struct gl_context *ctx, GLenum mode, GLsizei count,
+                    GLindextype type, GLuint offset)
+{
+   struct glthread_state *glthread = &ctx->GLThread;
+   struct marshal_cmd_base *last = glthread->LastDraw;
+
+   STATIC_ASSERT(sizeof(struct marshal_cmd_DrawElementsMerged) == 8);
+   STATIC_ASSERT(sizeof(struct glthread_merged_draw_elements) == 8);
+
+   if (!last)
+      return false;
+
+   if (last->cmd_id == DISPATCH_CMD_DrawElementsMerged) {
+      struct marshal_cmd_DrawElementsMerged *cmd =
+         (struct marshal_cmd_DrawElementsMerged *)last;
+
+      if (cmd->mode != mode || cmd->type.value != type.value ||
+          !_mesa_glthread_call_is_last(glthread, last, cmd->num_slots) ||
+          glthread->used + 1 > glthread->max_used)
+         return false;
+
+      cmd->draws[cmd->num_draws].count = count;
+      cmd->draws[cmd->num_draws].offset = offset;
+      cmd->num_draws++;
+      cmd->num_slots++;
+      glthread->used++;
+      return true;
+   }
+
+   GLenum8 mode0;
+   GLindextype type0;
+   GLsizei count0;
+   GLuint offset0;
+   unsigned single_slots;
+
+   if (last->cmd_id == DISPATCH_CMD_DrawElementsPacked) {
+      struct marshal_cmd_DrawElementsPacked *single =
+         (struct marshal_cmd_DrawElementsPacked *)last;
+
+      mode0 = single->mode;
+      type0 = single->type;
+      count0 = single->count;
+      offset0 = single->indices;
+      single_slots = align(sizeof(*single), 8) / 8;
+   } else if (last->cmd_id == DISPATCH_CMD_DrawElements) {
+      struct marshal_cmd_DrawElements *single =
+         (struct marshal_cmd_DrawElements *)last;
+
+      mode0 = single->mode;
+      type0 = single->type;
+      count0 = single->count;
+      offset0 = (uintptr_t)single->indices;
+      single_slots = align(sizeof(*single), 8) / 8;
+   } else {
+      return false;
+   }
+
+   const unsigned num_slots = 3;
+
+   if (mode0 != mode || type0.value != type.value ||
+       !_mesa_glthread_call_is_last(glthread, last, single_slots) ||
+       glthread->used - single_slots + num_slots > glthread->max_used)
+      return false;
+
+   struct marshal_cmd_DrawElementsMerged *cmd =
+      (struct marshal_cmd_DrawElementsMerged *)last;
+
+   cmd->cmd_base.cmd_id = DISPATCH_CMD_DrawElementsMerged;
+   cmd->mode = mode;
+   cmd->type = type;
+   cmd->num_slots = num_slots;
+   cmd->num_draws = 2;
+   cmd->draws[0].count = count0;
+   cmd->draws[0].offset = offset0;
+   cmd->draws[1].count = count;
+   cmd->draws[1].offset = offset;
+   glthread->used += num_slots - single_slots;
+   return true;
+}
+
 static ALWAYS_INLINE void
 draw_elements(GLuint drawid, GLenum mode, GLsizei count, GLenum type,
               const GLvoid *indices, GLsizei instance_count, GLint basevertex,
@@ -821,6 +1006,17 @@ draw_elements(GLuint drawid, GLenum mode, GLsizei count, GLenum type,
          ))) {
       if (drawid == 0 && baseinstance == 0) {
          if (instance_count == 1 && basevertex == 0) {
+            const bool mergeable = !user_buffer_mask && !has_user_indices &&
+               vao->CurrentElementBufferName &&
+               (uintptr_t)indices <= UINT32_MAX &&
+               _mesa_is_index_type_valid(type) &&
+               is_draw_mergeable(ctx, mode, count, instance_count);
+
+            if (mergeable &&
+                merge_draw_elements(ctx, mode, count, encode_index_type(type),
+                                    (uintptr_t)indices))
+               return;
+
             if ((count & 0xffff) == count && (uintptr_t)indices <= UINT16_MAX) {
                /* Packed version of DrawElements: 16-bit count and 16-bit index offset,
                 * reducing the call size by 8 bytes.
@@ -834,6 +1030,7 @@ draw_elements(GLuint drawid, GLenum mode, GLsizei count, GLenum type,
                cmd->type = encode_index_type(type);
                cmd->count = count;
                cmd->indices = (uintptr_t)indices;
+               ctx->GLThread.LastDraw = mergeable ? &cmd->cmd_base : NULL;
             } else {
                int cmd_size = sizeof(struct marshal_cmd_DrawElements);
                struct marshal_cmd_DrawElements *cmd =
@@ -843,6 +1040,7 @@ draw_elements(GLuint drawid, GLenum mode, GLsizei count, GLenum type,
                cmd->type = encode_index_type(type);
                cmd->count = count;
                cmd->indices = indices;
+               ctx->GLThread.LastDraw = mergeable ? &cmd->cmd_base : NULL;
             }
          } else {
             int cmd_size = sizeof(struct marshal_cmd_DrawElementsInstancedBaseVertex);
@@ -1984,6 +2182,18 @@ _mesa_marshal_MultiDrawArraysUserBuf(void)
    unreachable("should never end up here");
 }
 
+void GLAPIENTRY
+_mesa_marshal_DrawArraysMerged(const GLvoid *cmd)
+{
+   unreachable("should never end up here");
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsMerged(const GLvoid *cmd)
+{
+   unreachable("should never end up here");
+}
+
 void GLAPIENTRY
 _mesa_marshal_MultiDrawElementsUserBuf(GLintptr indexBuf, GLenum mode,
                                        const GLsizei *count, GLenum type,
@@ -88,6 +88,43 @@ struct marshal_cmd_DrawElementsUserBufPacked
    struct gl_buffer_object *index_buffer;
 };
 
+/* Consecutive DrawArrays calls that only differ in first and count, merged
+ * into one call on the application thread.
+ */
+struct glthread_merged_draw_arrays
+{
+   GLint first;
+   GLsizei count;
+};
+
+struct marshal_cmd_DrawArraysMerged
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum8 mode;
+   uint16_t num_slots;
+   uint16_t num_draws;
+   struct glthread_merged_draw_arrays draws[];
+};
+
+/* Consecutive DrawElements calls using the bound index buffer that only
+ * differ in count and offset, merged like DrawArrays.
+ */
+struct glthread_merged_draw_elements
+{
+   GLsizei count;
+   GLuint offset;
+};
+
+struct marshal_cmd_DrawElementsMerged
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum8 mode;
+   GLindextype type;
+   uint16_t num_slots;
+   uint16_t num_draws;
+   struct glthread_merged_draw_elements draws[];
+};
+
 static inline void *
 _mesa_glthread_allocate_command(struct gl_context *ctx,
                                 uint16_t cmd_id,
@@ -98,7 +135,7 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
 
    assert (num_elements <= MARSHAL_MAX_CMD_SIZE / 8);
 
-   if (unlikely(glthread->used + num_elements > MARSHAL_MAX_CMD_SIZE / 8))
+   if (unlikely(glthread->used + num_elements > glthread->max_used))
       _mesa_glthread_flush_batch(ctx);
 
    struct glthread_batch *next = glthread->next_batch;
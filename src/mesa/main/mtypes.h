@@ -3024,6 +3024,8 @@ struct vbo_context {
 
    struct vbo_exec_context exec;
    struct vbo_save_context save;
+
+   struct vbo_user_minmax_entry user_minmax_cache[VBO_USER_MINMAX_CACHE_SIZE];
 };
 
 /**
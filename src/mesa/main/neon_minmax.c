@@ -0,0 +1,203 @@
+/*
+ * Copyright © 2024 Mesa contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* NEON counterpart of avx2_minmax.c. NEON is always present on aarch64, so
+ * this is built into libmesa directly and needs no runtime check.
+ */
+
+#include "util/detect_arch.h"
+
+#if DETECT_ARCH_AARCH64
+
+#include "main/neon_minmax.h"
+#include "util/macros.h"
+#include <arm_neon.h>
+#include <stdint.h>
+
+static ALWAYS_INLINE uint8x16_t
+dup(unsigned value, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vdupq_n_u8(value);
+   case 2:  return vreinterpretq_u8_u16(vdupq_n_u16(value));
+   default: return vreinterpretq_u8_u32(vdupq_n_u32(value));
+   }
+}
+
+static ALWAYS_INLINE uint8x16_t
+cmpeq(uint8x16_t a, uint8x16_t b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vceqq_u8(a, b);
+   case 2:  return vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(a),
+                                                  vreinterpretq_u16_u8(b)));
+   default: return vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a),
+                                                  vreinterpretq_u32_u8(b)));
+   }
+}
+
+static ALWAYS_INLINE uint8x16_t
+min_u(uint8x16_t a, uint8x16_t b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vminq_u8(a, b);
+   case 2:  return vreinterpretq_u8_u16(vminq_u16(vreinterpretq_u16_u8(a),
+                                                  vreinterpretq_u16_u8(b)));
+   default: return vreinterpretq_u8_u32(vminq_u32(vreinterpretq_u32_u8(a),
+                                                  vreinterpretq_u32_u8(b)));
+   }
+}
+
+static ALWAYS_INLINE uint8x16_t
+max_u(uint8x16_t a, uint8x16_t b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vmaxq_u8(a, b);
+   case 2:  return vreinterpretq_u8_u16(vmaxq_u16(vreinterpretq_u16_u8(a),
+                                                  vreinterpretq_u16_u8(b)));
+   default: return vreinterpretq_u8_u32(vmaxq_u32(vreinterpretq_u32_u8(a),
+                                                  vreinterpretq_u32_u8(b)));
+   }
+}
+
+static ALWAYS_INLINE unsigned
+reduce_min(uint8x16_t v, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vminvq_u8(v);
+   case 2:  return vminvq_u16(vreinterpretq_u16_u8(v));
+   default: return vminvq_u32(vreinterpretq_u32_u8(v));
+   }
+}
+
+static ALWAYS_INLINE unsigned
+reduce_max(uint8x16_t v, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return vmaxvq_u8(v);
+   case 2:  return vmaxvq_u16(vreinterpretq_u16_u8(v));
+   default: return vmaxvq_u32(vreinterpretq_u32_u8(v));
+   }
+}
+
+static ALWAYS_INLINE unsigned
+load_index(const uint8_t *p, unsigned i, unsigned index_size)
+{
+   switch (index_size) {
+   case 1:  return p[i];
+   case 2:  return ((const uint16_t *)p)[i];
+   default: return ((const uint32_t *)p)[i];
+   }
+}
+
+static ALWAYS_INLINE void
+index_array_min_max(const uint8_t *indices, unsigned index_size,
+                    unsigned count, bool restart, unsigned restart_index,
+                    unsigned *min_index, unsigned *max_index)
+{
+   const unsigned lanes = 16 / index_size;
+   const unsigned type_max = index_size == 4 ? ~0u : (1u << (index_size * 8)) - 1;
+   unsigned min = type_max;
+   unsigned max = 0;
+   unsigned i = 0;
+
+   if (count >= 2 * lanes) {
+      const uint8x16_t restart_vec = dup(restart_index, index_size);
+      uint8x16_t min0 = vdupq_n_u8(0xff), min1 = min0;
+      uint8x16_t max0 = vdupq_n_u8(0), max1 = max0;
+      const unsigned vec_count = count & ~(2 * lanes - 1);
+
+      for (; i < vec_count; i += 2 * lanes) {
+         uint8x16_t v0 = vld1q_u8(indices + i * index_size);
+         uint8x16_t v1 = vld1q_u8(indices + (i + lanes) * index_size);
+         uint8x16_t vmin0 = v0, vmin1 = v1;
+
+         if (restart) {
+            uint8x16_t eq0 = cmpeq(v0, restart_vec, index_size);
+            uint8x16_t eq1 = cmpeq(v1, restart_vec, index_size);
+            vmin0 = vorrq_u8(v0, eq0);
+            vmin1 = vorrq_u8(v1, eq1);
+            v0 = vbicq_u8(v0, eq0);
+            v1 = vbicq_u8(v1, eq1);
+         }
+
+         min0 = min_u(min0, vmin0, index_size);
+         min1 = min_u(min1, vmin1, index_size);
+         max0 = max_u(max0, v0, index_size);
+         max1 = max_u(max1, v1, index_size);
+      }
+
+      min = reduce_min(min_u(min0, min1, index_size), index_size);
+      max = reduce_max(max_u(max0, max1, index_size), index_size);
+   }
+
+   for (; i < count; i++) {
+      unsigned v = load_index(indices, i, index_size);
+
+      if (restart && v == restart_index)
+         continue;
+      min = MIN2(min, v);
+      max = MAX2(max, v);
+   }
+
+   /* Only restart indices: report an empty range like the scalar code. */
+   if (min > max)
+      min = ~0u;
+
+   *min_index = min;
+   *max_index = max;
+}
+
+void
+_mesa_index_array_min_max_neon(const void *indices, unsigned index_size,
+                               unsigned count, bool restart,
+                               unsigned restart_index,
+                               unsigned *min_index, unsigned *max_index)
+{
+   /* A restart index that doesn't fit the index type never matches. */
+   if (index_size < 4 && restart_index >> (index_size * 8))
+      restart = false;
+
+   switch (index_size) {
+   case 1:
+      if (restart)
+         index_array_min_max(indices, 1, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 1, count, false, 0, min_index, max_index);
+      break;
+   case 2:
+      if (restart)
+         index_array_min_max(indices, 2, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 2, count, false, 0, min_index, max_index);
+      break;
+   default:
+      if (restart)
+         index_array_min_max(indices, 4, count, true, restart_index, min_index, max_index);
+      else
+         index_array_min_max(indices, 4, count, false, 0, min_index, max_index);
+      break;
+   }
+}
+
+#endif /* DETECT_ARCH_AARCH64 */
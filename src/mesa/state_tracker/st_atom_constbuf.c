@@ -278,20 +278,15 @@ st_bind_ubos(struct st_context *st, struct gl_program *prog,
 
    for (i = 0; i < prog->sh.NumUniformBlocks; i++) {
       struct gl_buffer_binding *binding;
+      struct pipe_resource *buffer;
 
       binding =
          &st->ctx->UniformBufferBindings[prog->sh.UniformBlocks[i]->Binding];
+      buffer = binding->BufferObject ? binding->BufferObject->buffer : NULL;
 
-      if (binding->BufferObject) {
-         cb.buffer = _mesa_get_bufferobj_reference(st->ctx,
-                                                   binding->BufferObject);
-      } else {
-         cb.buffer = NULL;
-      }
-
-      if (cb.buffer) {
+      if (buffer) {
          cb.buffer_offset = binding->Offset;
-         cb.buffer_size = cb.buffer->width0 - binding->Offset;
+         cb.buffer_size = buffer->width0 - binding->Offset;
 
          /* AutomaticSize is FALSE if the buffer was set with BindBufferRange.
           * Take the minimum just to be sure.
@@ -304,7 +299,23 @@ st_bind_ubos(struct st_context *st, struct gl_program *prog,
          cb.buffer_size = 0;
       }
 
-      pipe->set_constant_buffer(pipe, shader_type, 1 + i, true, &cb);
+      /* Skip slots whose binding didn't change, which is most of them when
+       * the application only rebinds one block between draws.
+       */
+      unsigned slot = 1 + i;
+      if (st->state.ubos[shader_type][slot].buffer == buffer &&
+          st->state.ubos[shader_type][slot].offset == cb.buffer_offset &&
+          st->state.ubos[shader_type][slot].size == cb.buffer_size)
+         continue;
+
+      st->state.ubos[shader_type][slot].buffer = buffer;
+      st->state.ubos[shader_type][slot].offset = cb.buffer_offset;
+      st->state.ubos[shader_type][slot].size = cb.buffer_size;
+
+      cb.buffer = buffer ? _mesa_get_bufferobj_reference(st->ctx,
+                                                         binding->BufferObject)
+                         : NULL;
+      pipe->set_constant_buffer(pipe, shader_type, slot, true, &cb);
    }
 }
 
@@ -300,9 +300,39 @@ update_textures(struct st_context *st,
    unsigned old_num_textures = st->state.num_sampler_views[shader_stage];
    unsigned num_unbind = old_num_textures > num_textures ?
                             old_num_textures - num_textures : 0;
+   struct pipe_sampler_view **bound = st->state.sampler_views[shader_stage];
+   unsigned start = 0, end = num_textures;
 
-   pipe->set_sampler_views(pipe, shader_stage, 0, num_textures, num_unbind,
-                           true, sampler_views);
+   /* Only rebind the slots between the first and the last changed view.
+    * Slots at or above old_num_textures are known to be NULL in bound[].
+    */
+   if (!(st->state.sampler_views_unknown_mask & BITFIELD_BIT(shader_stage))) {
+      while (start < end && sampler_views[start] == bound[start])
+         start++;
+      /* Trailing slots can only be unbound right after the rebound range. */
+      if (!num_unbind) {
+         while (end > start && sampler_views[end - 1] == bound[end - 1])
+            end--;
+      }
+
+      /* Drop the references we won't hand over to the driver. */
+      for (unsigned i = 0; i < start; i++)
+         pipe_sampler_view_reference(&sampler_views[i], NULL);
+      for (unsigned i = end; i < num_textures; i++)
+         pipe_sampler_view_reference(&sampler_views[i], NULL);
+   } else {
+      memset(bound, 0, sizeof(st->state.sampler_views[0]));
+      st->state.sampler_views_unknown_mask &= ~BITFIELD_BIT(shader_stage);
+   }
+
+   if (end > start || num_unbind) {
+      pipe->set_sampler_views(pipe, shader_stage, start, end - start,
+                              num_unbind, true, sampler_views + start);
+   }
+
+   memcpy(bound + start, sampler_views + start,
+          (end - start) * sizeof(bound[0]));
+   memset(bound + num_textures, 0, num_unbind * sizeof(bound[0]));
    st->state.num_sampler_views[shader_stage] = num_textures;
 }
 
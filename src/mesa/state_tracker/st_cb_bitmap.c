@@ -252,6 +252,7 @@ setup_render_state(struct gl_context *ctx,
       pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, num_views, 0,
                               true, sampler_views);
       st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = num_views;
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
    }
 
    /* viewport state: viewport matching window dims */
@@ -280,6 +281,7 @@ restore_render_state(struct gl_context *ctx)
     */
    cso_restore_state(cso, CSO_UNBIND_FS_SAMPLERVIEWS);
    st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = 0;
+   st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
    ctx->Array.NewVertexElements = true;
    ctx->NewDriverState |= ST_NEW_VERTEX_ARRAYS |
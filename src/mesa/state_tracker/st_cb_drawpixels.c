@@ -873,12 +873,14 @@ draw_textured_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
       pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, num_views, 0,
                               true, sampler_views);
       st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = num_views;
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
    } else {
       /* drawing a depth/stencil image */
       pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, num_sampler_view,
                               0, false, sv);
       st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] =
          MAX2(st->state.num_sampler_views[PIPE_SHADER_FRAGMENT], num_sampler_view);
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
       for (unsigned i = 0; i < num_sampler_view; i++)
          pipe_sampler_view_reference(&sv[i], NULL);
@@ -933,6 +935,7 @@ draw_textured_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
     */
    cso_restore_state(cso, CSO_UNBIND_FS_SAMPLERVIEWS);
    st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = 0;
+   st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
    ctx->Array.NewVertexElements = true;
    ctx->NewDriverState |= ST_NEW_VERTEX_ARRAYS |
@@ -1773,6 +1773,7 @@ try_pbo_upload_common(struct gl_context *ctx,
                               false, &sampler_view);
       st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] =
          MAX2(st->state.num_sampler_views[PIPE_SHADER_FRAGMENT], 1);
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
       pipe_sampler_view_reference(&sampler_view, NULL);
    }
@@ -1812,6 +1813,7 @@ fail:
     */
    cso_restore_state(cso, CSO_UNBIND_FS_SAMPLERVIEWS);
    st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = 0;
+   st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
    ctx->Array.NewVertexElements = true;
    ctx->NewDriverState |= ST_NEW_VERTEX_ARRAYS |
@@ -2040,6 +2042,7 @@ try_pbo_download(struct st_context *st,
          goto fail;
 
       pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0, true, &sampler_view);
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
       sampler_view = NULL;
 
       cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
@@ -2102,6 +2105,7 @@ fail:
     */
    cso_restore_state(cso, CSO_UNBIND_FS_SAMPLERVIEWS | CSO_UNBIND_FS_IMAGE0);
    st->state.num_sampler_views[PIPE_SHADER_FRAGMENT] = 0;
+   st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
 
    st->ctx->Array.NewVertexElements = true;
    st->ctx->NewDriverState |= ST_NEW_FS_CONSTANTS |
@@ -227,6 +227,23 @@ struct st_context
       GLuint num_vert_samplers;
       GLuint num_frag_samplers;
       GLuint num_sampler_views[PIPE_SHADER_TYPES];
+      /**
+       * Sampler views last bound by the texture atoms, used to rebind only
+       * the slots that changed. Not referenced: the driver keeps them alive
+       * while they are bound. Stages in sampler_views_unknown_mask had views
+       * bound behind the atoms' back and must be rebound in full.
+       */
+      struct pipe_sampler_view *sampler_views[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
+      unsigned sampler_views_unknown_mask;
+      /**
+       * Uniform buffers last bound by st_bind_ubos, not referenced either.
+       * Nothing else binds constant buffers above slot 0.
+       */
+      struct {
+         struct pipe_resource *buffer;
+         unsigned offset;
+         unsigned size;
+      } ubos[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
       unsigned num_images[PIPE_SHADER_TYPES];
       struct pipe_clip_state clip;
       unsigned constbuf0_enabled_shader_mask;
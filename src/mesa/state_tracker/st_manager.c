@@ -902,8 +902,10 @@ st_context_invalidate_state(struct st_context *st, unsigned flags)
 {
    struct gl_context *ctx = st->ctx;
 
-   if (flags & ST_INVALIDATE_FS_SAMPLER_VIEWS)
+   if (flags & ST_INVALIDATE_FS_SAMPLER_VIEWS) {
       ctx->NewDriverState |= ST_NEW_FS_SAMPLER_VIEWS;
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_FRAGMENT);
+   }
    if (flags & ST_INVALIDATE_FS_CONSTBUF0)
       ctx->NewDriverState |= ST_NEW_FS_CONSTANTS;
    if (flags & ST_INVALIDATE_VS_CONSTBUF0)
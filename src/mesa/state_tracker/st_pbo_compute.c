@@ -1115,6 +1115,7 @@ download_texture_compute(struct st_context *st,
                               &sampler_view);
       st->state.num_sampler_views[PIPE_SHADER_COMPUTE] =
          MAX2(st->state.num_sampler_views[PIPE_SHADER_COMPUTE], 1);
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_COMPUTE);
 
       pipe_sampler_view_reference(&sampler_view, NULL);
 
@@ -1169,6 +1170,7 @@ fail:
                            st->state.num_sampler_views[PIPE_SHADER_COMPUTE],
                            false, NULL);
    st->state.num_sampler_views[PIPE_SHADER_COMPUTE] = 0;
+   st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_COMPUTE);
    pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 1, NULL, 0);
 
    st->ctx->NewDriverState |= ST_NEW_CS_CONSTANTS |
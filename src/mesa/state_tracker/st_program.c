@@ -697,7 +697,13 @@ get_nir_shader(struct st_context *st, struct gl_program *prog, bool is_draw)
       assert(prog->serialized_nir);
       blob_reader_init(&blob_reader, prog->serialized_nir, prog->serialized_nir_size);
    }
-   return nir_deserialize(NULL, options, &blob_reader);
+
+   /* The NIR was serialized by this process or loaded from the disk cache,
+    * which is keyed on the build ID, so it has the current format version.
+    */
+   nir_shader *nir = nir_deserialize(NULL, options, &blob_reader);
+   assert(nir);
+   return nir;
 }
 
 static void
@@ -164,6 +164,7 @@ bind_compute_state(struct st_context *st,
       st->pipe->set_sampler_views(st->pipe, prog->info.stage, 0,
                                   prog->info.num_textures, 0, false,
                                   sampler_views);
+      st->state.sampler_views_unknown_mask |= BITFIELD_BIT(PIPE_SHADER_COMPUTE);
    }
 
    if (prog->affected_states & ST_NEW_CS_SAMPLERS) {
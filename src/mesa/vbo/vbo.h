@@ -178,6 +178,22 @@ struct vbo_save_context {
    bool no_current_update;
 };
 
+#define VBO_USER_MINMAX_CACHE_SIZE 8
+
+/**
+ * Min/max of a recently scanned user index array, see
+ * vbo_get_minmax_index().
+ */
+struct vbo_user_minmax_entry {
+   const void *ptr;
+   uint64_t hash;       /**< XXH64 of the index data */
+   unsigned count;
+   unsigned restart_index;
+   uint8_t index_size;
+   bool restart;
+   unsigned min, max;
+};
+
 GLboolean
 _mesa_using_noop_vtxfmt(const struct _glapi_table *dispatch);
 
@@ -27,15 +27,21 @@
  */
 
 #include "util/glheader.h"
+#include "util/detect_arch.h"
 #include "util/u_cpu_detect.h"
 #include "main/context.h"
 #include "main/varray.h"
 #include "main/macros.h"
+#include "main/neon_minmax.h"
 #include "main/sse_minmax.h"
 #include "util/hash_table.h"
 #include "util/u_memory.h"
+#include "util/xxhash.h"
 #include "pipe/p_state.h"
 
+/* Smaller user arrays are cheaper to scan than to look up. */
+#define VBO_USER_MINMAX_CACHE_MIN_COUNT 256
+
 struct minmax_cache_key {
    GLintptr offset;
    GLuint count;
@@ -228,12 +234,83 @@ out:
 }
 
 
+/**
+ * Whether vbo_get_minmax_index_mapped has a vector kernel for every index
+ * size on this CPU.
+ */
+static bool
+vbo_has_simd_minmax(void)
+{
+#if defined(USE_SSE41)
+   return util_get_cpu_caps()->has_avx2;
+#elif DETECT_ARCH_AARCH64
+   return true;
+#else
+   return false;
+#endif
+}
+
+
+/**
+ * Look up the min/max of a user index array in the per-context cache.
+ *
+ * User arrays can be rewritten by the application at any time, so entries
+ * are matched on a hash of the contents. Hashing is only cheaper than the
+ * scan itself when the scan is scalar, so this is used only when there is
+ * no vector kernel.
+ */
+static void
+vbo_get_minmax_user_cached(struct gl_context *ctx, const void *indices,
+                           unsigned count, unsigned index_size,
+                           bool restart, unsigned restart_index,
+                           GLuint *min_index, GLuint *max_index)
+{
+   struct vbo_context *vbo = &ctx->vbo_context;
+   uint64_t hash = XXH64(indices, (size_t)count * index_size, 0);
+   unsigned slot = (uint32_t)hash % ARRAY_SIZE(vbo->user_minmax_cache);
+   struct vbo_user_minmax_entry *entry = &vbo->user_minmax_cache[slot];
+
+   if (entry->ptr == indices && entry->hash == hash &&
+       entry->count == count && entry->index_size == index_size &&
+       entry->restart == restart &&
+       (!restart || entry->restart_index == restart_index)) {
+      *min_index = entry->min;
+      *max_index = entry->max;
+      return;
+   }
+
+   vbo_get_minmax_index_mapped(count, index_size, restart_index, restart,
+                               indices, min_index, max_index);
+
+   entry->ptr = indices;
+   entry->hash = hash;
+   entry->count = count;
+   entry->index_size = index_size;
+   entry->restart = restart;
+   entry->restart_index = restart_index;
+   entry->min = *min_index;
+   entry->max = *max_index;
+}
+
+
 void
 vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
                             unsigned restartIndex, bool restart,
                             const void *indices,
                             unsigned *min_index, unsigned *max_index)
 {
+#if defined(USE_SSE41)
+   if (util_get_cpu_caps()->has_avx2) {
+      _mesa_index_array_min_max_avx2(indices, index_size, count, restart,
+                                     restartIndex, min_index, max_index);
+      return;
+   }
+#elif DETECT_ARCH_AARCH64
+   _mesa_index_array_min_max_neon(indices, index_size, count, restart,
+                                  restartIndex, min_index, max_index);
+   return;
+#endif
+
    switch (index_size) {
    case 4: {
       const GLuint *ui_indices = (const GLuint *)indices;
@@ -330,6 +407,13 @@ vbo_get_minmax_index(struct gl_context *ctx, struct gl_buffer_object *obj,
 
    if (!obj) {
       indices = (const char *)ptr + offset;
+
+      if (count >= VBO_USER_MINMAX_CACHE_MIN_COUNT && !vbo_has_simd_minmax()) {
+         vbo_get_minmax_user_cached(ctx, indices, count, index_size,
+                                    primitive_restart, restart_index,
+                                    min_index, max_index);
+         return;
+      }
    } else {
       GLsizeiptr size = MIN2((GLsizeiptr)count * index_size, obj->Size);
 
@@ -92,6 +92,30 @@ disk_cache_init_queue(struct disk_cache *cache)
                           UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY, NULL);
 }
 
+/* Parse a size in gigabytes, or in the unit given by a K, M or G suffix. */
+static uint64_t
+parse_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoul(str, &end, 10);
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      return size * 1024;
+   case 'M':
+   case 'm':
+      return size * 1024*1024;
+   case '\0':
+   case 'G':
+   case 'g':
+   default:
+      return size * 1024*1024*1024;
+   }
+}
+
 static struct disk_cache *
 disk_cache_type_create(const char *gpu_name,
                        const char *driver_id,
@@ -175,30 +199,8 @@ disk_cache_type_create(const char *gpu_name,
    }
    #endif
 
-   if (max_size_str) {
-      char *end;
-      max_size = strtoul(max_size_str, &end, 10);
-      if (end == max_size_str) {
-         max_size = 0;
-      } else {
-         switch (*end) {
-         case 'K':
-         case 'k':
-            max_size *= 1024;
-            break;
-         case 'M':
-         case 'm':
-            max_size *= 1024*1024;
-            break;
-         case '\0':
-         case 'G':
-         case 'g':
-         default:
-            max_size *= 1024*1024*1024;
-            break;
-         }
-      }
-   }
+   if (max_size_str)
+      max_size = parse_size(max_size_str);
 
    /* Default to 1GB for maximum cache size. */
    if (max_size == 0) {
@@ -305,6 +307,16 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
                                                    DISK_CACHE_SINGLE_FILE);
    }
 
+   /* Keep recently used items uncompressed in memory, in front of all the
+    * caches above.
+    */
+   const char *mem_size_str = getenv("MESA_SHADER_CACHE_MEM_SIZE");
+   if (mem_size_str && !cache->path_init_failed) {
+      uint64_t mem_size = parse_size(mem_size_str);
+      if (mem_size)
+         cache->mem = disk_cache_mem_create(cache, mem_size);
+   }
+
    return cache;
 }
 
@@ -315,8 +327,20 @@ disk_cache_destroy(struct disk_cache *cache)
       printf("disk shader cache:  hits = %u, misses = %u\n",
              cache->stats.hits,
              cache->stats.misses);
+
+      if (cache->mem) {
+         struct disk_cache_mem_stats mem_stats;
+         disk_cache_mem_get_stats(cache->mem, &mem_stats);
+         printf("disk shader cache memory:  hits = %u, misses = %u, "
+                "evictions = %u, entries = %u, size = %" PRIu64 "\n",
+                mem_stats.hits, mem_stats.misses, mem_stats.evictions,
+                mem_stats.entries, mem_stats.size);
+      }
    }
 
+   if (cache)
+      disk_cache_mem_destroy(cache->mem);
+
    if (cache && util_queue_is_initialized(&cache->cache_queue)) {
       util_queue_finish(&cache->cache_queue);
       util_queue_destroy(&cache->cache_queue);
@@ -345,6 +369,9 @@ disk_cache_wait_for_idle(struct disk_cache *cache)
 void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
+   if (cache->mem)
+      disk_cache_mem_remove(cache->mem, key);
+
    if (cache->type == DISK_CACHE_DATABASE) {
       mesa_cache_db_multipart_entry_remove(&cache->cache_db, key);
       return;
@@ -555,6 +582,9 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    if (!util_queue_is_initialized(&cache->cache_queue))
       return;
 
+   if (cache->mem)
+      disk_cache_mem_put(cache->mem, key, data, size);
+
    struct disk_cache_put_job *dc_job =
       create_put_job(cache, key, (void*)data, size, cache_item_metadata, false);
 
@@ -575,6 +605,9 @@ disk_cache_put_nocopy(struct disk_cache *cache, const cache_key key,
       return;
    }
 
+   if (cache->mem)
+      disk_cache_mem_put(cache->mem, key, data, size);
+
    struct disk_cache_put_job *dc_job =
       create_put_job(cache, key, data, size, cache_item_metadata, true);
 
@@ -589,27 +622,38 @@ void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 {
    void *buf = NULL;
+   size_t buf_size = 0;
 
    if (size)
       *size = 0;
 
+   if (cache->mem) {
+      buf = disk_cache_mem_get(cache->mem, key, &buf_size);
+      if (buf)
+         goto out;
+   }
+
    if (cache->foz_ro_cache)
-      buf = disk_cache_load_item_foz(cache->foz_ro_cache, key, size);
+      buf = disk_cache_load_item_foz(cache->foz_ro_cache, key, &buf_size);
 
    if (!buf) {
       if (cache->blob_get_cb) {
-         buf = blob_get_compressed(cache, key, size);
+         buf = blob_get_compressed(cache, key, &buf_size);
       } else if (cache->type == DISK_CACHE_SINGLE_FILE) {
-         buf = disk_cache_load_item_foz(cache, key, size);
+         buf = disk_cache_load_item_foz(cache, key, &buf_size);
       } else if (cache->type == DISK_CACHE_DATABASE) {
-         buf = disk_cache_db_load_item(cache, key, size);
+         buf = disk_cache_db_load_item(cache, key, &buf_size);
       } else if (cache->type == DISK_CACHE_MULTI_FILE) {
          char *filename = disk_cache_get_cache_filename(cache, key);
          if (filename)
-            buf = disk_cache_load_item(cache, filename, size);
+            buf = disk_cache_load_item(cache, filename, &buf_size);
       }
    }
 
+   if (buf && cache->mem)
+      disk_cache_mem_put(cache->mem, key, buf, buf_size);
+
+out:
    if (unlikely(cache->stats.enabled)) {
       if (buf)
          p_atomic_inc(&cache->stats.hits);
@@ -617,6 +661,9 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
          p_atomic_inc(&cache->stats.misses);
    }
 
+   if (buf && size)
+      *size = buf_size;
+
    return buf;
 }
 
@@ -689,4 +736,14 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    disk_cache_init_queue(cache);
 }
 
+void
+disk_cache_get_mem_stats(struct disk_cache *cache,
+                         struct disk_cache_mem_stats *stats)
+{
+   if (cache->mem)
+      disk_cache_mem_get_stats(cache->mem, stats);
+   else
+      memset(stats, 0, sizeof(*stats));
+}
+
 #endif /* ENABLE_SHADER_CACHE */
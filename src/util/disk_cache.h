@@ -32,6 +32,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/stat.h>
 #include "util/mesa-sha1.h"
 #include "util/detect_os.h"
@@ -79,6 +80,15 @@ struct cache_item_metadata {
 
 struct disk_cache;
 
+/* Statistics of the in-memory cache, see MESA_SHADER_CACHE_MEM_SIZE. */
+struct disk_cache_mem_stats {
+   uint64_t size;
+   uint32_t entries;
+   uint32_t hits;
+   uint32_t misses;
+   uint32_t evictions;
+};
+
 #ifdef HAVE_DLADDR
 static inline bool
 disk_cache_get_function_timestamp(void *ptr, uint32_t* timestamp)
@@ -265,6 +275,14 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Return the statistics of the in-memory cache, or all zeros if it isn't
+ * enabled.
+ */
+void
+disk_cache_get_mem_stats(struct disk_cache *cache,
+                         struct disk_cache_mem_stats *stats);
+
 #else
 
 static inline struct disk_cache *
@@ -327,6 +345,13 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
 {
 }
 
+static inline void
+disk_cache_get_mem_stats(struct disk_cache *cache,
+                         struct disk_cache_mem_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
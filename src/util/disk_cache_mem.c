@@ -0,0 +1,211 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "disk_cache_mem.h"
+#include "hash_table.h"
+#include "ralloc.h"
+
+struct disk_cache_mem_entry {
+   struct list_head link;
+   cache_key key;
+   size_t size;
+   uint8_t data[];
+};
+
+static size_t
+entry_size(size_t data_size)
+{
+   return sizeof(struct disk_cache_mem_entry) + data_size;
+}
+
+/* The keys are SHA-1 hashes, so any of their bytes are as good as a hash.
+ * The first byte selects the shard, use the following ones for the table.
+ */
+static struct disk_cache_mem_shard *
+get_shard(struct disk_cache_mem *mem, const cache_key key)
+{
+   return &mem->shards[key[0] % DISK_CACHE_MEM_SHARDS];
+}
+
+static uint32_t
+key_hash(const void *key)
+{
+   uint32_t hash;
+   memcpy(&hash, (const uint8_t *)key + 1, sizeof(hash));
+   return hash;
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static void
+remove_entry(struct disk_cache_mem_shard *shard, struct hash_entry *he)
+{
+   struct disk_cache_mem_entry *entry = he->data;
+
+   _mesa_hash_table_remove(shard->entries, he);
+   list_del(&entry->link);
+   shard->size -= entry_size(entry->size);
+   free(entry);
+}
+
+struct disk_cache_mem *
+disk_cache_mem_create(void *mem_ctx, uint64_t max_size)
+{
+   struct disk_cache_mem *mem = rzalloc(mem_ctx, struct disk_cache_mem);
+   if (!mem)
+      return NULL;
+
+   mem->shard_max_size = max_size / DISK_CACHE_MEM_SHARDS;
+
+   for (unsigned i = 0; i < DISK_CACHE_MEM_SHARDS; i++) {
+      struct disk_cache_mem_shard *shard = &mem->shards[i];
+
+      simple_mtx_init(&shard->mtx, mtx_plain);
+      list_inithead(&shard->lru);
+      shard->entries = _mesa_hash_table_create(mem, key_hash, key_equal);
+      if (!shard->entries) {
+         disk_cache_mem_destroy(mem);
+         return NULL;
+      }
+   }
+
+   return mem;
+}
+
+void
+disk_cache_mem_destroy(struct disk_cache_mem *mem)
+{
+   if (!mem)
+      return;
+
+   for (unsigned i = 0; i < DISK_CACHE_MEM_SHARDS; i++) {
+      struct disk_cache_mem_shard *shard = &mem->shards[i];
+
+      list_for_each_entry_safe(struct disk_cache_mem_entry, entry,
+                               &shard->lru, link)
+         free(entry);
+
+      simple_mtx_destroy(&shard->mtx);
+   }
+
+   ralloc_free(mem);
+}
+
+/* Return a malloc'ed copy of the item, like disk_cache_get(). */
+void *
+disk_cache_mem_get(struct disk_cache_mem *mem, const cache_key key,
+                   size_t *size)
+{
+   struct disk_cache_mem_shard *shard = get_shard(mem, key);
+   void *data = NULL;
+
+   simple_mtx_lock(&shard->mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(shard->entries, key);
+   if (he) {
+      struct disk_cache_mem_entry *entry = he->data;
+
+      data = malloc(entry->size);
+      if (data) {
+         memcpy(data, entry->data, entry->size);
+         *size = entry->size;
+         list_move_to(&entry->link, &shard->lru);
+      }
+   }
+
+   if (data)
+      shard->hits++;
+   else
+      shard->misses++;
+
+   simple_mtx_unlock(&shard->mtx);
+
+   return data;
+}
+
+void
+disk_cache_mem_put(struct disk_cache_mem *mem, const cache_key key,
+                   const void *data, size_t size)
+{
+   struct disk_cache_mem_shard *shard = get_shard(mem, key);
+
+   if (entry_size(size) > mem->shard_max_size)
+      return;
+
+   /* Copy outside of the lock, items are immutable so a racing put of the
+    * same key is just wasted work.
+    */
+   struct disk_cache_mem_entry *entry = malloc(entry_size(size));
+   if (!entry)
+      return;
+
+   memcpy(entry->key, key, CACHE_KEY_SIZE);
+   entry->size = size;
+   memcpy(entry->data, data, size);
+
+   simple_mtx_lock(&shard->mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(shard->entries, key);
+   if (he) {
+      list_move_to(&((struct disk_cache_mem_entry *)he->data)->link,
+                   &shard->lru);
+      simple_mtx_unlock(&shard->mtx);
+      free(entry);
+      return;
+   }
+
+   while (shard->size + entry_size(size) > mem->shard_max_size) {
+      struct disk_cache_mem_entry *lru =
+         list_last_entry(&shard->lru, struct disk_cache_mem_entry, link);
+
+      remove_entry(shard, _mesa_hash_table_search(shard->entries, lru->key));
+      shard->evictions++;
+   }
+
+   _mesa_hash_table_insert(shard->entries, entry->key, entry);
+   list_add(&entry->link, &shard->lru);
+   shard->size += entry_size(size);
+
+   simple_mtx_unlock(&shard->mtx);
+}
+
+void
+disk_cache_mem_remove(struct disk_cache_mem *mem, const cache_key key)
+{
+   struct disk_cache_mem_shard *shard = get_shard(mem, key);
+
+   simple_mtx_lock(&shard->mtx);
+
+   struct hash_entry *he = _mesa_hash_table_search(shard->entries, key);
+   if (he)
+      remove_entry(shard, he);
+
+   simple_mtx_unlock(&shard->mtx);
+}
+
+void
+disk_cache_mem_get_stats(struct disk_cache_mem *mem,
+                         struct disk_cache_mem_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   for (unsigned i = 0; i < DISK_CACHE_MEM_SHARDS; i++) {
+      struct disk_cache_mem_shard *shard = &mem->shards[i];
+
+      simple_mtx_lock(&shard->mtx);
+      stats->size += shard->size;
+      stats->entries += shard->entries->entries;
+      stats->hits += shard->hits;
+      stats->misses += shard->misses;
+      stats->evictions += shard->evictions;
+      simple_mtx_unlock(&shard->mtx);
+   }
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef DISK_CACHE_MEM_H
+#define DISK_CACHE_MEM_H
+
+#include "disk_cache.h"
+#include "list.h"
+#include "simple_mtx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of independently locked parts of the in-memory cache. */
+#define DISK_CACHE_MEM_SHARDS 16
+
+struct disk_cache_mem_shard {
+   simple_mtx_t mtx;
+
+   /* cache_key -> struct disk_cache_mem_entry */
+   struct hash_table *entries;
+
+   /* Entries, most recently used first */
+   struct list_head lru;
+   size_t size;
+
+   uint32_t hits;
+   uint32_t misses;
+   uint32_t evictions;
+};
+
+/* Bounded LRU cache of uncompressed cache items, in front of the on-disk
+ * cache.  Each shard covers a fixed subset of the keys and gets an equal
+ * share of the size limit.
+ */
+struct disk_cache_mem {
+   size_t shard_max_size;
+   struct disk_cache_mem_shard shards[DISK_CACHE_MEM_SHARDS];
+};
+
+struct disk_cache_mem *
+disk_cache_mem_create(void *mem_ctx, uint64_t max_size);
+
+void
+disk_cache_mem_destroy(struct disk_cache_mem *mem);
+
+void *
+disk_cache_mem_get(struct disk_cache_mem *mem, const cache_key key,
+                   size_t *size);
+
+void
+disk_cache_mem_put(struct disk_cache_mem *mem, const cache_key key,
+                   const void *data, size_t size);
+
+void
+disk_cache_mem_remove(struct disk_cache_mem *mem, const cache_key key);
+
+void
+disk_cache_mem_get_stats(struct disk_cache_mem *mem,
+                         struct disk_cache_mem_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_MEM_H */
@@ -1019,13 +1019,16 @@ disk_cache_load_item_foz(struct disk_cache *cache, const cache_key key,
                          size_t *size)
 {
    size_t cache_tem_size = 0;
-   void *cache_item = foz_read_entry(&cache->foz_db, key, &cache_tem_size);
+   bool mapped;
+   void *cache_item = foz_read_entry_mapped(&cache->foz_db, key,
+                                            &cache_tem_size, &mapped);
    if (!cache_item)
       return NULL;
 
    uint8_t *uncompressed_data =
        parse_and_validate_cache_item(cache, cache_item, cache_tem_size, size);
-   free(cache_item);
+   if (!mapped)
+      free(cache_item);
 
    return uncompressed_data;
 }
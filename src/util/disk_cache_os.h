@@ -32,6 +32,7 @@
 
 #else
 
+#include "util/disk_cache_mem.h"
 #include "util/fossilize_db.h"
 #include "util/mesa_cache_db.h"
 #include "util/mesa_cache_db_multipart.h"
@@ -104,6 +105,9 @@ struct disk_cache {
 
    /* Internal RO FOZ cache for combined use of RO and RW caches. */
    struct disk_cache *foz_ro_cache;
+
+   /* In-memory cache in front of the other ones, if enabled. */
+   struct disk_cache_mem *mem;
 };
 
 struct cache_entry_file_data {
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -186,6 +187,31 @@ update_foz_index(struct foz_db *foz_db, FILE *db_idx, unsigned file_idx)
    fseek(db_idx, parsed_offset, SEEK_SET);
 }
 
+/* Map a db file for reading, or remap it if it grew.  The writable db is
+ * only appended to, so the data already mapped never changes, but remapping
+ * it invalidates the old mapping and must be done with the mutex held.
+ */
+static void
+map_foz_db(struct foz_db *foz_db, uint8_t file_idx)
+{
+   struct stat st;
+
+   if (fstat(fileno(foz_db->file[file_idx]), &st) == -1 || st.st_size == 0 ||
+       (uint64_t)st.st_size == foz_db->map_size[file_idx])
+      return;
+
+   void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED,
+                    fileno(foz_db->file[file_idx]), 0);
+   if (map == MAP_FAILED)
+      return;
+
+   if (foz_db->map[file_idx])
+      munmap(foz_db->map[file_idx], foz_db->map_size[file_idx]);
+
+   foz_db->map[file_idx] = map;
+   foz_db->map_size[file_idx] = st.st_size;
+}
+
 /* exclusive flock with timeout. timeout is in nanoseconds */
 static int lock_file_with_timeout(FILE *f, int64_t timeout)
 {
@@ -259,6 +285,12 @@ load_foz_dbs(struct foz_db *foz_db, FILE *db_idx, uint8_t file_idx,
 
    flock(fileno(foz_db->file[file_idx]), LOCK_UN);
 
+   /* Read-only dbs never change, so their mapping can be handed out by
+    * foz_read_entry_mapped().  The writable db is mapped on first read.
+    */
+   if (read_only)
+      map_foz_db(foz_db, file_idx);
+
    if (foz_db->updater.thrd) {
    /* If MESA_DISK_CACHE_READ_ONLY_FOZ_DBS_DYNAMIC_LIST is enabled, access to
     * the foz_db hash table requires locking to prevent racing between this
@@ -563,6 +595,8 @@ foz_destroy(struct foz_db *foz_db)
    if (foz_db->db_idx)
       fclose(foz_db->db_idx);
    for (unsigned i = 0; i < FOZ_MAX_DBS; i++) {
+      if (foz_db->map[i])
+         munmap(foz_db->map[i], foz_db->map_size[i]);
       if (foz_db->file[i])
          fclose(foz_db->file[i]);
    }
@@ -577,21 +611,28 @@ foz_destroy(struct foz_db *foz_db)
    memset(foz_db, 0, sizeof(*foz_db));
 }
 
-/* Here we lookup a cache entry in the index hash table. If an entry is found
- * we use the retrieved offset to read the cache entry from disk.
+/* Lookups only need to be serialized while the index can change, i.e. with
+ * a writable db or a dynamic list of read-only dbs.  Otherwise the index is
+ * immutable once foz_prepare() is done.
  */
-void *
-foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
-               size_t *size)
+static bool
+foz_lock_index(struct foz_db *foz_db)
 {
-   uint64_t hash = truncate_hash_to_64bits(cache_key_160bit);
+   const bool locked = foz_db->db_idx || foz_db->updater.thrd;
 
-   void *data = NULL;
+   if (locked)
+      simple_mtx_lock(&foz_db->mtx);
 
-   if (!foz_db->alive)
-      return NULL;
+   return locked;
+}
 
-   simple_mtx_lock(&foz_db->mtx);
+/* Look up a cache entry in the index hash table and return its location.
+ */
+static bool
+foz_lookup_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+                 uint8_t *file_idx, uint64_t *offset)
+{
+   uint64_t hash = truncate_hash_to_64bits(cache_key_160bit);
 
    struct foz_db_entry *entry =
       _mesa_hash_table_u64_search(foz_db->index_db, hash);
@@ -599,41 +640,73 @@ foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
       update_foz_index(foz_db, foz_db->db_idx, 0);
       entry = _mesa_hash_table_u64_search(foz_db->index_db, hash);
    }
-   if (!entry) {
-      simple_mtx_unlock(&foz_db->mtx);
-      return NULL;
-   }
-
-   uint8_t file_idx = entry->file_idx;
-   if (fseek(foz_db->file[file_idx], entry->offset, SEEK_SET) < 0)
-      goto fail;
-
-   uint32_t header_size = sizeof(struct foz_payload_header);
-   if (fread(&entry->header, 1, header_size, foz_db->file[file_idx]) !=
-       header_size)
-      goto fail;
 
    /* Check for collision using full 160bit hash for increased assurance
     * against potential collisions.
     */
-   for (int i = 0; i < 20; i++) {
-      if (cache_key_160bit[i] != entry->key[i])
-         goto fail;
-   }
+   if (!entry || memcmp(cache_key_160bit, entry->key, sizeof(entry->key)))
+      return false;
+
+   *file_idx = entry->file_idx;
+   *offset = entry->offset;
+   return true;
+}
+
+/* Return a pointer to the payload of an entry in a mapped db, or NULL if the
+ * entry isn't mapped or is corrupt.
+ */
+static const void *
+foz_entry_view(struct foz_db *foz_db, uint8_t file_idx, uint64_t offset,
+               size_t *size)
+{
+   const uint8_t *map = foz_db->map[file_idx];
+   const uint64_t map_size = foz_db->map_size[file_idx];
+   struct foz_payload_header header;
+
+   if (!map || offset > map_size || map_size - offset < sizeof(header))
+      return NULL;
+
+   memcpy(&header, map + offset, sizeof(header));
+   offset += sizeof(header);
+
+   if (map_size - offset < header.payload_size)
+      return NULL;
+
+   if (header.crc != 0 &&
+       util_hash_crc32(map + offset, header.payload_size) != header.crc)
+      return NULL;
+
+   *size = header.payload_size;
+   return map + offset;
+}
+
+/* Read and check the payload of an entry with pread(), for dbs that
+ * couldn't be mapped.  This doesn't use the file offset, so it is fine
+ * without the mutex.
+ */
+static void *
+foz_read_payload(struct foz_db *foz_db, uint8_t file_idx, uint64_t offset,
+                 size_t *size)
+{
+   int fd = fileno(foz_db->file[file_idx]);
+   struct foz_payload_header header;
+   if (pread(fd, &header, sizeof(header), offset) != sizeof(header))
+      return NULL;
+
+   uint32_t data_sz = header.payload_size;
+   void *data = malloc(data_sz);
+   if (!data)
+      return NULL;
 
-   uint32_t data_sz = entry->header.payload_size;
-   data = malloc(data_sz);
-   if (fread(data, 1, data_sz, foz_db->file[file_idx]) != data_sz)
+   if (pread(fd, data, data_sz, offset + sizeof(header)) != (ssize_t)data_sz)
       goto fail;
 
    /* verify checksum */
-   if (entry->header.crc != 0) {
-      if (util_hash_crc32(data, data_sz) != entry->header.crc)
+   if (header.crc != 0) {
+      if (util_hash_crc32(data, data_sz) != header.crc)
          goto fail;
    }
 
-   simple_mtx_unlock(&foz_db->mtx);
-
    if (size)
       *size = data_sz;
 
@@ -641,11 +714,106 @@ foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
 
 fail:
    free(data);
+   return NULL;
+}
 
-   /* reading db entry failed. reset the file offset */
-   simple_mtx_unlock(&foz_db->mtx);
+/* Whether an entry lives in the writable db, whose mapping may be replaced
+ * by another reader as the file grows.
+ */
+static bool
+foz_entry_is_writable(struct foz_db *foz_db, uint8_t file_idx)
+{
+   return foz_db->db_idx && file_idx == 0;
+}
 
-   return NULL;
+/* Look up an entry and return a copy of its payload, or with view_only set,
+ * a pointer to it in the mapping of a read only db.  *mapped tells which
+ * one was returned.
+ */
+static void *
+foz_read_entry_locked(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+                      size_t *size, bool view_only, bool *mapped)
+{
+   uint8_t file_idx;
+   uint64_t offset;
+   size_t data_sz;
+
+   *mapped = false;
+
+   if (!foz_lookup_entry(foz_db, cache_key_160bit, &file_idx, &offset))
+      return NULL;
+
+   const void *view = foz_entry_view(foz_db, file_idx, offset, &data_sz);
+   if (!view && foz_entry_is_writable(foz_db, file_idx)) {
+      /* The entry was written after the file was last mapped */
+      map_foz_db(foz_db, file_idx);
+      view = foz_entry_view(foz_db, file_idx, offset, &data_sz);
+   }
+
+   if (!view) {
+      if (foz_db->map[file_idx])
+         return NULL;
+      return foz_read_payload(foz_db, file_idx, offset, size);
+   }
+
+   if (size)
+      *size = data_sz;
+
+   if (view_only && !foz_entry_is_writable(foz_db, file_idx)) {
+      *mapped = true;
+      return (void *)view;
+   }
+
+   void *data = malloc(data_sz);
+   if (data)
+      memcpy(data, view, data_sz);
+
+   return data;
+}
+
+/* Here we lookup a cache entry in the index hash table. If an entry is found
+ * we copy it from the mapping of its db file, or read it from disk if the
+ * file couldn't be mapped.
+ */
+void *
+foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+               size_t *size)
+{
+   bool mapped;
+
+   if (!foz_db->alive)
+      return NULL;
+
+   const bool locked = foz_lock_index(foz_db);
+   void *data = foz_read_entry_locked(foz_db, cache_key_160bit, size, false,
+                                      &mapped);
+   if (locked)
+      simple_mtx_unlock(&foz_db->mtx);
+
+   return data;
+}
+
+/* Like foz_read_entry(), but entries of the read only dbs are returned as
+ * a pointer into their mapping instead of a copy.  *mapped is set when that
+ * is the case; the data must not be freed then and stays valid until
+ * foz_destroy().
+ */
+void *
+foz_read_entry_mapped(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+                      size_t *size, bool *mapped)
+{
+   *mapped = false;
+
+   if (!foz_db->alive)
+      return NULL;
+
+   const bool locked = foz_lock_index(foz_db);
+   void *data = foz_read_entry_locked(foz_db, cache_key_160bit, size, true,
+                                      mapped);
+   if (locked)
+      simple_mtx_unlock(&foz_db->mtx);
+
+   return data;
 }
 
 /* Here we write the cache entry to disk and store its offset in the index db.
@@ -776,6 +944,14 @@ foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
    return false;
 }
 
+void *
+foz_read_entry_mapped(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+                      size_t *size, bool *mapped)
+{
+   *mapped = false;
+   return NULL;
+}
+
 bool
 foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
                 const void *blob, size_t size)
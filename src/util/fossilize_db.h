@@ -85,6 +85,8 @@ struct foz_dbs_list_updater {
 
 struct foz_db {
    FILE *file[FOZ_MAX_DBS];          /* An array of all foz dbs */
+   void *map[FOZ_MAX_DBS];           /* Read only mappings of the foz dbs */
+   size_t map_size[FOZ_MAX_DBS];
    FILE *db_idx;                     /* The default writable foz db idx */
    simple_mtx_t mtx;                 /* Mutex for file/hash table read/writes */
    simple_mtx_t flock_mtx;           /* Mutex for flocking the file for writes */
@@ -105,6 +107,10 @@ void *
 foz_read_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
                size_t *size);
 
+void *
+foz_read_entry_mapped(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
+                      size_t *size, bool *mapped);
+
 bool
 foz_write_entry(struct foz_db *foz_db, const uint8_t *cache_key_160bit,
                 const void *blob, size_t size);
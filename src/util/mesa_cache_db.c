@@ -16,6 +16,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "crc32.h"
@@ -739,6 +741,9 @@ mesa_db_wipe_path(const char *cache_path)
 void
 mesa_cache_db_close(struct mesa_cache_db *db)
 {
+   if (db->cache_map)
+      munmap(db->cache_map, db->cache_map_size);
+
    _mesa_hash_table_u64_destroy(db->index_db);
    simple_mtx_destroy(&db->flock_mtx);
    ralloc_free(db->mem_ctx);
@@ -760,6 +765,39 @@ mesa_cache_db_file_entry_size(void)
    return sizeof(struct mesa_cache_db_file_entry);
 }
 
+/* Map the cache file, so that entries can be read without going through
+ * stdio.  The mapping is only accessed while the db is locked, when no other
+ * process may truncate the file, and never beyond the current file size.
+ */
+static const uint8_t *
+mesa_db_map_cache(struct mesa_cache_db *db, uint64_t end)
+{
+   int fd = fileno(db->cache.file);
+   struct stat st;
+
+   if (fstat(fd, &st) < 0 || (uint64_t)st.st_size < end)
+      return NULL;
+
+   /* The file may have grown, or have been replaced by another process */
+   if (db->cache_map &&
+       (db->cache_map_size < end || db->cache_map_ino != st.st_ino)) {
+      munmap(db->cache_map, db->cache_map_size);
+      db->cache_map = NULL;
+   }
+
+   if (!db->cache_map) {
+      void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (map == MAP_FAILED)
+         return NULL;
+
+      db->cache_map = map;
+      db->cache_map_size = st.st_size;
+      db->cache_map_ino = st.st_ino;
+   }
+
+   return db->cache_map;
+}
+
 void *
 mesa_cache_db_read_entry(struct mesa_cache_db *db,
                          const uint8_t *cache_key_160bit,
@@ -787,10 +825,20 @@ mesa_cache_db_read_entry(struct mesa_cache_db *db,
    if (!hash_entry)
       goto fail;
 
-   if (!mesa_db_seek(db->cache.file, hash_entry->cache_db_file_offset) ||
-       !mesa_db_read(db->cache.file, &cache_entry) ||
-       !mesa_db_cache_entry_valid(&cache_entry))
+   const uint64_t offset = hash_entry->cache_db_file_offset;
+   const uint8_t *map =
+      mesa_db_map_cache(db, offset + blob_file_size(hash_entry->size));
+
+   if (map) {
+      memcpy(&cache_entry, map + offset, sizeof(cache_entry));
+      if (!mesa_db_cache_entry_valid(&cache_entry) ||
+          cache_entry.size != hash_entry->size)
+         goto fail_fatal;
+   } else if (!mesa_db_seek(db->cache.file, offset) ||
+              !mesa_db_read(db->cache.file, &cache_entry) ||
+              !mesa_db_cache_entry_valid(&cache_entry)) {
       goto fail_fatal;
+   }
 
    if (memcmp(cache_entry.key, cache_key_160bit, sizeof(cache_entry.key)))
       goto fail;
@@ -799,8 +847,12 @@ mesa_cache_db_read_entry(struct mesa_cache_db *db,
    if (!data)
       goto fail;
 
-   if (!mesa_db_read_data(db->cache.file, data, cache_entry.size) ||
-       util_hash_crc32(data, cache_entry.size) != cache_entry.crc)
+   if (map)
+      memcpy(data, map + offset + sizeof(cache_entry), cache_entry.size);
+   else if (!mesa_db_read_data(db->cache.file, data, cache_entry.size))
+      goto fail_fatal;
+
+   if (util_hash_crc32(data, cache_entry.size) != cache_entry.crc)
       goto fail_fatal;
 
    if (!mesa_db_seek(db->index.file, hash_entry->index_db_file_offset) ||
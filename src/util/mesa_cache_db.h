@@ -37,6 +37,11 @@ struct mesa_cache_db {
    void *mem_ctx;
    uint64_t uuid;
    bool alive;
+
+   /* Read-only mapping of the cache file, only used with the lock held */
+   void *cache_map;
+   size_t cache_map_size;
+   uint64_t cache_map_ino;
 };
 
 #if DETECT_OS_WINDOWS == 0
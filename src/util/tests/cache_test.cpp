@@ -723,6 +723,88 @@ test_put_big_sized_entry_to_empty_cache(const char *driver_id)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_mem_cache(const char *driver_id)
+{
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   static uint8_t big_blob[600];
+   struct disk_cache_mem_stats stats;
+   char *result;
+   size_t size;
+
+#ifdef SHADER_CACHE_DISABLE_BY_DEFAULT
+   setenv("MESA_SHADER_CACHE_DISABLE", "false", 1);
+#endif /* SHADER_CACHE_DISABLE_BY_DEFAULT */
+
+   /* Disabled by default. */
+   struct disk_cache *cache = disk_cache_create("test", driver_id, 0);
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_wait_for_idle(cache);
+   free(disk_cache_get(cache, blob_key, &size));
+
+   disk_cache_get_mem_stats(cache, &stats);
+   EXPECT_EQ(stats.hits + stats.misses + stats.entries, 0)
+      << "in-memory cache disabled by default";
+
+   disk_cache_destroy(cache);
+
+   /* 16K in total makes for 1K per shard. */
+   setenv("MESA_SHADER_CACHE_MEM_SIZE", "16K", 1);
+
+   /* Items already on disk are loaded into memory on the first get. */
+   cache = disk_cache_create("test", driver_id, 0);
+
+   result = (char *) disk_cache_get(cache, blob_key, &size);
+   EXPECT_STREQ(result, blob) << "disk_cache_get from disk (pointer)";
+   EXPECT_EQ(size, sizeof(blob)) << "disk_cache_get from disk (size)";
+   free(result);
+
+   result = (char *) disk_cache_get(cache, blob_key, &size);
+   EXPECT_STREQ(result, blob) << "disk_cache_get from memory (pointer)";
+   EXPECT_EQ(size, sizeof(blob)) << "disk_cache_get from memory (size)";
+   free(result);
+
+   disk_cache_get_mem_stats(cache, &stats);
+   EXPECT_EQ(stats.misses, 1) << "first get misses the in-memory cache";
+   EXPECT_EQ(stats.hits, 1) << "second get hits the in-memory cache";
+   EXPECT_EQ(stats.entries, 1) << "in-memory cache entries";
+
+   /* Removed items are gone from memory too. */
+   disk_cache_remove(cache, blob_key);
+   result = (char *) disk_cache_get(cache, blob_key, &size);
+   EXPECT_EQ(result, nullptr) << "disk_cache_get of removed item";
+
+   /* Items put are available from memory right away, and the least
+    * recently used ones are evicted to stay within the limit.
+    */
+   for (unsigned i = 0; i < 64; i++) {
+      cache_key key;
+
+      memset(big_blob, i, sizeof(big_blob));
+      disk_cache_compute_key(cache, big_blob, sizeof(big_blob), key);
+      disk_cache_put(cache, key, big_blob, sizeof(big_blob), NULL);
+
+      result = (char *) disk_cache_get(cache, key, &size);
+      EXPECT_NE(result, nullptr) << "disk_cache_get of item just put";
+      EXPECT_EQ(size, sizeof(big_blob)) << "disk_cache_get of item just put";
+      free(result);
+   }
+
+   disk_cache_get_mem_stats(cache, &stats);
+   EXPECT_EQ(stats.hits, 1 + 64) << "gets of items just put hit";
+   EXPECT_GT(stats.evictions, 0) << "in-memory cache evictions";
+   EXPECT_LE(stats.size, 16 * 1024) << "in-memory cache size limit";
+   EXPECT_EQ(stats.entries + stats.evictions, 64)
+      << "in-memory cache entries";
+
+   disk_cache_wait_for_idle(cache);
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_SHADER_CACHE_MEM_SIZE");
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 class Cache : public ::testing::Test {
@@ -852,6 +934,26 @@ TEST_F(Cache, Database)
 #endif
 }
 
+TEST_F(Cache, Memory)
+{
+   const char *driver_id = "make_check";
+
+#ifndef ENABLE_SHADER_CACHE
+   GTEST_SKIP() << "ENABLE_SHADER_CACHE not defined.";
+#else
+   setenv("MESA_DISK_CACHE_MULTI_FILE", "true", 1);
+
+   test_disk_cache_create(mem_ctx, CACHE_DIR_NAME, driver_id);
+
+   test_mem_cache(driver_id);
+
+   unsetenv("MESA_DISK_CACHE_MULTI_FILE");
+
+   int err = rmrf_local(CACHE_TEST_TMP);
+   EXPECT_EQ(err, 0) << "Removing " CACHE_TEST_TMP " again";
+#endif
+}
+
 TEST_F(Cache, Combined)
 {
    const char *driver_id = "make_check";
@@ -89,3 +89,25 @@ util_thread_sched_apply_policy(thrd_t thread, enum util_thread_name name,
    return false;
 #endif
 }
+
+/**
+ * Pin worker thread "index" out of "num_threads" to a NUMA node.
+ *
+ * The threads are spread over the nodes in contiguous blocks, so that
+ * threads with neighbouring indices share a node.  This does nothing on
+ * systems with a single node.
+ */
+bool
+util_thread_sched_pin_to_numa_node(thrd_t thread, unsigned index,
+                                   unsigned num_threads)
+{
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   if (caps->num_numa_nodes < 2 || index >= num_threads)
+      return false;
+
+   unsigned node = index * caps->num_numa_nodes / num_threads;
+
+   return util_set_thread_affinity(thread, caps->numa_affinity_mask[node],
+                                   NULL, caps->num_cpu_mask_bits);
+}
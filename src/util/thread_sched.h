@@ -28,4 +28,8 @@ bool
 util_thread_sched_apply_policy(thrd_t thread, enum util_thread_name name,
                                unsigned app_thread_cpu, unsigned *sched_state);
 
+bool
+util_thread_sched_pin_to_numa_node(thrd_t thread, unsigned index,
+                                   unsigned num_threads);
+
 #endif
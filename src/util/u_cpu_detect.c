@@ -496,6 +496,87 @@ check_os_loongarch64_support(void)
 #endif /* DETECT_ARCH_LOONGARCH64 */
 
 
+#if DETECT_OS_LINUX
+/**
+ * Parse a sysfs list such as "0-15,32-47" into a bitmask.
+ * Returns the number of bits set.
+ */
+static unsigned
+parse_sysfs_list(const char *list, uint32_t *mask, unsigned num_bits)
+{
+   unsigned count = 0;
+   const char *p = list;
+
+   while (*p >= '0' && *p <= '9') {
+      char *end;
+      unsigned first = strtoul(p, &end, 10);
+      unsigned last = first;
+
+      if (*end == '-')
+         last = strtoul(end + 1, &end, 10);
+
+      for (unsigned i = first; i <= last && i < num_bits; i++) {
+         mask[i / 32] |= 1u << (i % 32);
+         count++;
+      }
+
+      p = *end == ',' ? end + 1 : end;
+   }
+
+   return count;
+}
+
+
+static void
+get_numa_topology(void)
+{
+   uint32_t nodes[UTIL_MAX_CPUS / 32] = {0};
+   util_affinity_mask *masks = NULL;
+   unsigned num_nodes = 0;
+   size_t size = 0;
+
+   char *online = os_read_file("/sys/devices/system/node/online", &size);
+   if (!online)
+      return;
+
+   parse_sysfs_list(online, nodes, UTIL_MAX_CPUS);
+   free(online);
+
+   for (unsigned n = 0; n < UTIL_MAX_CPUS; n++) {
+      if (!(nodes[n / 32] & (1u << (n % 32))))
+         continue;
+
+      char name[PATH_MAX];
+      snprintf(name, sizeof(name), "/sys/devices/system/node/node%u/cpulist", n);
+      char *cpulist = os_read_file(name, &size);
+      if (!cpulist)
+         continue;
+
+      util_affinity_mask *tmp =
+         realloc(masks, sizeof(util_affinity_mask) * (num_nodes + 1));
+      if (!tmp) {
+         free(cpulist);
+         break;
+      }
+      masks = tmp;
+      memset(&masks[num_nodes], 0, sizeof(util_affinity_mask));
+
+      /* Memory-only nodes have no CPUs */
+      if (parse_sysfs_list(cpulist, masks[num_nodes], UTIL_MAX_CPUS))
+         num_nodes++;
+      free(cpulist);
+   }
+
+   if (num_nodes > 1) {
+      util_cpu_caps.num_numa_nodes = num_nodes;
+      util_cpu_caps.numa_affinity_mask = masks;
+   } else {
+      free(masks);
+   }
+}
+#endif
+
+
 static void
 get_cpu_topology(void)
 {
@@ -538,6 +619,11 @@ get_cpu_topology(void)
    util_cpu_caps.nr_big_cpus = num_big_cpus;
 #endif
 
+   util_cpu_caps.num_numa_nodes = 1;
+#if DETECT_OS_LINUX
+   get_numa_topology();
+#endif
+
 #if DETECT_ARCH_X86 || DETECT_ARCH_X86_64
    /* AMD Zen */
    if (util_cpu_caps.family >= CPU_AMD_ZEN1_ZEN2 &&
@@ -997,6 +1083,7 @@ _util_cpu_detect_once(void)
       printf("util_cpu_caps.has_avx512vbmi = %u\n", util_cpu_caps.has_avx512vbmi);
       printf("util_cpu_caps.has_clflushopt = %u\n", util_cpu_caps.has_clflushopt);
       printf("util_cpu_caps.num_L3_caches = %u\n", util_cpu_caps.num_L3_caches);
+      printf("util_cpu_caps.num_numa_nodes = %u\n", util_cpu_caps.num_numa_nodes);
       printf("util_cpu_caps.num_cpu_mask_bits = %u\n", util_cpu_caps.num_cpu_mask_bits);
    }
    _util_cpu_caps_state.caps = util_cpu_caps;
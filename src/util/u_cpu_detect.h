@@ -126,6 +126,13 @@ struct util_cpu_caps_t {
 
    /* Affinity masks for each L3 cache. */
    util_affinity_mask *L3_affinity_mask;
+
+   /* Number of NUMA nodes with CPUs, 1 if unknown. */
+   unsigned num_numa_nodes;
+
+   /* Affinity masks for each NUMA node, NULL if there is only one. */
+   util_affinity_mask *numa_affinity_mask;
+
    /**
     * number of "big" CPUs in big.LITTLE configuration
     * 